@@ -60,6 +60,7 @@
 #include "libavutil/bprint.h"
 #include "libavutil/time.h"
 #include "libavutil/threadmessage.h"
+#include "libavutil/perf.h"
 #include "libavformat/os_support.h"
 
 #include "libavformat/ffm.h" // not public API
@@ -433,6 +434,20 @@ static void ffmpeg_cleanup(int ret)
         printf("bench: maxrss=%ikB\n", maxrss);
     }
 
+    if (perf_report_filename) {
+        char *json = NULL;
+        FILE *f;
+        if (av_perf_dump_json(&json) < 0 || !(f = fopen(perf_report_filename, "w"))) {
+            av_log(NULL, AV_LOG_ERROR, "Unable to write the performance report to %s\n",
+                   perf_report_filename);
+        } else {
+            fputs(json, f);
+            fclose(f);
+        }
+        av_free(json);
+        av_freep(&perf_report_filename);
+    }
+
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
         avfilter_graph_free(&fg->graph);
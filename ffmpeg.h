@@ -467,6 +467,7 @@ extern FilterGraph **filtergraphs;
 extern int        nb_filtergraphs;
 
 extern char *vstats_filename;
+extern char *perf_report_filename;
 
 extern float audio_drift_threshold;
 extern float dts_delta_threshold;
@@ -38,6 +38,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/perf.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixfmt.h"
 
@@ -77,6 +78,7 @@ const HWAccel hwaccels[] = {
 };
 
 char *vstats_filename;
+char *perf_report_filename;
 
 float audio_drift_threshold = 0.1;
 float dts_delta_threshold   = 10;
@@ -2319,6 +2321,16 @@ static int opt_vstats_file(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_perf_report(void *optctx, const char *opt, const char *arg)
+{
+    av_free(perf_report_filename);
+    perf_report_filename = av_strdup(arg);
+    if (!perf_report_filename)
+        return AVERROR(ENOMEM);
+    av_perf_set_enabled(1);
+    return 0;
+}
+
 static int opt_vstats(void *optctx, const char *opt, const char *arg)
 {
     char filename[40];
@@ -2816,6 +2828,8 @@ const OptionDef options[] = {
         "add timings for benchmarking" },
     { "benchmark_all",  OPT_BOOL | OPT_EXPERT,                       { &do_benchmark_all },
       "add timings for each task" },
+    { "perf_report",    HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_perf_report },
+      "time the library entry points and write the statistics as JSON to file", "file" },
     { "progress",       HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
     { "stdin",          OPT_BOOL | OPT_EXPERT,                       { &stdin_interaction },
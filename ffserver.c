@@ -45,6 +45,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/lfg.h"
 #include "libavutil/dict.h"
 #include "libavutil/intreadwrite.h"
@@ -64,6 +65,13 @@
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+#if HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#include <sys/uio.h>
 #include <errno.h>
 #include <time.h>
 #include <sys/wait.h>
@@ -117,6 +125,17 @@ static const char * const http_state[] = {
 
 #define SYNC_TIMEOUT (10 * 1000)
 
+/* maximum number of events returned by one epoll_wait() */
+#define EPOLL_MAX_EVENTS 256
+/* maximum number of connections accepted at once */
+#define ACCEPT_MAX 64
+
+/* shared output: number of muxed packets and bytes kept for the clients */
+#define FANOUT_MAX_CHUNKS 1024
+#define FANOUT_MAX_SIZE (4 * 1024 * 1024)
+/* maximum number of buffers sent to a client in one writev() */
+#define FANOUT_MAX_IOV 64
+
 typedef struct RTSPActionServerSetup {
     uint32_t ipaddr;
     char transport_option[512];
@@ -133,6 +152,8 @@ typedef struct HTTPContext {
     int fd; /* socket file descriptor */
     struct sockaddr_in from_addr; /* origin */
     struct pollfd *poll_entry; /* used when polling */
+    int revents;               /* events returned by poll() or epoll_wait() */
+    int poll_events;           /* events registered with epoll */
     int64_t timeout;
     uint8_t *buffer_ptr, *buffer_end;
     int http_error;
@@ -173,6 +194,14 @@ typedef struct HTTPContext {
     uint8_t *buffer;
     int is_packetized; /* if true, the stream is packetized */
     int packet_stream_index; /* current stream for output in state machine */
+    int key_frame;           /* last prepared packet is a key frame */
+
+    /* shared output specific */
+    struct FanOut *fanout;   /* shared output the data is taken from */
+    struct HTTPContext *fanout_next;
+    AVBufferRef *fanout_buf; /* header or packet being sent */
+    int fanout_buf_pos;
+    int64_t fanout_seq;      /* next packet of the shared output to send */
 
     /* RTSP state specific */
     uint8_t *pb_buffer; /* XXX: use that in all the code */
@@ -190,8 +219,32 @@ typedef struct HTTPContext {
     /* RTP/TCP specific */
     struct HTTPContext *rtsp_c;
     uint8_t *packet_buffer, *packet_buffer_ptr, *packet_buffer_end;
+
+    struct HTTPContext *next_rtp; /* list of RTP connections */
 } HTTPContext;
 
+/* a muxed packet of a shared output */
+typedef struct FanOutChunk {
+    AVBufferRef *buf;
+    int key_frame;           /* clients can start receiving the stream here */
+} FanOutChunk;
+
+/* output of a stream muxed once and sent to all its clients */
+typedef struct FanOut {
+    struct FFStream *stream;
+    HTTPContext *src;        /* reads the feed and muxes the output */
+    HTTPContext *first_client;
+    AVBufferRef *header;
+    FanOutChunk chunks[FANOUT_MAX_CHUNKS]; /* latest packets, indexed by
+                                              sequence number */
+    int64_t first_seq;       /* oldest packet kept */
+    int64_t end_seq;         /* sequence number of the next packet */
+    int64_t key_seq;         /* latest key frame, -1 if none */
+    int64_t size;            /* size of the packets kept */
+    int eof;                 /* no more packets will be added */
+    struct FanOut *next;
+} FanOut;
+
 /* each generated stream is described here */
 enum StreamType {
     STREAM_TYPE_LIVE,
@@ -228,6 +281,7 @@ typedef struct FFStream {
     int prebuffer;      /* Number of milliseconds early to start */
     int64_t max_time;      /* Number of milliseconds to run */
     int send_on_key;
+    int shared_output;  /* mux once and send the same data to all clients */
     AVStream *streams[MAX_STREAMS];
     int feed_streams[MAX_STREAMS]; /* index of streams in the feed */
     char feed_filename[1024]; /* file name of the feed storage, or
@@ -269,10 +323,12 @@ static struct sockaddr_in my_rtsp_addr;
 
 static char logfilename[1024];
 static HTTPContext *first_http_ctx;
+static HTTPContext *first_rtp_ctx;
+static FanOut *first_fanout;
 static FFStream *first_feed;   /* contains only feeds */
 static FFStream *first_stream; /* contains all streams, including feeds */
 
-static void new_connection(int server_fd, int is_rtsp);
+static int new_connection(int server_fd, int is_rtsp);
 static void close_connection(HTTPContext *c);
 
 /* HTTP handling */
@@ -284,6 +340,11 @@ static int open_input_stream(HTTPContext *c, const char *info);
 static int http_start_receive_data(HTTPContext *c);
 static int http_receive_data(HTTPContext *c);
 
+/* shared output handling */
+static int fanout_add_client(HTTPContext *c);
+static void fanout_remove_client(HTTPContext *c);
+static int fanout_send(HTTPContext *c);
+
 /* RTSP handling */
 static int rtsp_parse_request(HTTPContext *c);
 static void rtsp_cmd_describe(HTTPContext *c, const char *url);
@@ -570,7 +631,7 @@ static int socket_open_listen(struct sockaddr_in *my_addr)
         return -1;
     }
 
-    if (listen (server_fd, 5) < 0) {
+    if (listen (server_fd, SOMAXCONN) < 0) {
         perror ("listen");
         closesocket(server_fd);
         return -1;
@@ -638,47 +699,138 @@ static void start_multicast(void)
     }
 }
 
-/* main loop of the HTTP server */
-static int http_server(void)
+/* return the events to wait for on the socket of a connection */
+static int connection_poll_events(HTTPContext *c)
 {
-    int server_fd = 0, rtsp_server_fd = 0;
-    int ret, delay;
-    struct pollfd *poll_table, *poll_entry;
-    HTTPContext *c, *c_next;
-
-    if(!(poll_table = av_mallocz_array(nb_max_http_connections + 2, sizeof(*poll_table)))) {
-        http_log("Impossible to allocate a poll table handling %d connections.\n", nb_max_http_connections);
-        return -1;
+    switch(c->state) {
+    case HTTPSTATE_SEND_HEADER:
+    case RTSPSTATE_SEND_REPLY:
+    case RTSPSTATE_SEND_PACKET:
+        return POLLOUT;
+    case HTTPSTATE_SEND_DATA_HEADER:
+    case HTTPSTATE_SEND_DATA:
+    case HTTPSTATE_SEND_DATA_TRAILER:
+        /* for TCP, we output as much as we can
+         * (may need to put a limit) */
+        return c->is_packetized ? 0 : POLLOUT;
+    case HTTPSTATE_WAIT_REQUEST:
+    case HTTPSTATE_RECEIVE_DATA:
+    case HTTPSTATE_WAIT_FEED:
+    case RTSPSTATE_WAIT_REQUEST:
+        /* need to catch errors */
+        return POLLIN; /* Maybe this will work */
+    default:
+        return 0;
     }
+}
 
-    if (my_http_addr.sin_port) {
-        server_fd = socket_open_listen(&my_http_addr);
-        if (server_fd < 0) {
-            av_free(poll_table);
-            return -1;
-        }
-    }
+/* when ffserver is doing the timing, we work by looking at which packet
+   needs to be sent every 10 ms */
+static int is_sending_packets(HTTPContext *c)
+{
+    return c->is_packetized &&
+           (c->state == HTTPSTATE_SEND_DATA_HEADER ||
+            c->state == HTTPSTATE_SEND_DATA ||
+            c->state == HTTPSTATE_SEND_DATA_TRAILER);
+}
 
-    if (my_rtsp_addr.sin_port) {
-        rtsp_server_fd = socket_open_listen(&my_rtsp_addr);
-        if (rtsp_server_fd < 0) {
-            av_free(poll_table);
-            closesocket(server_fd);
-            return -1;
-        }
-    }
+#if HAVE_SYS_EPOLL_H
+static int epoll_fd = -1;
 
-    if (!rtsp_server_fd && !server_fd) {
-        http_log("HTTP and RTSP disabled.\n");
-        av_free(poll_table);
+static int epoll_register(int fd, int op, int events, void *ptr)
+{
+    struct epoll_event ev = { 0 };
+
+    ev.events   = (events & POLLIN  ? EPOLLIN  : 0) |
+                  (events & POLLOUT ? EPOLLOUT : 0);
+    ev.data.ptr = ptr;
+    if (epoll_ctl(epoll_fd, op, fd, &ev) < 0) {
+        http_log("epoll_ctl failed: %s\n", strerror(errno));
         return -1;
     }
+    return 0;
+}
 
-    http_log("FFserver started.\n");
+/* start watching the socket of a new connection */
+static int add_poll_connection(HTTPContext *c)
+{
+    if (epoll_fd < 0)
+        return 0;
+    c->poll_events = connection_poll_events(c);
+    return epoll_register(c->fd, EPOLL_CTL_ADD, c->poll_events, c);
+}
 
-    start_children(first_feed);
+/* update the events watched for after a change of state of a connection */
+static void update_poll_events(HTTPContext *c)
+{
+    int events;
 
-    start_multicast();
+    if (epoll_fd < 0 || c->fd < 0)
+        return;
+    events = connection_poll_events(c);
+    if (events != c->poll_events &&
+        !epoll_register(c->fd, EPOLL_CTL_MOD, events, c))
+        c->poll_events = events;
+}
+
+/* the socket may have been duplicated in a child process, so it is not
+ * enough to close it to stop watching it */
+static void remove_poll_connection(HTTPContext *c)
+{
+    if (epoll_fd >= 0 && c->fd >= 0)
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+}
+
+static int epoll_revents(uint32_t events)
+{
+    return (events & EPOLLIN  ? POLLIN  : 0) |
+           (events & EPOLLOUT ? POLLOUT : 0) |
+           (events & EPOLLERR ? POLLERR : 0) |
+           (events & EPOLLHUP ? POLLHUP : 0);
+}
+#else
+static int add_poll_connection(HTTPContext *c)
+{
+    return 0;
+}
+
+static void update_poll_events(HTTPContext *c)
+{
+}
+
+static void remove_poll_connection(HTTPContext *c)
+{
+}
+#endif
+
+/* handle the events of a connection, close it on error */
+static void service_connection(HTTPContext *c)
+{
+    if (handle_connection(c) < 0) {
+        log_connection(c);
+        /* close and free the connection */
+        close_connection(c);
+        return;
+    }
+    c->revents = 0;
+    update_poll_events(c);
+    /* RTP over TCP changes the state of the RTSP connection */
+    if (c->rtsp_c)
+        update_poll_events(c->rtsp_c);
+}
+
+/* wait for events with poll(), the poll table is rebuilt at each
+   iteration */
+static int poll_loop(int server_fd, int rtsp_server_fd)
+{
+    int ret, delay;
+    struct pollfd *poll_table, *poll_entry;
+    HTTPContext *c, *c_next;
+
+    if(!(poll_table = av_mallocz_array(nb_max_http_connections + 2, sizeof(*poll_table)))) {
+        http_log("Impossible to allocate a poll table handling %d connections.\n", nb_max_http_connections);
+        return -1;
+    }
 
     for(;;) {
         poll_entry = poll_table;
@@ -694,54 +846,20 @@ static int http_server(void)
         }
 
         /* wait for events on each HTTP handle */
-        c = first_http_ctx;
         delay = 1000;
-        while (c) {
-            int fd;
-            fd = c->fd;
-            switch(c->state) {
-            case HTTPSTATE_SEND_HEADER:
-            case RTSPSTATE_SEND_REPLY:
-            case RTSPSTATE_SEND_PACKET:
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLOUT;
-                poll_entry++;
-                break;
-            case HTTPSTATE_SEND_DATA_HEADER:
-            case HTTPSTATE_SEND_DATA:
-            case HTTPSTATE_SEND_DATA_TRAILER:
-                if (!c->is_packetized) {
-                    /* for TCP, we output as much as we can
-                     * (may need to put a limit) */
-                    c->poll_entry = poll_entry;
-                    poll_entry->fd = fd;
-                    poll_entry->events = POLLOUT;
-                    poll_entry++;
-                } else {
-                    /* when ffserver is doing the timing, we work by
-                       looking at which packet needs to be sent every
-                       10 ms */
-                    /* one tick wait XXX: 10 ms assumed */
-                    if (delay > 10)
-                        delay = 10;
-                }
-                break;
-            case HTTPSTATE_WAIT_REQUEST:
-            case HTTPSTATE_RECEIVE_DATA:
-            case HTTPSTATE_WAIT_FEED:
-            case RTSPSTATE_WAIT_REQUEST:
-                /* need to catch errors */
+        for(c = first_http_ctx; c; c = c->next) {
+            int events = connection_poll_events(c);
+
+            c->poll_entry = NULL;
+            if (events) {
                 c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLIN;/* Maybe this will work */
+                poll_entry->fd = c->fd;
+                poll_entry->events = events;
                 poll_entry++;
-                break;
-            default:
-                c->poll_entry = NULL;
-                break;
+            } else if (is_sending_packets(c)) {
+                /* one tick wait XXX: 10 ms assumed */
+                delay = 10;
             }
-            c = c->next;
         }
 
         /* wait for an event on one connection. We poll at least every
@@ -765,11 +883,8 @@ static int http_server(void)
         /* now handle the events */
         for(c = first_http_ctx; c; c = c_next) {
             c_next = c->next;
-            if (handle_connection(c) < 0) {
-                log_connection(c);
-                /* close and free the connection */
-                close_connection(c);
-            }
+            c->revents = c->poll_entry ? c->poll_entry->revents : 0;
+            service_connection(c);
         }
 
         poll_entry = poll_table;
@@ -787,6 +902,132 @@ static int http_server(void)
     }
 }
 
+#if HAVE_SYS_EPOLL_H
+/* wait for events with epoll: sockets are registered once and only the
+   connections which have events, the RTP connections and, every second,
+   the timeouts are handled at each iteration */
+static int epoll_loop(int server_fd, int rtsp_server_fd)
+{
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    HTTPContext *c, *c_next;
+    int64_t last_sweep = cur_time;
+    int i, j, nb_events, delay;
+
+    if ((epoll_fd = epoll_create(EPOLL_MAX_EVENTS)) < 0) {
+        http_log("epoll_create failed: %s\n", strerror(errno));
+        return AVERROR(ENOSYS);
+    }
+    if ((server_fd && epoll_register(server_fd, EPOLL_CTL_ADD, POLLIN, &server_fd) < 0) ||
+        (rtsp_server_fd && epoll_register(rtsp_server_fd, EPOLL_CTL_ADD, POLLIN, &rtsp_server_fd) < 0)) {
+        close(epoll_fd);
+        epoll_fd = -1;
+        return AVERROR(ENOSYS);
+    }
+
+    for(;;) {
+        /* wake up at least every second to handle timeouts */
+        delay = av_clip(1000 - (cur_time - last_sweep), 0, 1000);
+        for(c = first_rtp_ctx; c; c = c->next_rtp) {
+            if (is_sending_packets(c)) {
+                delay = FFMIN(delay, 10);
+                break;
+            }
+        }
+
+        nb_events = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, delay);
+        if (nb_events < 0) {
+            if (ff_neterrno() != AVERROR(EAGAIN) &&
+                ff_neterrno() != AVERROR(EINTR))
+                return -1;
+            continue;
+        }
+
+        cur_time = av_gettime() / 1000;
+
+        if (need_to_start_children) {
+            need_to_start_children = 0;
+            start_children(first_feed);
+        }
+
+        /* handle the connections which have events */
+        for (i = 0; i < nb_events; i++) {
+            if (events[i].data.ptr == &server_fd) {
+                /* new HTTP connection requests */
+                for (j = 0; j < ACCEPT_MAX && !new_connection(server_fd, 0); j++)
+                    ;
+            } else if (events[i].data.ptr == &rtsp_server_fd) {
+                /* new RTSP connection requests */
+                for (j = 0; j < ACCEPT_MAX && !new_connection(rtsp_server_fd, 1); j++)
+                    ;
+            } else {
+                c = events[i].data.ptr;
+                c->revents = epoll_revents(events[i].events);
+                service_connection(c);
+            }
+        }
+
+        /* send the RTP packets which are due */
+        for(c = first_rtp_ctx; c; c = c_next) {
+            c_next = c->next_rtp;
+            if (is_sending_packets(c))
+                service_connection(c);
+        }
+
+        /* check the timeouts */
+        if (cur_time - last_sweep >= 1000) {
+            last_sweep = cur_time;
+            for(c = first_http_ctx; c; c = c_next) {
+                c_next = c->next;
+                if (!c->is_packetized)
+                    service_connection(c);
+            }
+        }
+    }
+}
+#endif
+
+/* main loop of the HTTP server */
+static int http_server(void)
+{
+    int server_fd = 0, rtsp_server_fd = 0;
+
+    if (my_http_addr.sin_port) {
+        server_fd = socket_open_listen(&my_http_addr);
+        if (server_fd < 0)
+            return -1;
+    }
+
+    if (my_rtsp_addr.sin_port) {
+        rtsp_server_fd = socket_open_listen(&my_rtsp_addr);
+        if (rtsp_server_fd < 0) {
+            closesocket(server_fd);
+            return -1;
+        }
+    }
+
+    if (!rtsp_server_fd && !server_fd) {
+        http_log("HTTP and RTSP disabled.\n");
+        return -1;
+    }
+
+    http_log("FFserver started.\n");
+
+    start_children(first_feed);
+
+    start_multicast();
+
+    cur_time = av_gettime() / 1000;
+#if HAVE_SYS_EPOLL_H
+    {
+        int ret = epoll_loop(server_fd, rtsp_server_fd);
+        if (ret != AVERROR(ENOSYS))
+            return ret;
+        /* fall back to poll() */
+    }
+#endif
+    return poll_loop(server_fd, rtsp_server_fd);
+}
+
 /* start waiting for a new HTTP/RTSP request */
 static void start_wait_request(HTTPContext *c, int is_rtsp)
 {
@@ -820,7 +1061,8 @@ static void http_send_too_busy_reply(int fd)
 }
 
 
-static void new_connection(int server_fd, int is_rtsp)
+/* accept a new connection, return a negative value if there was none */
+static int new_connection(int server_fd, int is_rtsp)
 {
     struct sockaddr_in from_addr;
     socklen_t len;
@@ -831,8 +1073,9 @@ static void new_connection(int server_fd, int is_rtsp)
     fd = accept(server_fd, (struct sockaddr *)&from_addr,
                 &len);
     if (fd < 0) {
-        http_log("error during accept %s\n", strerror(errno));
-        return;
+        if (ff_neterrno() != AVERROR(EAGAIN))
+            http_log("error during accept %s\n", strerror(errno));
+        return -1;
     }
     if (ff_socket_nonblock(fd, 1) < 0)
         av_log(NULL, AV_LOG_WARNING, "ff_socket_nonblock failed\n");
@@ -855,13 +1098,15 @@ static void new_connection(int server_fd, int is_rtsp)
     if (!c->buffer)
         goto fail;
 
+    start_wait_request(c, is_rtsp);
+    if (add_poll_connection(c) < 0)
+        goto fail;
+
     c->next = first_http_ctx;
     first_http_ctx = c;
     nb_connections++;
 
-    start_wait_request(c, is_rtsp);
-
-    return;
+    return 0;
 
  fail:
     if (c) {
@@ -869,6 +1114,22 @@ static void new_connection(int server_fd, int is_rtsp)
         av_free(c);
     }
     closesocket(fd);
+    return 0;
+}
+
+static void close_input_stream(HTTPContext *c)
+{
+    int i;
+
+    if (c->fmt_in) {
+        /* close each frame parser */
+        for(i=0;i<c->fmt_in->nb_streams;i++) {
+            AVStream *st = c->fmt_in->streams[i];
+            if (st->codec->codec)
+                avcodec_close(st->codec);
+        }
+        avformat_close_input(&c->fmt_in);
+    }
 }
 
 static void close_connection(HTTPContext *c)
@@ -877,7 +1138,6 @@ static void close_connection(HTTPContext *c)
     int i, nb_streams;
     AVFormatContext *ctx;
     URLContext *h;
-    AVStream *st;
 
     /* remove connection from list */
     cp = &first_http_ctx;
@@ -889,6 +1149,12 @@ static void close_connection(HTTPContext *c)
             cp = &c1->next;
     }
 
+    if (c->is_packetized) {
+        for (cp = &first_rtp_ctx; *cp != c; cp = &(*cp)->next_rtp)
+            ;
+        *cp = c->next_rtp;
+    }
+
     /* remove references, if any (XXX: do it faster) */
     for(c1 = first_http_ctx; c1; c1 = c1->next) {
         if (c1->rtsp_c == c)
@@ -896,17 +1162,13 @@ static void close_connection(HTTPContext *c)
     }
 
     /* remove connection associated resources */
-    if (c->fd >= 0)
+    if (c->fd >= 0) {
+        remove_poll_connection(c);
         closesocket(c->fd);
-    if (c->fmt_in) {
-        /* close each frame parser */
-        for(i=0;i<c->fmt_in->nb_streams;i++) {
-            st = c->fmt_in->streams[i];
-            if (st->codec->codec)
-                avcodec_close(st->codec);
-        }
-        avformat_close_input(&c->fmt_in);
     }
+    if (c->fanout)
+        fanout_remove_client(c);
+    close_input_stream(c);
 
     /* free RTP output streams if any */
     nb_streams = 0;
@@ -970,11 +1232,11 @@ static int handle_connection(HTTPContext *c)
         /* timeout ? */
         if ((c->timeout - cur_time) < 0)
             return -1;
-        if (c->poll_entry->revents & (POLLERR | POLLHUP))
+        if (c->revents & (POLLERR | POLLHUP))
             return -1;
 
         /* no need to read if no events */
-        if (!(c->poll_entry->revents & POLLIN))
+        if (!(c->revents & POLLIN))
             return 0;
         /* read the data */
     read_loop:
@@ -1008,11 +1270,11 @@ static int handle_connection(HTTPContext *c)
         break;
 
     case HTTPSTATE_SEND_HEADER:
-        if (c->poll_entry->revents & (POLLERR | POLLHUP))
+        if (c->revents & (POLLERR | POLLHUP))
             return -1;
 
         /* no need to write if no events */
-        if (!(c->poll_entry->revents & POLLOUT))
+        if (!(c->revents & POLLOUT))
             return 0;
         len = send(c->fd, c->buffer_ptr, c->buffer_end - c->buffer_ptr, 0);
         if (len < 0) {
@@ -1045,11 +1307,11 @@ static int handle_connection(HTTPContext *c)
            input streams set the speed). It may be better to verify
            that we do not rely too much on the kernel queues */
         if (!c->is_packetized) {
-            if (c->poll_entry->revents & (POLLERR | POLLHUP))
+            if (c->revents & (POLLERR | POLLHUP))
                 return -1;
 
             /* no need to read if no events */
-            if (!(c->poll_entry->revents & POLLOUT))
+            if (!(c->revents & POLLOUT))
                 return 0;
         }
         if (http_send_data(c) < 0)
@@ -1060,26 +1322,26 @@ static int handle_connection(HTTPContext *c)
         break;
     case HTTPSTATE_RECEIVE_DATA:
         /* no need to read if no events */
-        if (c->poll_entry->revents & (POLLERR | POLLHUP))
+        if (c->revents & (POLLERR | POLLHUP))
             return -1;
-        if (!(c->poll_entry->revents & POLLIN))
+        if (!(c->revents & POLLIN))
             return 0;
         if (http_receive_data(c) < 0)
             return -1;
         break;
     case HTTPSTATE_WAIT_FEED:
         /* no need to read if no events */
-        if (c->poll_entry->revents & (POLLIN | POLLERR | POLLHUP))
+        if (c->revents & (POLLIN | POLLERR | POLLHUP))
             return -1;
 
         /* nothing to do, we'll be waken up by incoming feed packets */
         break;
 
     case RTSPSTATE_SEND_REPLY:
-        if (c->poll_entry->revents & (POLLERR | POLLHUP))
+        if (c->revents & (POLLERR | POLLHUP))
             goto close_connection;
         /* no need to write if no events */
-        if (!(c->poll_entry->revents & POLLOUT))
+        if (!(c->revents & POLLOUT))
             return 0;
         len = send(c->fd, c->buffer_ptr, c->buffer_end - c->buffer_ptr, 0);
         if (len < 0) {
@@ -1098,12 +1360,12 @@ static int handle_connection(HTTPContext *c)
         }
         break;
     case RTSPSTATE_SEND_PACKET:
-        if (c->poll_entry->revents & (POLLERR | POLLHUP)) {
+        if (c->revents & (POLLERR | POLLHUP)) {
             av_freep(&c->packet_buffer);
             return -1;
         }
         /* no need to write if no events */
-        if (!(c->poll_entry->revents & POLLOUT))
+        if (!(c->revents & POLLOUT))
             return 0;
         len = send(c->fd, c->packet_buffer_ptr,
                     c->packet_buffer_end - c->packet_buffer_ptr, 0);
@@ -1497,6 +1759,19 @@ enum RedirType {
 };
 
 /* parse HTTP request and prepare header */
+/* clients which do not select a start position or rates of their own
+ * can receive the shared output of a stream */
+static int use_shared_output(HTTPContext *c, const char *info)
+{
+    char buf[128];
+
+    return c->stream->shared_output && c->stream->feed &&
+           !c->stream->max_time &&
+           !memcmp(c->feed_streams, c->stream->feed_streams, sizeof(c->feed_streams)) &&
+           !av_find_info_tag(buf, sizeof(buf), "date", info) &&
+           !av_find_info_tag(buf, sizeof(buf), "buffer", info);
+}
+
 static int http_parse_request(HTTPContext *c)
 {
     const char *p;
@@ -1864,8 +2139,13 @@ static int http_parse_request(HTTPContext *c)
     if (c->stream->stream_type == STREAM_TYPE_STATUS)
         goto send_status;
 
-    /* open input stream */
-    if (open_input_stream(c, info) < 0) {
+    /* open input stream, or share the output of the other clients */
+    if (use_shared_output(c, info)) {
+        if (fanout_add_client(c) < 0) {
+            snprintf(msg, sizeof(msg), "Input stream corresponding to '%s' not found", url);
+            goto send_error;
+        }
+    } else if (open_input_stream(c, info) < 0) {
         snprintf(msg, sizeof(msg), "Input stream corresponding to '%s' not found", url);
         goto send_error;
     }
@@ -2274,6 +2554,17 @@ static int64_t get_packet_send_clock(HTTPContext *c)
 }
 
 
+/* streams without video can be joined at any key packet */
+static int stream_has_video(FFStream *stream)
+{
+    int i;
+
+    for (i = 0; i < stream->nb_streams; i++)
+        if (stream->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+            return 1;
+    return 0;
+}
+
 static int http_prepare_data(HTTPContext *c)
 {
     int i, len, ret;
@@ -2411,6 +2702,9 @@ static int http_prepare_data(HTTPContext *c)
                     AVStream *ist, *ost;
                 send_it:
                     ist = c->fmt_in->streams[source_index];
+                    c->key_frame = pkt.flags & AV_PKT_FLAG_KEY &&
+                                   (ist->codec->codec_type == AVMEDIA_TYPE_VIDEO ||
+                                    !stream_has_video(c->stream));
                     /* specific handling for RTP: we use several
                      * output streams (one for each RTP connection).
                      * XXX: need more abstract handling */
@@ -2508,6 +2802,9 @@ static int http_send_data(HTTPContext *c)
 {
     int len, ret;
 
+    if (c->fanout)
+        return fanout_send(c);
+
     for(;;) {
         if (c->buffer_ptr >= c->buffer_end) {
             ret = http_prepare_data(c);
@@ -2623,6 +2920,304 @@ static int http_send_data(HTTPContext *c)
     return 0;
 }
 
+/********************************************************************/
+/* shared output handling */
+
+static void fanout_drop(FanOut *fo)
+{
+    FanOutChunk *chunk = &fo->chunks[fo->first_seq++ % FANOUT_MAX_CHUNKS];
+
+    fo->size -= chunk->buf->size;
+    av_buffer_unref(&chunk->buf);
+}
+
+static void fanout_push(FanOut *fo, AVBufferRef *buf, int key_frame)
+{
+    FanOutChunk *chunk;
+
+    if (fo->end_seq - fo->first_seq == FANOUT_MAX_CHUNKS)
+        fanout_drop(fo);
+    chunk = &fo->chunks[fo->end_seq % FANOUT_MAX_CHUNKS];
+    chunk->buf       = buf;
+    chunk->key_frame = key_frame;
+    if (key_frame)
+        fo->key_seq = fo->end_seq;
+    fo->end_seq++;
+    fo->size += buf->size;
+
+    /* keep at least what new clients need to start at the latest key frame */
+    while (fo->size > FANOUT_MAX_SIZE && fo->first_seq < fo->key_seq)
+        fanout_drop(fo);
+}
+
+/* read and mux everything available in the feed */
+static void fanout_fill(FanOut *fo)
+{
+    HTTPContext *c, *src = fo->src;
+    int nb_chunks = 0;
+
+    while (!fo->eof && src->state != HTTPSTATE_WAIT_FEED) {
+        enum HTTPState state = src->state;
+        AVBufferRef *buf;
+        int len;
+
+        src->key_frame = 0;
+        if (http_prepare_data(src) < 0) {
+            fo->eof = 1;
+            break;
+        }
+        if (!src->pb_buffer)
+            continue;
+        len = src->buffer_end - src->buffer_ptr;
+        if (len <= 0)
+            continue;
+        buf = av_buffer_create(src->pb_buffer, len, av_buffer_default_free, NULL, 0);
+        if (!buf) {
+            fo->eof = 1;
+            break;
+        }
+        src->pb_buffer  = NULL;
+        src->buffer_ptr = src->buffer_end = NULL;
+
+        if (state == HTTPSTATE_SEND_DATA_HEADER) {
+            fo->header = buf;
+        } else {
+            fanout_push(fo, buf, state == HTTPSTATE_SEND_DATA && src->key_frame);
+            nb_chunks++;
+        }
+    }
+
+    /* wake up the clients waiting for data */
+    if (nb_chunks || fo->eof) {
+        for (c = fo->first_client; c; c = c->fanout_next) {
+            if (c->state == HTTPSTATE_WAIT_FEED) {
+                c->state = HTTPSTATE_SEND_DATA;
+                update_poll_events(c);
+            }
+        }
+    }
+}
+
+static void fanout_close(FanOut *fo)
+{
+    FanOut **pfo;
+    HTTPContext *src = fo->src;
+    AVFormatContext *ctx = &src->fmt_ctx;
+    int i;
+
+    for (pfo = &first_fanout; *pfo != fo; pfo = &(*pfo)->next)
+        ;
+    *pfo = fo->next;
+
+    while (fo->first_seq < fo->end_seq)
+        fanout_drop(fo);
+    av_buffer_unref(&fo->header);
+
+    close_input_stream(src);
+    /* the muxer frees its data in the trailer, which no client needs */
+    if (src->state != HTTPSTATE_SEND_DATA_HEADER && !src->last_packet_sent &&
+        avio_open_dyn_buf(&ctx->pb) >= 0) {
+        uint8_t *trailer;
+        av_write_trailer(ctx);
+        avio_close_dyn_buf(ctx->pb, &trailer);
+        av_free(trailer);
+    }
+    for(i=0; i<ctx->nb_streams; i++)
+        av_freep(&ctx->streams[i]);
+    av_freep(&ctx->streams);
+    av_freep(&ctx->priv_data);
+    av_freep(&src->pb_buffer);
+    av_free(src);
+    av_free(fo);
+}
+
+static int fanout_open(FanOut **pfo, FFStream *stream)
+{
+    FanOut *fo = av_mallocz(sizeof(*fo));
+    HTTPContext *src = av_mallocz(sizeof(*src));
+    int ret;
+
+    if (!fo || !src) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    /* the source is a connection without socket which runs the usual
+       state machine */
+    src->fd = -1;
+    src->stream = stream;
+    memcpy(src->feed_streams, stream->feed_streams, sizeof(src->feed_streams));
+    memset(src->switch_feed_streams, -1, sizeof(src->switch_feed_streams));
+    if ((ret = open_input_stream(src, "")) < 0)
+        goto fail;
+    src->state = HTTPSTATE_SEND_DATA_HEADER;
+
+    fo->stream  = stream;
+    fo->src     = src;
+    fo->key_seq = -1;
+    fo->next    = first_fanout;
+    first_fanout = fo;
+
+    fanout_fill(fo);
+    *pfo = fo;
+    return 0;
+ fail:
+    av_free(src);
+    av_free(fo);
+    return ret;
+}
+
+static int fanout_add_client(HTTPContext *c)
+{
+    FanOut *fo;
+    int ret;
+
+    for (fo = first_fanout; fo; fo = fo->next)
+        if (fo->stream == c->stream && !fo->eof)
+            break;
+    if (!fo && (ret = fanout_open(&fo, c->stream)) < 0)
+        return ret;
+
+    c->fanout = fo;
+    c->fanout_next = fo->first_client;
+    fo->first_client = c;
+
+    /* start with the header, then at the latest key frame */
+    if (fo->header && !(c->fanout_buf = av_buffer_ref(fo->header)))
+        return AVERROR(ENOMEM);
+    c->fanout_buf_pos = 0;
+    c->fanout_seq = fo->key_seq >= fo->first_seq ? fo->key_seq : fo->end_seq;
+    c->got_key_frame = 0;
+    return 0;
+}
+
+static void fanout_remove_client(HTTPContext *c)
+{
+    FanOut *fo = c->fanout;
+    HTTPContext **cp;
+
+    for (cp = &fo->first_client; *cp != c; cp = &(*cp)->fanout_next)
+        ;
+    *cp = c->fanout_next;
+    av_buffer_unref(&c->fanout_buf);
+    c->fanout = NULL;
+
+    if (!fo->first_client)
+        fanout_close(fo);
+}
+
+/* move the position of a client to a packet it can be sent from */
+static void fanout_seek_client(HTTPContext *c)
+{
+    FanOut *fo = c->fanout;
+
+    if (c->fanout_seq < fo->first_seq) {
+        /* the client is too slow, its data has been dropped */
+        http_log("%s too slow for stream '%s', skipping %"PRId64" packets\n",
+                 inet_ntoa(c->from_addr.sin_addr), c->stream->filename,
+                 fo->first_seq - c->fanout_seq);
+        c->fanout_seq = fo->key_seq >= fo->first_seq ? fo->key_seq : fo->end_seq;
+        c->got_key_frame = 0;
+    }
+    while (!c->got_key_frame && c->fanout_seq < fo->end_seq) {
+        if (fo->chunks[c->fanout_seq % FANOUT_MAX_CHUNKS].key_frame)
+            c->got_key_frame = 1;
+        else
+            c->fanout_seq++;
+    }
+}
+
+/* send the shared packets which the client has not received yet, without
+   copying them */
+static int fanout_send(HTTPContext *c)
+{
+    FanOut *fo = c->fanout;
+    struct iovec iov[FANOUT_MAX_IOV];
+    int64_t seq;
+    int nb_iov = 0, len;
+
+    fanout_seek_client(c);
+    if (c->fanout_buf) {
+        iov[nb_iov].iov_base = c->fanout_buf->data + c->fanout_buf_pos;
+        iov[nb_iov].iov_len  = c->fanout_buf->size - c->fanout_buf_pos;
+        nb_iov++;
+    }
+    for (seq = c->fanout_seq; seq < fo->end_seq && nb_iov < FANOUT_MAX_IOV; seq++) {
+        AVBufferRef *buf = fo->chunks[seq % FANOUT_MAX_CHUNKS].buf;
+        iov[nb_iov].iov_base = buf->data;
+        iov[nb_iov].iov_len  = buf->size;
+        nb_iov++;
+    }
+
+    if (!nb_iov) {
+        /* everything was sent */
+        if (fo->eof)
+            return -1;
+        c->state = HTTPSTATE_WAIT_FEED;
+        return 0;
+    }
+
+    len = writev(c->fd, iov, nb_iov);
+    if (len < 0) {
+        if (ff_neterrno() != AVERROR(EAGAIN) &&
+            ff_neterrno() != AVERROR(EINTR))
+            /* error : close connection */
+            return -1;
+        return 0;
+    }
+    c->data_count += len;
+    update_datarate(&c->datarate, c->data_count);
+    c->stream->bytes_served += len;
+
+    /* release what was sent */
+    if (c->fanout_buf) {
+        int left = c->fanout_buf->size - c->fanout_buf_pos;
+        if (len < left) {
+            c->fanout_buf_pos += len;
+            return 0;
+        }
+        len -= left;
+        av_buffer_unref(&c->fanout_buf);
+    }
+    while (len > 0) {
+        AVBufferRef *buf = fo->chunks[c->fanout_seq++ % FANOUT_MAX_CHUNKS].buf;
+        if (len < buf->size) {
+            /* keep a reference to the packet in case it is dropped from
+               the queue before it is completely sent */
+            if (!(c->fanout_buf = av_buffer_ref(buf)))
+                return -1;
+            c->fanout_buf_pos = len;
+            break;
+        }
+        len -= buf->size;
+    }
+    return 0;
+}
+
+/* wake up the connections waiting for data from a feed */
+static void wake_up_feed_clients(FFStream *feed, int eof)
+{
+    enum HTTPState state = eof ? HTTPSTATE_SEND_DATA_TRAILER : HTTPSTATE_SEND_DATA;
+    HTTPContext *c;
+    FanOut *fo;
+
+    for (fo = first_fanout; fo; fo = fo->next) {
+        if (fo->src->state == HTTPSTATE_WAIT_FEED &&
+            fo->stream->feed == feed) {
+            fo->src->state = state;
+            fanout_fill(fo);
+        }
+    }
+
+    for(c = first_http_ctx; c; c = c->next) {
+        if (c->state == HTTPSTATE_WAIT_FEED && !c->fanout &&
+            c->stream->feed == feed) {
+            c->state = state;
+            update_poll_events(c);
+        }
+    }
+}
+
 static int http_start_receive_data(HTTPContext *c)
 {
     int fd;
@@ -2684,7 +3279,6 @@ static int http_start_receive_data(HTTPContext *c)
 
 static int http_receive_data(HTTPContext *c)
 {
-    HTTPContext *c1;
     int len, loop_run = 0;
 
     while (c->chunked_encoding && !c->chunk_size &&
@@ -2774,11 +3368,7 @@ static int http_receive_data(HTTPContext *c)
             }
 
             /* wake up any waiting connections */
-            for(c1 = first_http_ctx; c1; c1 = c1->next) {
-                if (c1->state == HTTPSTATE_WAIT_FEED &&
-                    c1->stream->feed == c->stream->feed)
-                    c1->state = HTTPSTATE_SEND_DATA;
-            }
+            wake_up_feed_clients(c->stream->feed, 0);
         } else {
             /* We have a header in our hands that contains useful data */
             AVFormatContext *s = avformat_alloc_context();
@@ -2830,11 +3420,7 @@ static int http_receive_data(HTTPContext *c)
     c->stream->feed_opened = 0;
     close(c->feed_fd);
     /* wake up any waiting connections to stop waiting for feed */
-    for(c1 = first_http_ctx; c1; c1 = c1->next) {
-        if (c1->state == HTTPSTATE_WAIT_FEED &&
-            c1->stream->feed == c->stream->feed)
-            c1->state = HTTPSTATE_SEND_DATA_TRAILER;
-    }
+    wake_up_feed_clients(c->stream->feed, 1);
     return -1;
 }
 
@@ -3382,6 +3968,8 @@ static HTTPContext *rtp_new_connection(struct sockaddr_in *from_addr,
 
     c->next = first_http_ctx;
     first_http_ctx = c;
+    c->next_rtp = first_rtp_ctx;
+    first_rtp_ctx = c;
     return c;
 
  fail:
@@ -4371,6 +4959,9 @@ static int parse_ffconfig(const char *filename)
         } else if (!av_strcasecmp(cmd, "StartSendOnKey")) {
             if (stream)
                 stream->send_on_key = 1;
+        } else if (!av_strcasecmp(cmd, "SharedOutput")) {
+            if (stream)
+                stream->shared_output = 1;
         } else if (!av_strcasecmp(cmd, "AudioCodec")) {
             get_arg(arg, sizeof(arg), &p);
             audio_id = opt_codec(arg, AVMEDIA_TYPE_AUDIO);
@@ -4719,6 +5310,23 @@ static const OptionDef options[] = {
     { NULL },
 };
 
+/* each client needs a socket, and a descriptor for the feed unless it
+ * receives a shared output: make sure MaxClients connections can be open */
+static void raise_file_limit(void)
+{
+#if HAVE_SETRLIMIT
+    struct rlimit rl;
+    rlim_t needed = 2 * (rlim_t)nb_max_connections + 64;
+
+    if (getrlimit(RLIMIT_NOFILE, &rl) < 0 ||
+        rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur >= needed)
+        return;
+    rl.rlim_cur = FFMIN(needed, rl.rlim_max);
+    if (setrlimit(RLIMIT_NOFILE, &rl) < 0)
+        http_log("Could not raise the limit of open files: %s\n", strerror(errno));
+#endif
+}
+
 int main(int argc, char **argv)
 {
     struct sigaction sigact = { { 0 } };
@@ -4766,6 +5374,8 @@ int main(int argc, char **argv)
 
     compute_bandwidth();
 
+    raise_file_limit();
+
     /* signal init */
     signal(SIGPIPE, SIG_IGN);
 
@@ -1873,7 +1873,13 @@ int attribute_align_arg avcodec_encode_audio2(AVCodecContext *avctx,
         }
     }
 
-    ret = avctx->codec->encode2(avctx, avpkt, frame, got_packet_ptr);
+    {
+        FF_PERF_TIMER_START(perf_start);
+        ret = avctx->codec->encode2(avctx, avpkt, frame, got_packet_ptr);
+        FF_PERF_TIMER_STOP("avcodec_encode_audio", perf_start);
+        if (!ret && *got_packet_ptr)
+            FF_PERF_COUNTER_ADD("avcodec_encode_audio_bytes", avpkt->size);
+    }
     if (!ret) {
         if (*got_packet_ptr) {
             if (!(avctx->codec->capabilities & CODEC_CAP_DELAY)) {
@@ -2094,7 +2100,13 @@ int attribute_align_arg avcodec_encode_video2(AVCodecContext *avctx,
 
     av_assert0(avctx->codec->encode2);
 
-    ret = avctx->codec->encode2(avctx, avpkt, frame, got_packet_ptr);
+    {
+        FF_PERF_TIMER_START(perf_start);
+        ret = avctx->codec->encode2(avctx, avpkt, frame, got_packet_ptr);
+        FF_PERF_TIMER_STOP("avcodec_encode_video", perf_start);
+        if (!ret && *got_packet_ptr)
+            FF_PERF_COUNTER_ADD("avcodec_encode_video_bytes", avpkt->size);
+    }
     av_assert0(ret <= 0);
 
     if (avpkt->data && avpkt->data == avctx->internal->byte_buffer) {
@@ -2334,6 +2346,7 @@ int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *pi
 
     if ((avctx->codec->capabilities & CODEC_CAP_DELAY) || avpkt->size || (avctx->active_thread_type & FF_THREAD_FRAME)) {
         int did_split = av_packet_split_side_data(&tmp);
+        FF_PERF_TIMER_START(perf_start);
         ret = apply_param_change(avctx, &tmp);
         if (ret < 0) {
             av_log(avctx, AV_LOG_ERROR, "Error applying parameter changes.\n");
@@ -2363,6 +2376,8 @@ int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *pi
             }
         }
         add_metadata_from_side_data(avctx, picture);
+        FF_PERF_TIMER_STOP("avcodec_decode_video", perf_start);
+        FF_PERF_COUNTER_ADD("avcodec_decode_video_bytes", tmp.size);
 
 fail:
         emms_c(); //needed to avoid an emms_c() call before every return;
@@ -2488,6 +2503,7 @@ int attribute_align_arg avcodec_decode_audio4(AVCodecContext *avctx,
         // copy to ensure we do not change avpkt
         AVPacket tmp = *avpkt;
         int did_split = av_packet_split_side_data(&tmp);
+        FF_PERF_TIMER_START(perf_start);
         ret = apply_param_change(avctx, &tmp);
         if (ret < 0) {
             av_log(avctx, AV_LOG_ERROR, "Error applying parameter changes.\n");
@@ -2502,6 +2518,8 @@ int attribute_align_arg avcodec_decode_audio4(AVCodecContext *avctx,
             ret = avctx->codec->decode(avctx, frame, got_frame_ptr, &tmp);
             frame->pkt_dts = avpkt->dts;
         }
+        FF_PERF_TIMER_STOP("avcodec_decode_audio", perf_start);
+        FF_PERF_COUNTER_ADD("avcodec_decode_audio_bytes", tmp.size);
         if (ret >= 0 && *got_frame_ptr) {
             add_metadata_from_side_data(avctx, frame);
             avctx->frame_number++;
@@ -2733,7 +2751,11 @@ int avcodec_decode_subtitle2(AVCodecContext *avctx, AVSubtitle *sub,
             if (avctx->pkt_timebase.den && avpkt->pts != AV_NOPTS_VALUE)
                 sub->pts = av_rescale_q(avpkt->pts,
                                         avctx->pkt_timebase, AV_TIME_BASE_Q);
-            ret = avctx->codec->decode(avctx, sub, got_sub_ptr, &pkt_recoded);
+            {
+                FF_PERF_TIMER_START(perf_start);
+                ret = avctx->codec->decode(avctx, sub, got_sub_ptr, &pkt_recoded);
+                FF_PERF_TIMER_STOP("avcodec_decode_subtitle", perf_start);
+            }
             av_assert1((ret >= 0) >= !!*got_sub_ptr &&
                        !!*got_sub_ptr >= !!sub->num_rects);
 
@@ -1095,7 +1095,11 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
             (dstctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC))
             filter_frame = default_filter_frame;
     }
-    ret = filter_frame(link, out);
+    {
+        FF_PERF_TIMER_START(perf_start);
+        ret = filter_frame(link, out);
+        FF_PERF_TIMER_STOP("avfilter_filter_frame", perf_start);
+    }
     link->frame_count++;
     link->frame_requested = 0;
     ff_update_link_current_pts(link, pts);
@@ -0,0 +1,572 @@
+/*
+ * Asynchronous read-ahead protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Reads the wrapped URL ahead into a ring buffer from a separate thread, so
+ * the caller only blocks when the buffer runs dry.
+ *
+ * Usage: async:<url>
+ */
+
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#elif HAVE_OS2THREADS
+#include "compat/os2threads.h"
+#endif
+
+#include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/error.h"
+#include "libavutil/fifo.h"
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+#include "avformat.h"
+#include "url.h"
+
+#define READ_CHUNK_SIZE (32 * 1024)
+
+typedef struct AsyncContext {
+    const AVClass  *class;
+    URLContext     *inner;
+
+    int             seek_request;
+    int64_t         seek_pos;
+    int             seek_completed;
+    int64_t         seek_ret;
+
+    int             io_error;
+    int             io_eof_reached;
+
+    int64_t         logical_pos;
+    int64_t         logical_size;
+    AVFifoBuffer   *fifo;
+    uint8_t        *read_buf;
+
+    pthread_cond_t  cond_wakeup_main;
+    pthread_cond_t  cond_wakeup_background;
+    pthread_mutex_t mutex;
+    pthread_t       async_buffer_thread;
+
+    int             abort_request;
+    AVIOInterruptCB interrupt_callback;
+
+    int             buffer_size;
+    int             short_seek_size;
+    int64_t         stall_time;
+    int             stall_count;
+} AsyncContext;
+
+static int async_check_interrupt(void *arg)
+{
+    URLContext   *h = arg;
+    AsyncContext *c = h->priv_data;
+
+    if (c->abort_request)
+        return 1;
+
+    if (ff_check_interrupt(&c->interrupt_callback))
+        c->abort_request = 1;
+
+    return c->abort_request;
+}
+
+static void *async_buffer_task(void *arg)
+{
+    URLContext   *h    = arg;
+    AsyncContext *c    = h->priv_data;
+    AVFifoBuffer *fifo = c->fifo;
+    int ret;
+
+    while (1) {
+        int to_read;
+
+        pthread_mutex_lock(&c->mutex);
+        if (async_check_interrupt(h)) {
+            c->io_eof_reached = 1;
+            c->io_error       = AVERROR_EXIT;
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_mutex_unlock(&c->mutex);
+            break;
+        }
+
+        if (c->seek_request) {
+            int64_t pos = ffurl_seek(c->inner, c->seek_pos, SEEK_SET);
+            if (pos >= 0) {
+                c->io_eof_reached = 0;
+                c->io_error       = 0;
+                av_fifo_reset(fifo);
+            }
+            c->seek_completed = 1;
+            c->seek_ret       = pos;
+            c->seek_request   = 0;
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_mutex_unlock(&c->mutex);
+            continue;
+        }
+
+        to_read = FFMIN(av_fifo_space(fifo), READ_CHUNK_SIZE);
+        if (c->io_eof_reached || to_read <= 0) {
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
+            pthread_mutex_unlock(&c->mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&c->mutex);
+
+        /* only this thread touches the inner context, so it can read
+         * without holding the lock */
+        ret = ffurl_read(c->inner, c->read_buf, to_read);
+
+        pthread_mutex_lock(&c->mutex);
+        if (ret <= 0) {
+            c->io_eof_reached = 1;
+            if (ret < 0 && ret != AVERROR_EOF)
+                c->io_error = ret;
+        } else if (!c->seek_request) {
+            /* data read before a pending seek is stale, drop it */
+            av_fifo_generic_write(fifo, c->read_buf, ret, NULL);
+        }
+        pthread_cond_signal(&c->cond_wakeup_main);
+        pthread_mutex_unlock(&c->mutex);
+    }
+
+    return NULL;
+}
+
+static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
+{
+    AsyncContext        *c = h->priv_data;
+    int                  ret;
+    AVIOInterruptCB      interrupt_callback = { .callback = async_check_interrupt, .opaque = h };
+
+    av_strstart(arg, "async:", &arg);
+
+    if (flags & AVIO_FLAG_WRITE) {
+        av_log(h, AV_LOG_ERROR, "Writing is not supported\n");
+        return AVERROR(ENOSYS);
+    }
+
+    c->fifo     = av_fifo_alloc(c->buffer_size);
+    c->read_buf = av_malloc(READ_CHUNK_SIZE);
+    if (!c->fifo || !c->read_buf) {
+        ret = AVERROR(ENOMEM);
+        goto fifo_fail;
+    }
+
+    /* wrap the interrupt callback, so closing can abort a blocking read */
+    c->interrupt_callback = h->interrupt_callback;
+    ret = ffurl_open(&c->inner, arg, flags, &interrupt_callback, options);
+    if (ret != 0) {
+        av_log(h, AV_LOG_ERROR, "ffurl_open failed : %s, %s\n", av_err2str(ret), arg);
+        goto url_fail;
+    }
+
+    c->logical_size = ffurl_size(c->inner);
+    h->is_streamed  = c->inner->is_streamed;
+
+    ret = pthread_mutex_init(&c->mutex, NULL);
+    if (ret != 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", av_err2str(AVERROR(ret)));
+        ret = AVERROR(ret);
+        goto mutex_fail;
+    }
+
+    ret = pthread_cond_init(&c->cond_wakeup_main, NULL);
+    if (ret != 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(AVERROR(ret)));
+        ret = AVERROR(ret);
+        goto cond_wakeup_main_fail;
+    }
+
+    ret = pthread_cond_init(&c->cond_wakeup_background, NULL);
+    if (ret != 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(AVERROR(ret)));
+        ret = AVERROR(ret);
+        goto cond_wakeup_background_fail;
+    }
+
+    ret = pthread_create(&c->async_buffer_thread, NULL, async_buffer_task, h);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(AVERROR(ret)));
+        ret = AVERROR(ret);
+        goto thread_fail;
+    }
+
+    return 0;
+
+thread_fail:
+    pthread_cond_destroy(&c->cond_wakeup_background);
+cond_wakeup_background_fail:
+    pthread_cond_destroy(&c->cond_wakeup_main);
+cond_wakeup_main_fail:
+    pthread_mutex_destroy(&c->mutex);
+mutex_fail:
+    ffurl_close(c->inner);
+url_fail:
+fifo_fail:
+    av_fifo_freep(&c->fifo);
+    av_freep(&c->read_buf);
+    return ret;
+}
+
+static int async_close(URLContext *h)
+{
+    AsyncContext *c = h->priv_data;
+    int ret;
+
+    pthread_mutex_lock(&c->mutex);
+    c->abort_request = 1;
+    pthread_cond_signal(&c->cond_wakeup_background);
+    pthread_mutex_unlock(&c->mutex);
+
+    ret = pthread_join(c->async_buffer_thread, NULL);
+    if (ret != 0)
+        av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(AVERROR(ret)));
+
+    av_log(h, AV_LOG_VERBOSE, "stalled %d times for %"PRId64" us in total\n",
+           c->stall_count, c->stall_time);
+
+    pthread_cond_destroy(&c->cond_wakeup_background);
+    pthread_cond_destroy(&c->cond_wakeup_main);
+    pthread_mutex_destroy(&c->mutex);
+    ffurl_close(c->inner);
+    av_fifo_freep(&c->fifo);
+    av_freep(&c->read_buf);
+
+    return 0;
+}
+
+/**
+ * Wait for the background thread, accounting the time as stall time.
+ * Must be called with the mutex locked.
+ */
+static void wait_background(AsyncContext *c, int *stalled)
+{
+    int64_t start = av_gettime_relative();
+
+    pthread_cond_signal(&c->cond_wakeup_background);
+    pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+
+    c->stall_time += av_gettime_relative() - start;
+    if (!*stalled) {
+        c->stall_count++;
+        *stalled = 1;
+    }
+}
+
+static int async_read(URLContext *h, unsigned char *buf, int size)
+{
+    AsyncContext *c    = h->priv_data;
+    AVFifoBuffer *fifo = c->fifo;
+    int ret = 0, stalled = 0;
+
+    pthread_mutex_lock(&c->mutex);
+    while (1) {
+        int fifo_size = av_fifo_size(fifo);
+
+        if (async_check_interrupt(h)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        if (fifo_size > 0) {
+            ret = FFMIN(size, fifo_size);
+            av_fifo_generic_read(fifo, buf, ret, NULL);
+            c->logical_pos += ret;
+            pthread_cond_signal(&c->cond_wakeup_background);
+            break;
+        }
+        if (c->io_eof_reached) {
+            ret = c->io_error ? c->io_error : AVERROR_EOF;
+            break;
+        }
+        wait_background(c, &stalled);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+static int64_t async_seek(URLContext *h, int64_t pos, int whence)
+{
+    AsyncContext *c    = h->priv_data;
+    AVFifoBuffer *fifo = c->fifo;
+    int64_t       ret;
+    int           stalled = 0;
+
+    if (whence == AVSEEK_SIZE) {
+        return c->logical_size;
+    } else if (whence == SEEK_CUR) {
+        pos += c->logical_pos;
+    } else if (whence == SEEK_END && c->logical_size > 0) {
+        pos += c->logical_size;
+    } else if (whence != SEEK_SET) {
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&c->mutex);
+
+    /* forward seeks close to the read position are served by discarding
+     * buffered data instead of seeking the inner context */
+    while (pos >= c->logical_pos && pos - c->logical_pos <= c->short_seek_size) {
+        int to_drain = FFMIN(av_fifo_size(fifo), pos - c->logical_pos);
+
+        av_fifo_drain(fifo, to_drain);
+        c->logical_pos += to_drain;
+        if (c->logical_pos == pos) {
+            pthread_cond_signal(&c->cond_wakeup_background);
+            pthread_mutex_unlock(&c->mutex);
+            return pos;
+        }
+        if (c->io_eof_reached || async_check_interrupt(h))
+            break;
+        wait_background(c, &stalled);
+    }
+
+    c->seek_request   = 1;
+    c->seek_pos       = pos;
+    c->seek_completed = 0;
+    c->seek_ret       = 0;
+
+    while (!c->seek_completed) {
+        if (async_check_interrupt(h)) {
+            pthread_mutex_unlock(&c->mutex);
+            return AVERROR_EXIT;
+        }
+        wait_background(c, &stalled);
+    }
+
+    ret = c->seek_ret;
+    if (ret >= 0)
+        c->logical_pos = ret;
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+#define OFFSET(x) offsetof(AsyncContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+
+static const AVOption options[] = {
+    { "async_buffer_size", "set the size of the read-ahead buffer", OFFSET(buffer_size),     AV_OPT_TYPE_INT, { .i64 = 4 * 1024 * 1024 }, READ_CHUNK_SIZE, INT_MAX / 2, D },
+    { "async_short_seek",  "set the maximum forward seek distance served by discarding buffered data",
+                                                                    OFFSET(short_seek_size), AV_OPT_TYPE_INT, { .i64 = 256 * 1024 },      0,               INT_MAX,     D },
+    { NULL },
+};
+
+static const AVClass async_context_class = {
+    .class_name = "Async",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+URLProtocol ff_async_protocol = {
+    .name                = "async",
+    .url_open2           = async_open,
+    .url_read            = async_read,
+    .url_seek            = async_seek,
+    .url_close           = async_close,
+    .priv_data_size      = sizeof(AsyncContext),
+    .priv_data_class     = &async_context_class,
+};
+
+#ifdef TEST
+
+#define TEST_SEEK_POS    (1536)
+#define TEST_STREAM_SIZE (2048)
+
+typedef struct TestContext {
+    AVClass        *class;
+    int64_t         logical_pos;
+    int64_t         logical_size;
+    int             delay;
+} TestContext;
+
+static int async_test_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
+{
+    TestContext *c = h->priv_data;
+    c->logical_pos  = 0;
+    c->logical_size = TEST_STREAM_SIZE;
+    return 0;
+}
+
+static int async_test_close(URLContext *h)
+{
+    return 0;
+}
+
+/* stands in for a slow server: every read takes a while and returns at
+ * most 100 bytes */
+static int async_test_read(URLContext *h, unsigned char *buf, int size)
+{
+    TestContext *c = h->priv_data;
+    int          i;
+    int          read_len = 0;
+
+    if (c->logical_pos >= c->logical_size)
+        return AVERROR_EOF;
+
+    if (c->delay)
+        av_usleep(c->delay);
+
+    size = FFMIN(size, 100);
+    for (i = 0; i < size; ++i) {
+        buf[i] = c->logical_pos & 0xFF;
+
+        c->logical_pos++;
+        read_len++;
+
+        if (c->logical_pos >= c->logical_size)
+            break;
+    }
+
+    return read_len;
+}
+
+static int64_t async_test_seek(URLContext *h, int64_t pos, int whence)
+{
+    TestContext *c = h->priv_data;
+    int64_t      new_logical_pos;
+
+    if (whence == AVSEEK_SIZE) {
+        return c->logical_size;
+    } else if (whence == SEEK_CUR) {
+        new_logical_pos = pos + c->logical_pos;
+    } else if (whence == SEEK_SET){
+        new_logical_pos = pos;
+    } else {
+        return AVERROR(EINVAL);
+    }
+    if (new_logical_pos < 0)
+        return AVERROR(EINVAL);
+
+    c->logical_pos = new_logical_pos;
+    return new_logical_pos;
+}
+
+static const AVOption async_test_options[] = {
+    { "async_test_delay", "delay of every read in microseconds", offsetof(TestContext, delay), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
+    { NULL },
+};
+
+static const AVClass async_test_context_class = {
+    .class_name = "Async-Test",
+    .item_name  = av_default_item_name,
+    .option     = async_test_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+URLProtocol ff_async_test_protocol = {
+    .name                = "async-test",
+    .url_open2           = async_test_open,
+    .url_read            = async_test_read,
+    .url_seek            = async_test_seek,
+    .url_close           = async_test_close,
+    .priv_data_size      = sizeof(TestContext),
+    .priv_data_class     = &async_test_context_class,
+};
+
+static int read_and_check(URLContext *h, int64_t *pos, int *check_failed)
+{
+    unsigned char buf[4096];
+    int64_t       read_len = 0;
+    int           i, ret;
+
+    while (1) {
+        ret = ffurl_read(h, buf, sizeof(buf));
+        if (ret == AVERROR_EOF || ret == 0)
+            break;
+        if (ret < 0) {
+            printf("read error: %s\n", av_err2str(ret));
+            return ret;
+        }
+        for (i = 0; i < ret; ++i) {
+            if (buf[i] != (*pos & 0xFF)) {
+                printf("read mismatch at %"PRId64": 0x%02x != 0x%02x\n",
+                       *pos, buf[i], (int)(*pos & 0xFF));
+                *check_failed = 1;
+                return read_len;
+            }
+            (*pos)++;
+        }
+        read_len += ret;
+    }
+    return read_len;
+}
+
+static int run_test(const char *name, int delay, int short_seek)
+{
+    URLContext   *h = NULL;
+    AVDictionary *opts = NULL;
+    int64_t       pos;
+    int64_t       read_len;
+    int           check_failed = 0;
+    int           ret;
+
+    printf("%s:\n", name);
+    av_dict_set_int(&opts, "async_test_delay", delay, 0);
+    av_dict_set_int(&opts, "async_short_seek", short_seek, 0);
+    ret = ffurl_open(&h, "async:async-test:", AVIO_FLAG_READ, NULL, &opts);
+    av_dict_free(&opts);
+    printf("open: %d\n", ret);
+
+    printf("size: %"PRId64"\n", ffurl_size(h));
+
+    pos = ffurl_seek(h, 0, SEEK_CUR);
+    read_len = read_and_check(h, &pos, &check_failed);
+    printf("read: %"PRId64"%s\n", read_len, check_failed ? " (check failed)" : "");
+
+    pos = ffurl_seek(h, TEST_SEEK_POS, SEEK_SET);
+    printf("seek: %"PRId64"\n", pos);
+    read_len = read_and_check(h, &pos, &check_failed);
+    printf("read: %"PRId64"%s\n", read_len, check_failed ? " (check failed)" : "");
+
+    pos = ffurl_seek(h, 0, SEEK_SET);
+    printf("seek: %"PRId64"\n", pos);
+    pos = ffurl_seek(h, 10, SEEK_CUR);
+    printf("seek: %"PRId64"\n", pos);
+    read_len = read_and_check(h, &pos, &check_failed);
+    printf("read: %"PRId64"%s\n", read_len, check_failed ? " (check failed)" : "");
+
+    ffurl_close(h);
+    return check_failed;
+}
+
+int main(void)
+{
+    int ret = 0;
+
+    av_register_all();
+    ffurl_register_protocol(&ff_async_test_protocol);
+
+    ret |= run_test("buffered", 0, 256 * 1024);
+    ret |= run_test("throttled", 1000, 0);
+
+    return ret;
+}
+
+#endif
@@ -1600,6 +1600,15 @@ typedef struct AVFormatContext {
      */
     char *format_whitelist;
 
+    /**
+     * Path of a file caching the keyframe index of the input between runs.
+     * The file is read when the streams are known and written back when the
+     * input is closed, if the index grew.
+     * - encoding: unused
+     * - decoding: set by user through AVOptions (NO direct access)
+     */
+    char *seek_index;
+
     /*****************************************************************
      * All fields below this line are not part of the public API. They
      * may not be used outside of libavformat and can be changed and
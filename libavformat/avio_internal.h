@@ -47,7 +47,8 @@ int ffio_init_context(AVIOContext *s,
  *    underlying buffer
  * @param size number of bytes requested
  * @param data address at which to store pointer: this will be a
- *    a direct pointer into the underlying buffer if the requested
+ *    a direct pointer into the underlying buffer or the mapping of the
+ *    protocol (see URLProtocol.url_get_mapping) if the requested
  *    number of bytes are available at contiguous addresses, otherwise
  *    will be a copy of buf
  * @return number of bytes read or AVERROR
@@ -562,12 +562,44 @@ int avio_read(AVIOContext *s, unsigned char *buf, int size)
     return size1 - size;
 }
 
+/**
+ * Return a pointer to size bytes at the current position *pos in the mapping
+ * of the underlying protocol, or NULL if there is none.
+ */
+static const uint8_t *mapped_data(AVIOContext *s, int size, int64_t *pos)
+{
+    URLContext *h = s->opaque;
+    const uint8_t *map;
+    int64_t map_size;
+
+    if (s->av_class != &ffio_url_class || s->write_flag || s->update_checksum ||
+        !h->prot->url_get_mapping || h->prot->url_get_mapping(h, &map, &map_size) < 0)
+        return NULL;
+    *pos = avio_tell(s);
+    if (*pos < 0 || *pos + size > map_size)
+        return NULL;
+    return map + *pos;
+}
+
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data)
 {
+    const uint8_t *map;
+    int64_t pos;
+
     if (s->buf_end - s->buf_ptr >= size && !s->write_flag) {
         *data = s->buf_ptr;
         s->buf_ptr += size;
         return size;
+    } else if ((map = mapped_data(s, size, &pos)) &&
+               s->seek(s->opaque, pos + size, SEEK_SET) >= 0) {
+        /* move past the data without filling the buffer; seeking only
+         * moves the read position of the mapping, so the data stays valid */
+        s->pos         = pos + size;
+        s->buf_ptr     =
+        s->buf_end     = s->buffer;
+        s->eof_reached = 0;
+        *data = map;
+        return size;
     } else {
         *data = buf;
         return avio_read(s, buf, size);
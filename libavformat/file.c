@@ -32,6 +32,9 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -44,6 +47,9 @@
 #  endif
 #endif
 
+/* read ahead hints are given for windows of this size */
+#define MMAP_ADVISE_SIZE (8 << 20)
+
 /* standard file protocol */
 
 typedef struct FileContext {
@@ -51,11 +57,17 @@ typedef struct FileContext {
     int fd;
     int trunc;
     int blocksize;
+    int use_mmap;
+    uint8_t *map;               ///< mapping of the whole file in mmap mode, NULL otherwise
+    int64_t map_size;
+    int64_t pos;                ///< read position in mmap mode
+    int64_t advised_end;        ///< end of the range read ahead hints were given for
 } FileContext;
 
 static const AVOption file_options[] = {
     { "truncate", "truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "memory map regular files opened for reading (truncating the file while it is mapped kills the process with SIGBUS)", offsetof(FileContext, use_mmap), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -78,11 +90,92 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+static void file_unmap(FileContext *c)
+{
+#if HAVE_MMAP
+    if (c->map)
+        munmap(c->map, c->map_size);
+#endif
+    c->map      = NULL;
+    c->map_size = 0;
+}
+
+static int file_map(FileContext *c, int64_t size)
+{
+#if HAVE_MMAP
+    void *map;
+
+    if (size <= 0 || size > SIZE_MAX)
+        return AVERROR(EINVAL);
+    map = mmap(NULL, size, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (map == MAP_FAILED)
+        return AVERROR(errno);
+#ifdef MADV_SEQUENTIAL
+    madvise(map, size, MADV_SEQUENTIAL);
+#endif
+    c->map         = map;
+    c->map_size    = size;
+    c->advised_end = 0;
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+/**
+ * Remap the file if it grew past the current mapping. If that fails, switch
+ * to plain reads from the current position.
+ */
+static int file_remap(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    struct stat st;
+    int ret;
+
+    if (fstat(c->fd, &st) < 0 || st.st_size <= c->map_size)
+        return 0;
+    file_unmap(c);
+    if ((ret = file_map(c, st.st_size)) < 0) {
+        av_log(h, AV_LOG_WARNING, "Cannot remap file, falling back to read(): %s\n",
+               av_err2str(ret));
+        if (lseek(c->fd, c->pos, SEEK_SET) < 0)
+            return AVERROR(errno);
+    }
+    return 0;
+}
+
+static void file_advise(FileContext *c)
+{
+#if HAVE_MMAP && defined(MADV_WILLNEED)
+    /* keep one window ahead of the read position in flight */
+    if (c->pos + MMAP_ADVISE_SIZE > c->advised_end) {
+        int64_t start = FFMAX(c->advised_end, c->pos & ~(int64_t)(MMAP_ADVISE_SIZE - 1));
+        int64_t end   = FFMIN(start + 2 * MMAP_ADVISE_SIZE, c->map_size);
+        if (end > start)
+            madvise(c->map + start, end - start, MADV_WILLNEED);
+        c->advised_end = end;
+    }
+#endif
+}
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int r;
     size = FFMIN(size, c->blocksize);
+    if (c->map) {
+        if (c->pos >= c->map_size && (r = file_remap(h)) < 0)
+            return r;
+    }
+    if (c->map) {
+        if (c->pos >= c->map_size)
+            return 0;
+        size = FFMIN(size, c->map_size - c->pos);
+        file_advise(c);
+        memcpy(buf, c->map + c->pos, size);
+        c->pos += size;
+        return size;
+    }
     r = read(c->fd, buf, size);
     return (-1 == r)?AVERROR(errno):r;
 }
@@ -96,6 +189,18 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     return (-1 == r)?AVERROR(errno):r;
 }
 
+static int file_get_mapping(URLContext *h, const uint8_t **data, int64_t *size)
+{
+    FileContext *c = h->priv_data;
+
+    if (!c->map)
+        return AVERROR(ENOSYS);
+    file_advise(c);
+    *data = c->map;
+    *size = c->map_size;
+    return 0;
+}
+
 static int file_get_handle(URLContext *h)
 {
     FileContext *c = h->priv_data;
@@ -163,6 +268,15 @@ static int file_open(URLContext *h, const char *filename, int flags)
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+    /* pipes and empty files that may still grow are read normally */
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE) && !h->is_streamed &&
+        S_ISREG(st.st_mode) && st.st_size > 0) {
+        int ret = file_map(c, st.st_size);
+        if (ret < 0)
+            av_log(h, AV_LOG_VERBOSE, "Cannot map file, using read(): %s\n",
+                   av_err2str(ret));
+    }
+
     return 0;
 }
 
@@ -172,10 +286,27 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
-    if (whence == AVSEEK_SIZE) {
+    if (whence == AVSEEK_SIZE || (c->map && whence == SEEK_END)) {
         struct stat st;
         ret = fstat(c->fd, &st);
-        return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
+        if (ret < 0)
+            return AVERROR(errno);
+        if (whence == AVSEEK_SIZE)
+            return S_ISFIFO(st.st_mode) ? 0 : st.st_size;
+        pos += st.st_size;
+        whence = SEEK_SET;
+    }
+
+    if (c->map) {
+        if (whence == SEEK_CUR)
+            pos += c->pos;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        /* no need to touch the file, reads past the mapping remap it */
+        c->pos = pos;
+        return pos;
     }
 
     ret = lseek(c->fd, pos, whence);
@@ -186,6 +317,7 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+    file_unmap(c);
     return close(c->fd);
 }
 
@@ -198,6 +330,7 @@ URLProtocol ff_file_protocol = {
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
+    .url_get_mapping     = file_get_mapping,
     .priv_data_size      = sizeof(FileContext),
     .priv_data_class     = &file_class,
 };
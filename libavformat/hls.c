@@ -26,6 +26,16 @@
  * http://tools.ietf.org/html/draft-pantos-http-live-streaming
  */
 
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#elif HAVE_OS2THREADS
+#include "compat/os2threads.h"
+#endif
+
 #include "libavutil/avstring.h"
 #include "libavutil/avassert.h"
 #include "libavutil/intreadwrite.h"
@@ -36,6 +46,7 @@
 #include "avformat.h"
 #include "internal.h"
 #include "avio_internal.h"
+#include "http.h"
 #include "url.h"
 #include "id3v2.h"
 
@@ -74,6 +85,23 @@ struct segment {
     uint8_t iv[16];
 };
 
+/*
+ * A segment downloaded ahead of the demuxer by the prefetch thread. The
+ * segment and key are copied so that the thread never accesses the segment
+ * list, which is replaced when the playlist is reloaded.
+ */
+struct prefetch {
+    struct segment seg;
+    uint8_t key[16];
+    uint8_t *data;
+    unsigned int data_alloc;
+    int size;       /* downloaded bytes */
+    int pos;        /* bytes read by the demuxer */
+    int started;
+    int done;       /* the download is complete, error holds its result */
+    int error;
+};
+
 struct rendition;
 
 enum PlaylistType {
@@ -92,6 +120,7 @@ struct playlist {
     AVIOContext pb;
     uint8_t* read_buffer;
     URLContext *input;
+    URLContext *idle_input; /* persistent HTTP connection between segments */
     AVFormatContext *parent;
     int index;
     AVFormatContext *ctx;
@@ -134,6 +163,30 @@ struct playlist {
      * multiple (playlist-less) renditions associated with them. */
     int n_renditions;
     struct rendition **renditions;
+
+#if HAVE_THREADS
+    /* Segment prefetching, see prefetch_thread(). The ring holds the
+     * segment being read followed by the segments downloaded ahead. */
+    struct prefetch *prefetch;
+    int prefetch_size;
+    int prefetch_first, nb_prefetch;
+    int prefetch_seq_no;            /* sequence number of the first entry */
+    struct prefetch *cur_prefetch;  /* segment read by the demuxer */
+    int prefetch_busy;              /* the thread is downloading */
+    int prefetch_cancel;            /* abort the running download */
+    int prefetch_abort;             /* stop the thread */
+    /* asynchronous live playlist reload */
+    int64_t reload_time;            /* when to download the playlist again */
+    int64_t reload_load_time;
+    uint8_t *reload_data;
+    uint8_t *reload_location;       /* URL of the reloaded playlist after redirections */
+    int reload_size;
+    int reload_error;
+    pthread_t prefetch_thread;
+    pthread_mutex_t prefetch_mutex;
+    pthread_cond_t prefetch_cond;
+    int prefetch_thread_started;
+#endif
 };
 
 /*
@@ -164,6 +217,7 @@ struct variant {
 };
 
 typedef struct HLSContext {
+    const AVClass *class;
     int n_variants;
     struct variant **variants;
     int n_playlists;
@@ -179,6 +233,8 @@ typedef struct HLSContext {
     char *user_agent;                    ///< holds HTTP user agent set as an AVOption to the HTTP protocol context
     char *cookies;                       ///< holds HTTP cookie values set in either the initial response or as an AVOption to the HTTP protocol context
     char *headers;                       ///< holds HTTP headers set as an AVOption to the HTTP protocol context
+    int prefetch_segments;
+    int http_persistent;
 } HLSContext;
 
 static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
@@ -201,11 +257,18 @@ static void free_segment_list(struct playlist *pls)
     pls->n_segments = 0;
 }
 
+#if HAVE_THREADS
+static void prefetch_stop(struct playlist *pls);
+#endif
+
 static void free_playlist_list(HLSContext *c)
 {
     int i;
     for (i = 0; i < c->n_playlists; i++) {
         struct playlist *pls = c->playlists[i];
+#if HAVE_THREADS
+        prefetch_stop(pls);
+#endif
         free_segment_list(pls);
         av_freep(&pls->renditions);
         av_freep(&pls->id3_buf);
@@ -215,6 +278,8 @@ static void free_playlist_list(HLSContext *c)
         av_freep(&pls->pb.buffer);
         if (pls->input)
             ffurl_close(pls->input);
+        if (pls->idle_input)
+            ffurl_close(pls->idle_input);
         if (pls->ctx) {
             pls->ctx->pb = NULL;
             avformat_close_input(&pls->ctx);
@@ -680,6 +745,37 @@ enum ReadFromURLMode {
     READ_COMPLETE,
 };
 
+#if HAVE_THREADS
+/* read the current segment from the prefetch buffer, waiting for the data
+ * that has not been downloaded yet */
+static int read_from_prefetch(struct playlist *pls, uint8_t *buf, int buf_size,
+                              enum ReadFromURLMode mode)
+{
+    struct prefetch *p = pls->cur_prefetch;
+    int len = 0, ret = 0;
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    while (len < buf_size) {
+        if (p->pos < p->size) {
+            int n = FFMIN(buf_size - len, p->size - p->pos);
+            memcpy(buf + len, p->data + p->pos, n);
+            p->pos += n;
+            len    += n;
+            if (mode == READ_NORMAL)
+                break;
+        } else if (p->done) {
+            ret = p->error;
+            break;
+        } else {
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_mutex);
+        }
+    }
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+
+    return len ? len : ret;
+}
+#endif
+
 /* read from URLContext, limiting read to current segment */
 static int read_from_url(struct playlist *pls, uint8_t *buf, int buf_size,
                          enum ReadFromURLMode mode)
@@ -691,6 +787,11 @@ static int read_from_url(struct playlist *pls, uint8_t *buf, int buf_size,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
+#if HAVE_THREADS
+    if (pls->cur_prefetch)
+        ret = read_from_prefetch(pls, buf, buf_size, mode);
+    else
+#endif
     if (mode == READ_COMPLETE)
         ret = ffurl_read_complete(pls->input, buf, buf_size);
     else
@@ -900,12 +1001,14 @@ static void intercept_id3(struct playlist *pls, uint8_t *buf,
         pls->is_id3_timestamped = (pls->id3_mpegts_timestamp != AV_NOPTS_VALUE);
 }
 
-static int open_input(HLSContext *c, struct playlist *pls)
+/* fetch the key of an encrypted segment, unless it is the current one */
+static void update_key(HLSContext *c, struct playlist *pls, struct segment *seg)
 {
     AVDictionary *opts = NULL;
-    AVDictionary *opts2 = NULL;
-    int ret;
-    struct segment *seg = pls->segments[pls->cur_seq_no - pls->start_seq_no];
+    URLContext *uc;
+
+    if (!strcmp(seg->key, pls->key_url))
+        return;
 
     // broker prior HTTP options that should be consistent across requests
     av_dict_set(&opts, "user-agent", c->user_agent, 0);
@@ -913,8 +1016,83 @@ static int open_input(HLSContext *c, struct playlist *pls)
     av_dict_set(&opts, "headers", c->headers, 0);
     av_dict_set(&opts, "seekable", "0", 0);
 
-    // Same opts for key request (ffurl_open mutilates the opts so it cannot be used twice)
-    av_dict_copy(&opts2, opts, 0);
+    if (ffurl_open(&uc, seg->key, AVIO_FLAG_READ,
+                   &pls->parent->interrupt_callback, &opts) == 0) {
+        if (ffurl_read_complete(uc, pls->key, sizeof(pls->key))
+            != sizeof(pls->key)) {
+            av_log(NULL, AV_LOG_ERROR, "Unable to read key file %s\n",
+                   seg->key);
+        }
+        ffurl_close(uc);
+    } else {
+        av_log(NULL, AV_LOG_ERROR, "Unable to open key file %s\n",
+               seg->key);
+    }
+    av_strlcpy(pls->key_url, seg->key, sizeof(pls->key_url));
+    av_dict_free(&opts);
+}
+
+#if CONFIG_HTTP_PROTOCOL
+/* check if the HTTP connection uc can be used to request url */
+static int can_reuse_connection(HLSContext *c, URLContext *uc, const char *url)
+{
+    char proto1[16], host1[MAX_URL_SIZE], proto2[16], host2[MAX_URL_SIZE];
+    int port1, port2;
+    uint8_t *location = NULL;
+
+    if (!c->http_persistent ||
+        strcmp(uc->prot->name, "http") && strcmp(uc->prot->name, "https"))
+        return 0;
+    /* the connection goes to the server of the last redirection */
+    if (av_opt_get(uc->priv_data, "location", 0, &location) < 0 || !location)
+        return 0;
+    av_url_split(proto1, sizeof(proto1), NULL, 0, host1, sizeof(host1),
+                 &port1, NULL, 0, location);
+    av_url_split(proto2, sizeof(proto2), NULL, 0, host2, sizeof(host2),
+                 &port2, NULL, 0, url);
+    av_free(location);
+
+    return !strcmp(proto1, proto2) && !av_strcasecmp(host1, host2) &&
+           port1 == port2;
+}
+#endif
+
+/*
+ * Open a segment. If *in is a persistent HTTP connection left open by a
+ * previous segment, the request is sent on it if possible, otherwise it is
+ * closed.
+ */
+static int open_url(HLSContext *c, struct playlist *pls, URLContext **in,
+                    const struct segment *seg, const uint8_t *key_data,
+                    const AVIOInterruptCB *int_cb)
+{
+    AVDictionary *opts = NULL;
+    int ret;
+
+    if (*in) {
+#if CONFIG_HTTP_PROTOCOL
+        if (seg->key_type == KEY_NONE && seg->size < 0 &&
+            can_reuse_connection(c, *in, seg->url)) {
+            av_log(pls->parent, AV_LOG_VERBOSE,
+                   "HLS request for url '%s', playlist %d, on persistent connection\n",
+                   seg->url, pls->index);
+            if (ff_http_do_new_request(*in, seg->url) >= 0)
+                return 0;
+            av_log(pls->parent, AV_LOG_DEBUG,
+                   "Persistent connection failed, reconnecting\n");
+        }
+#endif
+        ffurl_close(*in);
+        *in = NULL;
+    }
+
+    // broker prior HTTP options that should be consistent across requests
+    av_dict_set(&opts, "user-agent", c->user_agent, 0);
+    av_dict_set(&opts, "cookies", c->cookies, 0);
+    av_dict_set(&opts, "headers", c->headers, 0);
+    av_dict_set(&opts, "seekable", "0", 0);
+    if (c->http_persistent)
+        av_dict_set(&opts, "multiple_requests", "1", 0);
 
     if (seg->size >= 0) {
         /* try to restrict the HTTP request to the part we want
@@ -927,43 +1105,25 @@ static int open_input(HLSContext *c, struct playlist *pls)
            seg->url, seg->url_offset, pls->index);
 
     if (seg->key_type == KEY_NONE) {
-        ret = ffurl_open(&pls->input, seg->url, AVIO_FLAG_READ,
-                          &pls->parent->interrupt_callback, &opts);
+        ret = ffurl_open(in, seg->url, AVIO_FLAG_READ, int_cb, &opts);
 
     } else if (seg->key_type == KEY_AES_128) {
         char iv[33], key[33], url[MAX_URL_SIZE];
-        if (strcmp(seg->key, pls->key_url)) {
-            URLContext *uc;
-            if (ffurl_open(&uc, seg->key, AVIO_FLAG_READ,
-                           &pls->parent->interrupt_callback, &opts2) == 0) {
-                if (ffurl_read_complete(uc, pls->key, sizeof(pls->key))
-                    != sizeof(pls->key)) {
-                    av_log(NULL, AV_LOG_ERROR, "Unable to read key file %s\n",
-                           seg->key);
-                }
-                ffurl_close(uc);
-            } else {
-                av_log(NULL, AV_LOG_ERROR, "Unable to open key file %s\n",
-                       seg->key);
-            }
-            av_strlcpy(pls->key_url, seg->key, sizeof(pls->key_url));
-        }
         ff_data_to_hex(iv, seg->iv, sizeof(seg->iv), 0);
-        ff_data_to_hex(key, pls->key, sizeof(pls->key), 0);
+        ff_data_to_hex(key, key_data, sizeof(pls->key), 0);
         iv[32] = key[32] = '\0';
         if (strstr(seg->url, "://"))
             snprintf(url, sizeof(url), "crypto+%s", seg->url);
         else
             snprintf(url, sizeof(url), "crypto:%s", seg->url);
-        if ((ret = ffurl_alloc(&pls->input, url, AVIO_FLAG_READ,
-                               &pls->parent->interrupt_callback)) < 0)
+        if ((ret = ffurl_alloc(in, url, AVIO_FLAG_READ, int_cb)) < 0)
             goto cleanup;
-        av_opt_set(pls->input->priv_data, "key", key, 0);
-        av_opt_set(pls->input->priv_data, "iv", iv, 0);
+        av_opt_set((*in)->priv_data, "key", key, 0);
+        av_opt_set((*in)->priv_data, "iv", iv, 0);
 
-        if ((ret = ffurl_connect(pls->input, &opts)) < 0) {
-            ffurl_close(pls->input);
-            pls->input = NULL;
+        if ((ret = ffurl_connect(*in, &opts)) < 0) {
+            ffurl_close(*in);
+            *in = NULL;
             goto cleanup;
         }
         ret = 0;
@@ -975,22 +1135,45 @@ static int open_input(HLSContext *c, struct playlist *pls)
      * should already be where want it to, but this allows e.g. local testing
      * without a HTTP server. */
     if (ret == 0 && seg->key_type == KEY_NONE) {
-        int seekret = ffurl_seek(pls->input, seg->url_offset, SEEK_SET);
+        int seekret = ffurl_seek(*in, seg->url_offset, SEEK_SET);
         if (seekret < 0) {
             av_log(pls->parent, AV_LOG_ERROR, "Unable to seek to offset %"PRId64" of HLS segment '%s'\n", seg->url_offset, seg->url);
             ret = seekret;
-            ffurl_close(pls->input);
-            pls->input = NULL;
+            ffurl_close(*in);
+            *in = NULL;
         }
     }
 
 cleanup:
     av_dict_free(&opts);
-    av_dict_free(&opts2);
-    pls->cur_seg_offset = 0;
     return ret;
 }
 
+/* check if a connection that returned ret at the end of seg can be kept
+ * for the next request */
+static int keep_connection(HLSContext *c, URLContext *in,
+                           const struct segment *seg, int ret)
+{
+    /* only whole responses of known length leave the connection ready
+     * for a new request */
+    return c->http_persistent && (!ret || ret == AVERROR_EOF) &&
+           seg->size < 0 && ffurl_size(in) >= 0;
+}
+
+static int open_input(HLSContext *c, struct playlist *pls)
+{
+    struct segment *seg = pls->segments[pls->cur_seq_no - pls->start_seq_no];
+
+    if (seg->key_type == KEY_AES_128)
+        update_key(c, pls, seg);
+
+    pls->cur_seg_offset = 0;
+    pls->input      = pls->idle_input;
+    pls->idle_input = NULL;
+    return open_url(c, pls, &pls->input, seg, pls->key,
+                    &pls->parent->interrupt_callback);
+}
+
 static int64_t default_reload_interval(struct playlist *pls)
 {
     return pls->n_segments > 0 ?
@@ -998,6 +1181,379 @@ static int64_t default_reload_interval(struct playlist *pls)
                           pls->target_duration;
 }
 
+#if HAVE_THREADS
+static int prefetch_interrupt_cb(void *opaque)
+{
+    struct playlist *pls = opaque;
+    return pls->prefetch_cancel || pls->prefetch_abort ||
+           ff_check_interrupt(&pls->parent->interrupt_callback);
+}
+
+static struct prefetch *prefetch_entry(struct playlist *pls, int i)
+{
+    return &pls->prefetch[(pls->prefetch_first + i) % pls->prefetch_size];
+}
+
+static void free_prefetch_entry(struct prefetch *p)
+{
+    av_freep(&p->seg.url);
+    av_freep(&p->data);
+    memset(p, 0, sizeof(*p));
+}
+
+/* download a segment, called from the prefetch thread without the lock;
+ * if location is not NULL, it is set to the URL the data comes from after
+ * redirections, if the protocol reports it */
+static int download(HLSContext *c, struct playlist *pls, URLContext **conn,
+                    struct prefetch *p, uint8_t **location,
+                    const AVIOInterruptCB *int_cb)
+{
+    uint8_t buf[INITIAL_BUFFER_SIZE];
+    int64_t remaining = p->seg.size >= 0 ? p->seg.size : INT64_MAX;
+    int ret;
+
+    if ((ret = open_url(c, pls, conn, &p->seg, p->key, int_cb)) < 0)
+        return ret;
+    if (location && av_opt_get(*conn, "location", AV_OPT_SEARCH_CHILDREN, location) < 0)
+        *location = NULL;
+
+    while (remaining > 0) {
+        uint8_t *data;
+
+        ret = ffurl_read(*conn, buf, FFMIN(sizeof(buf), remaining));
+        if (ret <= 0)
+            break;
+        remaining -= ret;
+
+        pthread_mutex_lock(&pls->prefetch_mutex);
+        if (p->size > INT_MAX - ret ||
+            !(data = av_fast_realloc(p->data, &p->data_alloc, p->size + ret))) {
+            pthread_mutex_unlock(&pls->prefetch_mutex);
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        p->data = data;
+        memcpy(p->data + p->size, buf, ret);
+        p->size += ret;
+        pthread_cond_broadcast(&pls->prefetch_cond);
+        pthread_mutex_unlock(&pls->prefetch_mutex);
+    }
+
+    if (!keep_connection(c, *conn, &p->seg, ret))
+        ffurl_closep(conn);
+    return ret >= 0 || ret == AVERROR_EOF ? 0 : ret;
+}
+
+/*
+ * Download the queued segments in order and, for live streams, the
+ * playlist when it is due for a reload. The playlist is parsed by the
+ * demuxer thread in prefetch_reload().
+ */
+static void *prefetch_thread(void *arg)
+{
+    struct playlist *pls = arg;
+    HLSContext *c = pls->parent->priv_data;
+    AVIOInterruptCB int_cb = { prefetch_interrupt_cb, pls };
+    URLContext *conn = NULL;
+    struct prefetch reload;
+    uint8_t *location;
+    int i, ret;
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    while (!pls->prefetch_abort) {
+        struct prefetch *p = NULL;
+        int64_t now;
+
+        for (i = 0; i < pls->nb_prefetch && !p; i++)
+            if (!prefetch_entry(pls, i)->started)
+                p = prefetch_entry(pls, i);
+        if (p) {
+            p->started = pls->prefetch_busy = 1;
+            pthread_mutex_unlock(&pls->prefetch_mutex);
+            ret = download(c, pls, &conn, p, NULL, &int_cb);
+            pthread_mutex_lock(&pls->prefetch_mutex);
+            p->done  = 1;
+            p->error = ret;
+            pls->prefetch_busy = 0;
+            pthread_cond_broadcast(&pls->prefetch_cond);
+            continue;
+        }
+
+        now = av_gettime();
+        if (pls->reload_time == AV_NOPTS_VALUE ||
+            pls->reload_data || pls->reload_error) {
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_mutex);
+        } else if (now < pls->reload_time) {
+            int64_t delay = FFMIN(pls->reload_time - now, 20000);
+            pthread_mutex_unlock(&pls->prefetch_mutex);
+            av_usleep(delay);
+            pthread_mutex_lock(&pls->prefetch_mutex);
+        } else {
+            memset(&reload, 0, sizeof(reload));
+            reload.seg.url  = pls->url;
+            reload.seg.size = -1;
+            pls->reload_time   = AV_NOPTS_VALUE;
+            pls->prefetch_busy = 1;
+            location = NULL;
+            pthread_mutex_unlock(&pls->prefetch_mutex);
+            ret = download(c, pls, &conn, &reload, &location, &int_cb);
+            pthread_mutex_lock(&pls->prefetch_mutex);
+            pls->prefetch_busy = 0;
+            if (pls->prefetch_cancel) {
+                av_free(reload.data);
+                av_free(location);
+            } else {
+                pls->reload_data      = reload.data;
+                pls->reload_location  = location;
+                pls->reload_size      = reload.size;
+                pls->reload_error     = ret < 0 ? ret : !reload.size ? AVERROR_INVALIDDATA : 0;
+                pls->reload_load_time = now;
+            }
+            pthread_cond_broadcast(&pls->prefetch_cond);
+        }
+    }
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+
+    ffurl_close(conn);
+    return NULL;
+}
+
+static void prefetch_schedule_reload(struct playlist *pls)
+{
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    pls->reload_time = pls->finished ? AV_NOPTS_VALUE :
+                       pls->last_load_time + default_reload_interval(pls);
+    pthread_cond_broadcast(&pls->prefetch_cond);
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+}
+
+static int prefetch_start(struct playlist *pls, int size)
+{
+    int ret;
+
+    if (!(pls->prefetch = av_mallocz_array(size, sizeof(*pls->prefetch))))
+        return AVERROR(ENOMEM);
+    pls->prefetch_size = size;
+    pls->reload_time   = AV_NOPTS_VALUE;
+
+    if ((ret = pthread_mutex_init(&pls->prefetch_mutex, NULL))) {
+        av_log(pls->parent, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", av_err2str(AVERROR(ret)));
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&pls->prefetch_cond, NULL))) {
+        av_log(pls->parent, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(AVERROR(ret)));
+        pthread_mutex_destroy(&pls->prefetch_mutex);
+        goto fail;
+    }
+    if ((ret = pthread_create(&pls->prefetch_thread, NULL, prefetch_thread, pls))) {
+        av_log(pls->parent, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&pls->prefetch_cond);
+        pthread_mutex_destroy(&pls->prefetch_mutex);
+        goto fail;
+    }
+    pls->prefetch_thread_started = 1;
+    prefetch_schedule_reload(pls);
+    return 0;
+
+fail:
+    av_freep(&pls->prefetch);
+    return AVERROR(ret);
+}
+
+static void prefetch_stop(struct playlist *pls)
+{
+    int i, ret;
+
+    if (pls->prefetch_thread_started) {
+        pthread_mutex_lock(&pls->prefetch_mutex);
+        pls->prefetch_abort = 1;
+        pthread_cond_broadcast(&pls->prefetch_cond);
+        pthread_mutex_unlock(&pls->prefetch_mutex);
+
+        if ((ret = pthread_join(pls->prefetch_thread, NULL)))
+            av_log(pls->parent, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&pls->prefetch_cond);
+        pthread_mutex_destroy(&pls->prefetch_mutex);
+        pls->prefetch_thread_started = 0;
+    }
+    for (i = 0; i < pls->nb_prefetch; i++)
+        free_prefetch_entry(prefetch_entry(pls, i));
+    av_freep(&pls->prefetch);
+    av_freep(&pls->reload_data);
+    av_freep(&pls->reload_location);
+}
+
+/* abort the running download and drop the prefetched data */
+static void prefetch_flush(struct playlist *pls)
+{
+    int i;
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    pls->prefetch_cancel = 1;
+    while (pls->prefetch_busy)
+        pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_mutex);
+    pls->prefetch_cancel = 0;
+
+    for (i = 0; i < pls->nb_prefetch; i++)
+        free_prefetch_entry(prefetch_entry(pls, i));
+    pls->prefetch_first = pls->nb_prefetch = 0;
+    pls->cur_prefetch   = NULL;
+    av_freep(&pls->reload_data);
+    av_freep(&pls->reload_location);
+    pls->reload_error = 0;
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+}
+
+/* queue the segments following the ones already in the ring */
+static int prefetch_queue(HLSContext *c, struct playlist *pls)
+{
+    int seq_no = pls->prefetch_seq_no + pls->nb_prefetch;
+
+    while (pls->nb_prefetch < pls->prefetch_size &&
+           seq_no >= pls->start_seq_no &&
+           seq_no <  pls->start_seq_no + pls->n_segments) {
+        struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+        struct prefetch *p;
+        char *url = av_strdup(seg->url);
+
+        if (!url)
+            return AVERROR(ENOMEM);
+        /* the key is fetched here, the thread does not access the playlist */
+        if (seg->key_type == KEY_AES_128)
+            update_key(c, pls, seg);
+
+        pthread_mutex_lock(&pls->prefetch_mutex);
+        p = prefetch_entry(pls, pls->nb_prefetch++);
+        p->seg     = *seg;
+        p->seg.url = url;
+        p->seg.key = NULL;
+        memcpy(p->key, pls->key, sizeof(p->key));
+        pthread_cond_broadcast(&pls->prefetch_cond);
+        pthread_mutex_unlock(&pls->prefetch_mutex);
+        seq_no++;
+    }
+    return 0;
+}
+
+/* start reading the current segment from the prefetch ring */
+static int prefetch_open(HLSContext *c, struct playlist *pls)
+{
+    int ret;
+
+    if (!pls->prefetch &&
+        (ret = prefetch_start(pls, c->prefetch_segments + 1)) < 0)
+        return ret;
+
+    if (pls->nb_prefetch && pls->prefetch_seq_no != pls->cur_seq_no)
+        prefetch_flush(pls);
+    if (!pls->nb_prefetch)
+        pls->prefetch_seq_no = pls->cur_seq_no;
+    if ((ret = prefetch_queue(c, pls)) < 0)
+        return ret;
+
+    pls->cur_prefetch   = prefetch_entry(pls, 0);
+    pls->cur_seg_offset = 0;
+    return 0;
+}
+
+/* drop the segment that has been read */
+static void prefetch_next(struct playlist *pls)
+{
+    struct prefetch *p = pls->cur_prefetch;
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    if (p->started && !p->done) {
+        /* a byte range segment may be read before its download is over */
+        pls->prefetch_cancel = 1;
+        while (pls->prefetch_busy)
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_mutex);
+        pls->prefetch_cancel = 0;
+    }
+    free_prefetch_entry(p);
+    pls->prefetch_first = (pls->prefetch_first + 1) % pls->prefetch_size;
+    pls->nb_prefetch--;
+    pls->prefetch_seq_no++;
+    pls->cur_prefetch = NULL;
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+}
+
+/* reload the playlist, using the copy downloaded by the prefetch thread */
+static int prefetch_reload(HLSContext *c, struct playlist *pls)
+{
+    AVIOContext pb;
+    uint8_t *data, *location;
+    int64_t load_time;
+    int size, ret;
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    if (!pls->reload_data && !pls->reload_error) {
+        int64_t now = av_gettime();
+        if (pls->reload_time == AV_NOPTS_VALUE || pls->reload_time > now)
+            pls->reload_time = now;
+        pthread_cond_broadcast(&pls->prefetch_cond);
+        while (!pls->reload_data && !pls->reload_error)
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_mutex);
+    }
+    data      = pls->reload_data;
+    location  = pls->reload_location;
+    size      = pls->reload_size;
+    ret       = pls->reload_error;
+    load_time = pls->reload_load_time;
+    pls->reload_data     = NULL;
+    pls->reload_location = NULL;
+    pls->reload_error    = 0;
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+
+    if (ret >= 0) {
+        /* parse_playlist() looks for AVOptions in the context, the memory
+         * context has none, so pass the URL after redirections ourselves */
+        memset(&pb, 0, sizeof(pb));
+        ffio_init_context(&pb, data, size, 0, NULL, NULL, NULL, NULL);
+        ret = parse_playlist(c, location && *location ? (const char *)location : pls->url,
+                             pls, &pb);
+        if (ret >= 0)
+            pls->last_load_time = load_time;
+    }
+    av_free(data);
+    av_free(location);
+
+    prefetch_schedule_reload(pls);
+    return ret;
+}
+#endif
+
+/* close the segment, read until ret was returned */
+static void close_input(HLSContext *c, struct playlist *pls, int ret)
+{
+    struct segment *seg = pls->segments[pls->cur_seq_no - pls->start_seq_no];
+
+#if HAVE_THREADS
+    if (pls->cur_prefetch) {
+        prefetch_next(pls);
+        return;
+    }
+#endif
+    if (keep_connection(c, pls->input, seg, ret)) {
+        ffurl_close(pls->idle_input);
+        pls->idle_input = pls->input;
+    } else {
+        ffurl_close(pls->input);
+    }
+    pls->input = NULL;
+}
+
+/* stop reading the current segment and drop the prefetched ones */
+static void reset_input(struct playlist *pls)
+{
+    if (pls->input)
+        ffurl_close(pls->input);
+    pls->input = NULL;
+#if HAVE_THREADS
+    if (pls->prefetch)
+        prefetch_flush(pls);
+#endif
+}
+
 static int read_data(void *opaque, uint8_t *buf, int buf_size)
 {
     struct playlist *v = opaque;
@@ -1009,7 +1565,11 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input) {
+    if (!v->input
+#if HAVE_THREADS
+        && !v->cur_prefetch
+#endif
+        ) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1036,7 +1596,13 @@ restart:
 reload:
         if (!v->finished &&
             av_gettime() - v->last_load_time >= reload_interval) {
-            if ((ret = parse_playlist(c, v->url, v, NULL)) < 0) {
+#if HAVE_THREADS
+            if (v->prefetch)
+                ret = prefetch_reload(c, v);
+            else
+#endif
+            ret = parse_playlist(c, v->url, v, NULL);
+            if (ret < 0) {
                 av_log(v->parent, AV_LOG_WARNING, "Failed to reload playlist %d\n",
                        v->index);
                 return ret;
@@ -1064,6 +1630,11 @@ reload:
             goto reload;
         }
 
+#if HAVE_THREADS
+        if (c->prefetch_segments)
+            ret = prefetch_open(c, v);
+        else
+#endif
         ret = open_input(c, v);
         if (ret < 0) {
             av_log(v->parent, AV_LOG_WARNING, "Failed to open segment of playlist %d\n",
@@ -1083,8 +1654,7 @@ reload:
 
         return ret;
     }
-    ffurl_close(v->input);
-    v->input = NULL;
+    close_input(c, v, ret);
     v->cur_seq_no++;
 
     c->cur_seq_no = v->cur_seq_no;
@@ -1238,6 +1808,13 @@ static int hls_read_header(AVFormatContext *s)
 
     c->interrupt_callback = &s->interrupt_callback;
 
+#if !HAVE_THREADS
+    if (c->prefetch_segments) {
+        av_log(s, AV_LOG_WARNING, "Segment prefetching requires threads support\n");
+        c->prefetch_segments = 0;
+    }
+#endif
+
     c->first_packet = 1;
     c->first_timestamp = AV_NOPTS_VALUE;
     c->cur_timestamp = AV_NOPTS_VALUE;
@@ -1453,9 +2030,7 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             }
             av_log(s, AV_LOG_INFO, "Now receiving playlist %d, segment %d\n", i, pls->cur_seq_no);
         } else if (first && !pls->cur_needed && pls->needed) {
-            if (pls->input)
-                ffurl_close(pls->input);
-            pls->input = NULL;
+            reset_input(pls);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -1656,10 +2231,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
     for (i = 0; i < c->n_playlists; i++) {
         /* Reset reading */
         struct playlist *pls = c->playlists[i];
-        if (pls->input) {
-            ffurl_close(pls->input);
-            pls->input = NULL;
-        }
+        reset_input(pls);
         av_free_packet(&pls->pkt);
         reset_packet(&pls->pkt);
         pls->pb.eof_reached = 0;
@@ -1702,6 +2274,23 @@ static int hls_probe(AVProbeData *p)
     return 0;
 }
 
+#define OFFSET(x) offsetof(HLSContext, x)
+#define FLAGS AV_OPT_FLAG_DECODING_PARAM
+static const AVOption hls_options[] = {
+    {"prefetch_segments", "number of segments to download ahead in a background thread",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 100, FLAGS},
+    {"http_persistent", "use persistent HTTP connections",
+        OFFSET(http_persistent), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, FLAGS},
+    {NULL}
+};
+
+static const AVClass hls_class = {
+    .class_name = "hls,applehttp",
+    .item_name  = av_default_item_name,
+    .option     = hls_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVInputFormat ff_hls_demuxer = {
     .name           = "hls,applehttp",
     .long_name      = NULL_IF_CONFIG_SMALL("Apple HTTP Live Streaming"),
@@ -1711,4 +2300,199 @@ AVInputFormat ff_hls_demuxer = {
     .read_packet    = hls_read_packet,
     .read_close     = hls_close,
     .read_seek      = hls_read_seek,
+    .priv_class     = &hls_class,
+};
+
+#ifdef TEST
+
+#include "libavutil/adler32.h"
+#include "libavutil/file.h"
+
+#define TEST_SERVER "hls-test://server/"
+
+/* directory holding out.m3u8 and its segments, as written by the muxer */
+static const char *test_dir;
+static int nb_live_requests;
+
+typedef struct TestContext {
+    AVClass *class;
+    char    *location;
+    uint8_t *data;
+    int64_t  size, pos;
+} TestContext;
+
+static int test_load(TestContext *c, const char *name)
+{
+    char path[1024];
+    uint8_t *buf;
+    size_t size;
+    int ret;
+
+    snprintf(path, sizeof(path), "%s/%s", test_dir, name);
+    if ((ret = av_file_map(path, &buf, &size, 0, NULL)) < 0)
+        return ret;
+    c->data = av_memdup(buf, size);
+    c->size = size;
+    av_file_unmap(buf, size);
+    return c->data ? 0 : AVERROR(ENOMEM);
+}
+
+/*
+ * Stands in for a server which redirects the media playlist to another
+ * directory, like a CDN would. The first request for the playlist only
+ * gets its first two segments, as if the stream was live, so that the
+ * demuxer has to reload it.
+ */
+static int hls_test_open(URLContext *h, const char *url, int flags)
+{
+    static const char master[] = "#EXTM3U\n"
+                                 "#EXT-X-STREAM-INF:BANDWIDTH=100000\n"
+                                 "live.m3u8\n";
+    TestContext *c = h->priv_data;
+    const char *path;
+    int i, ret, nb_uris = 0;
+
+    if (!av_strstart(url, TEST_SERVER, &path))
+        return AVERROR(ENOENT);
+    /* like http, always report a location */
+    if (!(c->location = av_strdup(url)))
+        return AVERROR(ENOMEM);
+    if (!strcmp(path, "master.m3u8")) {
+        c->size = strlen(master);
+        return (c->data = av_memdup(master, c->size)) ? 0 : AVERROR(ENOMEM);
+    }
+    if (!strcmp(path, "live.m3u8")) {
+        av_free(c->location);
+        if (!(c->location = av_strdup(TEST_SERVER "redir/live.m3u8")))
+            return AVERROR(ENOMEM);
+        path = "redir/live.m3u8";
+    }
+    /* everything but the media playlist is only found after the redirection */
+    if (!av_strstart(path, "redir/", &path))
+        return AVERROR(ENOENT);
+    if (!strcmp(path, "live.m3u8")) {
+        if ((ret = test_load(c, "out.m3u8")) < 0)
+            return ret;
+        for (i = 0; i < c->size && !nb_live_requests; i++) {
+            if (i && c->data[i - 1] != '\n')
+                continue;
+            if (nb_uris == 2)
+                c->size = i;
+            else if (c->data[i] != '#')
+                nb_uris++;
+        }
+        nb_live_requests++;
+        return 0;
+    }
+    return test_load(c, path);
+}
+
+static int hls_test_read(URLContext *h, unsigned char *buf, int size)
+{
+    TestContext *c = h->priv_data;
+
+    size = FFMIN(size, c->size - c->pos);
+    if (size <= 0)
+        return AVERROR_EOF;
+    memcpy(buf, c->data + c->pos, size);
+    c->pos += size;
+    return size;
+}
+
+static int64_t hls_test_seek(URLContext *h, int64_t pos, int whence)
+{
+    TestContext *c = h->priv_data;
+
+    if (whence == AVSEEK_SIZE)
+        return c->size;
+    if (whence == SEEK_CUR)
+        pos += c->pos;
+    else if (whence == SEEK_END)
+        pos += c->size;
+    else if (whence != SEEK_SET)
+        return AVERROR(EINVAL);
+    if (pos < 0 || pos > c->size)
+        return AVERROR(EINVAL);
+    return c->pos = pos;
+}
+
+static int hls_test_close(URLContext *h)
+{
+    TestContext *c = h->priv_data;
+
+    av_freep(&c->data);
+    return 0;
+}
+
+static const AVOption hls_test_options[] = {
+    { "location", "URL after redirections", offsetof(TestContext, location), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS },
+    { NULL },
 };
+
+static const AVClass hls_test_context_class = {
+    .class_name = "HLS-Test",
+    .item_name  = av_default_item_name,
+    .option     = hls_test_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+URLProtocol ff_hls_test_protocol = {
+    .name            = "hls-test",
+    .url_open        = hls_test_open,
+    .url_read        = hls_test_read,
+    .url_seek        = hls_test_seek,
+    .url_close       = hls_test_close,
+    .priv_data_size  = sizeof(TestContext),
+    .priv_data_class = &hls_test_context_class,
+};
+
+static int run_test(const char *name, int prefetch_segments, uint32_t *crc)
+{
+    AVFormatContext *s = NULL;
+    AVDictionary *opts = NULL;
+    AVPacket pkt;
+    int ret, nb_packets = 0;
+
+    nb_live_requests = 0;
+    *crc = 0;
+    av_dict_set_int(&opts, "prefetch_segments", prefetch_segments, 0);
+    av_dict_set_int(&opts, "http_persistent", 1, 0);
+    ret = avformat_open_input(&s, TEST_SERVER "master.m3u8",
+                              av_find_input_format("hls"), &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        printf("%s: open: %s\n", name, av_err2str(ret));
+        return ret;
+    }
+    while ((ret = av_read_frame(s, &pkt)) >= 0) {
+        *crc = av_adler32_update(*crc, (const uint8_t *)&pkt.pts, sizeof(pkt.pts));
+        *crc = av_adler32_update(*crc, pkt.data, pkt.size);
+        nb_packets++;
+        av_free_packet(&pkt);
+    }
+    avformat_close_input(&s);
+    printf("%s: %d packets, %d playlist requests, crc 0x%08"PRIx32"\n",
+           name, nb_packets, nb_live_requests, *crc);
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t plain, prefetch;
+    int ret;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <dir with out.m3u8 and segments>\n", argv[0]);
+        return 1;
+    }
+    test_dir = argv[1];
+    av_register_all();
+    ffurl_register_protocol(&ff_hls_test_protocol);
+
+    if ((ret = run_test("plain", 0, &plain)) < 0 ||
+        (ret = run_test("prefetch", 2, &prefetch)) < 0)
+        return 1;
+    return plain != prefetch;
+}
+
+#endif
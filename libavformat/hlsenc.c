@@ -31,6 +31,7 @@
 
 #include "avformat.h"
 #include "internal.h"
+#include "segment_finalize.h"
 
 typedef struct HLSSegment {
     char filename[1024];
@@ -44,6 +45,10 @@ typedef struct HLSSegment {
 typedef enum HLSFlags {
     // Generate a single media file and use byte ranges in the playlist.
     HLS_SINGLE_FILE = (1 << 0),
+    // Close segments and write the playlist in a background thread.
+    HLS_ASYNC_FINALIZE = (1 << 1),
+    // Sync segments and playlist to stable storage.
+    HLS_FSYNC = (1 << 2),
 } HLSFlags;
 
 typedef struct HLSContext {
@@ -79,6 +84,7 @@ typedef struct HLSContext {
     AVDictionary *format_options;
 
     AVIOContext *pb;
+    SegmentFinalizer *finalizer;
 } HLSContext;
 
 static int hls_mux_init(AVFormatContext *s)
@@ -156,51 +162,78 @@ static void hls_free_segments(HLSContext *hls)
     }
 }
 
-static int hls_window(AVFormatContext *s, int last)
+static void hls_window_print(AVFormatContext *s, AVIOContext *pb, int last)
 {
     HLSContext *hls = s->priv_data;
     HLSSegment *en;
     int target_duration = 0;
-    int ret = 0;
     int64_t sequence = FFMAX(hls->start_sequence, hls->sequence - hls->nb_entries);
     int version = hls->flags & HLS_SINGLE_FILE ? 4 : 3;
 
-    if ((ret = avio_open2(&hls->pb, s->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
-        goto fail;
-
     for (en = hls->segments; en; en = en->next) {
         if (target_duration < en->duration)
             target_duration = ceil(en->duration);
     }
 
-    avio_printf(hls->pb, "#EXTM3U\n");
-    avio_printf(hls->pb, "#EXT-X-VERSION:%d\n", version);
+    avio_printf(pb, "#EXTM3U\n");
+    avio_printf(pb, "#EXT-X-VERSION:%d\n", version);
     if (hls->allowcache == 0 || hls->allowcache == 1) {
-        avio_printf(hls->pb, "#EXT-X-ALLOW-CACHE:%s\n", hls->allowcache == 0 ? "NO" : "YES");
+        avio_printf(pb, "#EXT-X-ALLOW-CACHE:%s\n", hls->allowcache == 0 ? "NO" : "YES");
     }
-    avio_printf(hls->pb, "#EXT-X-TARGETDURATION:%d\n", target_duration);
-    avio_printf(hls->pb, "#EXT-X-MEDIA-SEQUENCE:%"PRId64"\n", sequence);
+    avio_printf(pb, "#EXT-X-TARGETDURATION:%d\n", target_duration);
+    avio_printf(pb, "#EXT-X-MEDIA-SEQUENCE:%"PRId64"\n", sequence);
 
     av_log(s, AV_LOG_VERBOSE, "EXT-X-MEDIA-SEQUENCE:%"PRId64"\n",
            sequence);
 
     for (en = hls->segments; en; en = en->next) {
-        avio_printf(hls->pb, "#EXTINF:%f,\n", en->duration);
+        avio_printf(pb, "#EXTINF:%f,\n", en->duration);
         if (hls->flags & HLS_SINGLE_FILE)
-             avio_printf(hls->pb, "#EXT-X-BYTERANGE:%"PRIi64"@%"PRIi64"\n",
+             avio_printf(pb, "#EXT-X-BYTERANGE:%"PRIi64"@%"PRIi64"\n",
                          en->size, en->pos);
         if (hls->baseurl)
-            avio_printf(hls->pb, "%s", hls->baseurl);
-        avio_printf(hls->pb, "%s\n", en->filename);
+            avio_printf(pb, "%s", hls->baseurl);
+        avio_printf(pb, "%s\n", en->filename);
     }
 
     if (last)
-        avio_printf(hls->pb, "#EXT-X-ENDLIST\n");
+        avio_printf(pb, "#EXT-X-ENDLIST\n");
+}
+
+static int hls_window(AVFormatContext *s, int last)
+{
+    HLSContext *hls = s->priv_data;
+    int ret;
+
+    if ((ret = avio_open2(&hls->pb, s->filename, AVIO_FLAG_WRITE,
+                          &s->interrupt_callback, NULL)) < 0)
+        return ret;
+
+    hls_window_print(s, hls->pb, last);
 
-fail:
     avio_closep(&hls->pb);
-    return ret;
+    return 0;
+}
+
+/* Hand the segment that just ended over to the finalizer, which writes the
+ * playlist listing it once the segment is closed. */
+static int hls_finalize_segment(AVFormatContext *s, int last)
+{
+    HLSContext *hls = s->priv_data;
+    AVFormatContext *oc = hls->avf;
+    AVIOContext *pb;
+    uint8_t *buf;
+    int size, ret;
+
+    if ((ret = avio_open_dyn_buf(&pb)) < 0)
+        return ret;
+    hls_window_print(s, pb, last);
+    size = avio_close_dyn_buf(pb, &buf);
+
+    /* a single file stays open until the end */
+    return ff_segment_finalizer_submit(hls->finalizer,
+                                       last || !(hls->flags & HLS_SINGLE_FILE) ? &oc->pb : NULL,
+                                       oc->filename, buf, size, 0);
 }
 
 static int hls_start(AVFormatContext *s)
@@ -289,6 +322,13 @@ static int hls_write_header(AVFormatContext *s)
     if ((ret = hls_mux_init(s)) < 0)
         goto fail;
 
+    if (hls->flags & (HLS_ASYNC_FINALIZE | HLS_FSYNC)) {
+        if ((ret = ff_segment_finalizer_alloc(&hls->finalizer, s, s->filename,
+                                              hls->flags & HLS_FSYNC,
+                                              hls->flags & HLS_ASYNC_FINALIZE)) < 0)
+            goto fail;
+    }
+
     if ((ret = hls_start(s)) < 0)
         goto fail;
 
@@ -310,6 +350,7 @@ fail:
     av_dict_free(&options);
     if (ret) {
         av_free(hls->basename);
+        ff_segment_finalizer_free(&hls->finalizer);
         if (hls->avf)
             avformat_free_context(hls->avf);
     }
@@ -357,13 +398,18 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         hls->end_pts = pkt->pts;
         hls->duration = 0;
 
+        if (hls->finalizer) {
+            if ((ret = hls_finalize_segment(s, 0)) < 0)
+                return ret;
+        } else if (!(hls->flags & HLS_SINGLE_FILE)) {
+            avio_close(oc->pb);
+        }
+
         if (hls->flags & HLS_SINGLE_FILE) {
             if (hls->avf->oformat->priv_class && hls->avf->priv_data)
                 av_opt_set(hls->avf->priv_data, "mpegts_flags", "resend_headers", 0);
             hls->number++;
         } else {
-            avio_close(oc->pb);
-
             ret = hls_start(s);
         }
 
@@ -372,7 +418,7 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
 
         oc = hls->avf;
 
-        if ((ret = hls_window(s, 0)) < 0)
+        if (!hls->finalizer && (ret = hls_window(s, 0)) < 0)
             return ret;
     }
 
@@ -385,18 +431,24 @@ static int hls_write_trailer(struct AVFormatContext *s)
 {
     HLSContext *hls = s->priv_data;
     AVFormatContext *oc = hls->avf;
+    int ret = 0;
 
     av_write_trailer(oc);
     hls->size = avio_tell(hls->avf->pb) - hls->start_pos;
-    avio_closep(&oc->pb);
+    hls_append_segment(hls, hls->duration, hls->start_pos, hls->size);
+    if (hls->finalizer) {
+        hls_finalize_segment(s, 1);
+        ret = ff_segment_finalizer_free(&hls->finalizer);
+    } else {
+        avio_closep(&oc->pb);
+        hls_window(s, 1);
+    }
     avformat_free_context(oc);
     av_free(hls->basename);
-    hls_append_segment(hls, hls->duration, hls->start_pos, hls->size);
-    hls_window(s, 1);
 
     hls_free_segments(hls);
     avio_close(hls->pb);
-    return 0;
+    return ret;
 }
 
 #define OFFSET(x) offsetof(HLSContext, x)
@@ -411,6 +463,8 @@ static const AVOption options[] = {
     {"hls_base_url",  "url to prepend to each playlist entry",   OFFSET(baseurl), AV_OPT_TYPE_STRING, {.str = NULL},  0, 0,       E},
     {"hls_flags",     "set flags affecting HLS playlist and media file generation", OFFSET(flags), AV_OPT_TYPE_FLAGS, {.i64 = 0 }, 0, UINT_MAX, E, "flags"},
     {"single_file",   "generate a single media file indexed with byte ranges", 0, AV_OPT_TYPE_CONST, {.i64 = HLS_SINGLE_FILE }, 0, UINT_MAX,   E, "flags"},
+    {"async_finalize", "close segments and write the playlist in a background thread", 0, AV_OPT_TYPE_CONST, {.i64 = HLS_ASYNC_FINALIZE }, 0, UINT_MAX, E, "flags"},
+    {"fsync",         "sync segments to stable storage before listing them", 0, AV_OPT_TYPE_CONST, {.i64 = HLS_FSYNC }, 0, UINT_MAX, E, "flags"},
 
     { NULL },
 };
@@ -21,12 +21,17 @@
 
 #include "config.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #if CONFIG_ZLIB
 #include <zlib.h>
 #endif /* CONFIG_ZLIB */
 
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -45,6 +50,14 @@
 #define BUFFER_SIZE   MAX_URL_SIZE
 #define MAX_REDIRECTS 8
 
+/* Idle connections kept in the connection pool, for all hosts together. */
+#define POOL_MAX_IDLE     32
+/* Idle connections are dropped after this time, in microseconds, to stay
+ * below the keep-alive timeout of common servers. */
+#define POOL_IDLE_TIMEOUT 4000000
+/* Largest response body left which is read to make a connection reusable. */
+#define MAX_DRAIN_SIZE    (64 * 1024)
+
 typedef struct {
     const AVClass *class;
     URLContext *hd;
@@ -54,6 +67,11 @@ typedef struct {
     /* Used if "Transfer-Encoding: chunked" otherwise -1. */
     int64_t chunksize;
     int64_t off, end_off, filesize;
+    /* Content-Length of the response, -1 if not sent. */
+    int64_t content_length;
+    /* Offset following the body of the response, which is not the end of
+     * the file for a range request, -1 if unknown. */
+    int64_t body_end;
     char *location;
     HTTPAuthState auth_state;
     HTTPAuthState proxy_auth_state;
@@ -72,6 +90,19 @@ typedef struct {
     int end_header;
     /* A flag which indicates if we use persistent connections. */
     int multiple_requests;
+    /* Take connections from and return them to the process-wide pool. */
+    int connection_pool;
+    /* Lower protocol URL identifying the pooled connections usable. */
+    char *pool_key;
+    /* Set if the connection was taken from the pool. */
+    int reused;
+    /* Set if the server keeps the connection open after the response. */
+    int keep_alive;
+    /* Set if the last chunk of a chunked response has been read. */
+    int chunk_end;
+    /* Buffer for a chunk of an upload with its framing. */
+    uint8_t *chunk_buf;
+    unsigned int chunk_buf_size;
     uint8_t *post_data;
     int post_datalen;
     int is_akamai;
@@ -108,6 +139,7 @@ static const AVOption options[] = {
     { "user_agent", "override User-Agent header", OFFSET(user_agent), AV_OPT_TYPE_STRING, { .str = DEFAULT_USER_AGENT }, 0, 0, D },
     { "user-agent", "override User-Agent header", OFFSET(user_agent), AV_OPT_TYPE_STRING, { .str = DEFAULT_USER_AGENT }, 0, 0, D },
     { "multiple_requests", "use persistent connections", OFFSET(multiple_requests), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, D | E },
+    { "connection_pool", "reuse idle connections to the same server across requests", OFFSET(connection_pool), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, D | E },
     { "post_data", "set custom HTTP post data", OFFSET(post_data), AV_OPT_TYPE_BINARY, .flags = D | E },
     { "mime_type", "export the MIME type", OFFSET(mime_type), AV_OPT_TYPE_STRING, { 0 }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { "cookies", "set cookies to be sent in applicable future requests, use newline delimited Set-Cookie HTTP field value syntax", OFFSET(cookies), AV_OPT_TYPE_STRING, { 0 }, 0, 0, D },
@@ -130,6 +162,162 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                         const char *hoststr, const char *auth,
                         const char *proxyauth, int *new_location);
 
+typedef struct PooledConnection {
+    char key[1024];
+    URLContext *hd;
+    int64_t idle_since;
+    struct PooledConnection *next;
+} PooledConnection;
+
+/* Process-wide pool of idle connections, protected by pool_lock. */
+#if HAVE_PTHREADS
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static PooledConnection *pool;  ///< most recently released first
+static int pool_size;
+static int64_t pool_requests, pool_reused;
+
+static void lock_pool(void)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&pool_lock);
+#endif
+}
+
+static void unlock_pool(void)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&pool_lock);
+#endif
+}
+
+/* Check that the server has not closed an idle connection or sent
+ * unexpected data on it. */
+static int connection_alive(URLContext *hd)
+{
+    struct pollfd p = { ffurl_get_file_handle(hd), POLLIN, 0 };
+
+    return p.fd >= 0 && !poll(&p, 1, 0);
+}
+
+/* Requests on a pooled connection are short exchanges; do not let the end
+ * of an upload wait for the acknowledgement of its data. */
+static void set_nodelay(URLContext *hd)
+{
+    int fd = ffurl_get_file_handle(hd), one = 1;
+
+    if (fd >= 0)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/**
+ * Take an idle connection to key from the pool, dropping the connections
+ * which have been idle for too long.
+ */
+static URLContext *pool_get(URLContext *h, const char *key)
+{
+    PooledConnection **p, *conn, *expired;
+    URLContext *hd;
+    int64_t now, requests, reused;
+
+    do {
+        hd      = NULL;
+        expired = NULL;
+        now     = av_gettime_relative();
+
+        lock_pool();
+        for (p = &pool; *p;) {
+            conn = *p;
+            if (now - conn->idle_since > POOL_IDLE_TIMEOUT) {
+                *p          = conn->next;
+                conn->next  = expired;
+                expired     = conn;
+                pool_size--;
+            } else if (!hd && !strcmp(conn->key, key)) {
+                *p = conn->next;
+                hd = conn->hd;
+                av_free(conn);
+                pool_size--;
+            } else {
+                p = &conn->next;
+            }
+        }
+        unlock_pool();
+
+        while (expired) {
+            conn    = expired;
+            expired = conn->next;
+            ffurl_close(conn->hd);
+            av_free(conn);
+        }
+        if (hd && !connection_alive(hd))
+            ffurl_closep(&hd);
+        else
+            break;
+    } while (1);
+
+    lock_pool();
+    requests = ++pool_requests;
+    reused   = hd ? ++pool_reused : pool_reused;
+    unlock_pool();
+    av_log(h, AV_LOG_VERBOSE, "%s connection to %s, %"PRId64" of %"PRId64" requests reused\n",
+           hd ? "Reusing" : "Opening", key, reused, requests);
+
+    if (hd)
+        hd->interrupt_callback = h->interrupt_callback;
+    return hd;
+}
+
+static void pool_put(URLContext *hd, const char *key)
+{
+    PooledConnection *conn = av_mallocz(sizeof(*conn)), **p, *evicted = NULL;
+
+    if (!conn) {
+        ffurl_close(hd);
+        return;
+    }
+    av_strlcpy(conn->key, key, sizeof(conn->key));
+    conn->hd         = hd;
+    conn->idle_since = av_gettime_relative();
+    /* the interrupt callback may not outlive the context which set it */
+    hd->interrupt_callback = (AVIOInterruptCB){ NULL, NULL };
+
+    lock_pool();
+    conn->next = pool;
+    pool       = conn;
+    if (++pool_size > POOL_MAX_IDLE) {
+        for (p = &pool; (*p)->next; p = &(*p)->next)
+            ;
+        evicted = *p;
+        *p      = NULL;
+        pool_size--;
+    }
+    unlock_pool();
+
+    if (evicted) {
+        ffurl_close(evicted->hd);
+        av_free(evicted);
+    }
+}
+
+void ff_http_close_idle_connections(void)
+{
+    PooledConnection *conn;
+
+    lock_pool();
+    conn      = pool;
+    pool      = NULL;
+    pool_size = 0;
+    unlock_pool();
+
+    while (conn) {
+        PooledConnection *next = conn->next;
+        ffurl_close(conn->hd);
+        av_free(conn);
+        conn = next;
+    }
+}
+
 void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
 {
     memcpy(&((HTTPContext *)dest->priv_data)->auth_state,
@@ -148,6 +336,7 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char path1[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
     int port, use_proxy, err, location_changed = 0;
+    int64_t off;
     HTTPContext *s = h->priv_data;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
@@ -186,14 +375,44 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
     if (!s->hd) {
+        s->reused = 0;
+        /* TLS connections are not pooled, the interrupt callback of their
+         * inner TCP connection could not be updated */
+        if (s->connection_pool && !strcmp(lower_proto, "tcp")) {
+            av_free(s->pool_key);
+            if (!(s->pool_key = av_strdup(buf)))
+                return AVERROR(ENOMEM);
+            s->hd     = pool_get(h, buf);
+            s->reused = !!s->hd;
+        }
+        if (!s->hd) {
+            err = ffurl_open(&s->hd, buf, AVIO_FLAG_READ_WRITE,
+                             &h->interrupt_callback, options);
+            if (err < 0)
+                return err;
+            if (s->pool_key)
+                set_nodelay(s->hd);
+        }
+    }
+
+    off        = s->off;
+    s->buf_ptr = s->buf_end = s->buffer;
+    err = http_connect(h, path, local_path, hoststr,
+                       auth, proxyauth, &location_changed);
+    if (err < 0 && s->reused && s->buf_end == s->buffer) {
+        /* the server closed the pooled connection before replying */
+        av_log(h, AV_LOG_VERBOSE, "Pooled connection to %s failed, reconnecting\n", buf);
+        ffurl_closep(&s->hd);
+        s->reused = 0;
+        s->off    = off;
         err = ffurl_open(&s->hd, buf, AVIO_FLAG_READ_WRITE,
                          &h->interrupt_callback, options);
         if (err < 0)
             return err;
+        set_nodelay(s->hd);
+        err = http_connect(h, path, local_path, hoststr,
+                           auth, proxyauth, &location_changed);
     }
-
-    err = http_connect(h, path, local_path, hoststr,
-                       auth, proxyauth, &location_changed);
     if (err < 0)
         return err;
 
@@ -376,11 +595,13 @@ static int parse_location(HTTPContext *s, const char *p)
 static void parse_content_range(URLContext *h, const char *p)
 {
     HTTPContext *s = h->priv_data;
-    const char *slash;
+    const char *slash, *dash;
 
     if (!strncmp(p, "bytes ", 6)) {
         p     += 6;
         s->off = strtoll(p, NULL, 10);
+        if ((dash = strchr(p, '-')))
+            s->body_end = strtoll(dash + 1, NULL, 10) + 1;
         if ((slash = strchr(p, '/')) && strlen(slash) > 0)
             s->filesize = strtoll(slash + 1, NULL, 10);
     }
@@ -464,6 +685,7 @@ static int process_line(URLContext *h, char *line, int line_count,
         while (av_isspace(*p))
             p++;
         s->http_code = strtol(p, &end, 10);
+        s->keep_alive = av_strstart(line, "HTTP/1.1", NULL);
 
         av_log(h, AV_LOG_DEBUG, "http_code=%d\n", s->http_code);
 
@@ -484,8 +706,10 @@ static int process_line(URLContext *h, char *line, int line_count,
             if ((ret = parse_location(s, p)) < 0)
                 return ret;
             *new_location = 1;
-        } else if (!av_strcasecmp(tag, "Content-Length") && s->filesize == -1) {
-            s->filesize = strtoll(p, NULL, 10);
+        } else if (!av_strcasecmp(tag, "Content-Length")) {
+            s->content_length = strtoll(p, NULL, 10);
+            if (s->filesize == -1)
+                s->filesize = s->content_length;
         } else if (!av_strcasecmp(tag, "Content-Range")) {
             parse_content_range(h, p);
         } else if (!av_strcasecmp(tag, "Accept-Ranges") &&
@@ -505,6 +729,8 @@ static int process_line(URLContext *h, char *line, int line_count,
         } else if (!av_strcasecmp(tag, "Connection")) {
             if (!strcmp(p, "close"))
                 s->willclose = 1;
+            else if (!av_strcasecmp(p, "keep-alive"))
+                s->keep_alive = 1;
         } else if (!av_strcasecmp(tag, "Server")) {
             if (!av_strcasecmp(p, "AkamaiGHost")) {
                 s->is_akamai = 1;
@@ -671,6 +897,11 @@ static int http_read_header(URLContext *h, int *new_location)
     if (s->seekable == -1 && s->is_mediagateway && s->filesize == 2000000000)
         h->is_streamed = 1; /* we can in fact _not_ seek */
 
+    if (s->content_length >= 0)
+        s->body_end = s->off + s->content_length;
+    else if (s->body_end < 0 && s->http_code == 206 && s->end_off)
+        s->body_end = s->end_off;
+
     return err;
 }
 
@@ -742,7 +973,7 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                            "Expect: 100-continue\r\n");
 
     if (!has_header(s->headers, "\r\nConnection: ")) {
-        if (s->multiple_requests)
+        if (s->multiple_requests || s->connection_pool)
             len += av_strlcpy(headers + len, "Connection: keep-alive\r\n",
                               sizeof(headers) - len);
         else
@@ -806,7 +1037,11 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
     s->off              = 0;
     s->icy_data_read    = 0;
     s->filesize         = -1;
+    s->content_length   = -1;
+    s->body_end         = -1;
     s->willclose        = 0;
+    s->keep_alive       = 0;
+    s->chunk_end        = 0;
     s->end_chunked_post = 0;
     s->end_header       = 0;
     if (post && !s->post_data && !send_expect_100) {
@@ -903,6 +1138,8 @@ static int http_read_stream(URLContext *h, uint8_t *buf, int size)
     }
 
     if (s->chunksize >= 0) {
+        if (s->chunk_end)
+            return 0;
         if (!s->chunksize) {
             char line[32];
 
@@ -916,8 +1153,10 @@ static int http_read_stream(URLContext *h, uint8_t *buf, int size)
                 av_dlog(NULL, "Chunked encoding data size: %"PRId64"'\n",
                         s->chunksize);
 
-                if (!s->chunksize)
+                if (!s->chunksize) {
+                    s->chunk_end = 1;
                     return 0;
+                }
         }
         size = FFMIN(size, s->chunksize);
     }
@@ -1037,12 +1276,18 @@ static int http_write(URLContext *h, const uint8_t *buf, int size)
     /* silently ignore zero-size data since chunk encoding that would
      * signal EOF */
     if (size > 0) {
-        /* upload data using chunked encoding */
-        snprintf(temp, sizeof(temp), "%x\r\n", size);
+        /* upload data using chunked encoding, sending each chunk in a
+         * single write so that its framing is not delayed separately */
+        int len = snprintf(temp, sizeof(temp), "%x\r\n", size);
+
+        av_fast_malloc(&s->chunk_buf, &s->chunk_buf_size, len + size + 2);
+        if (!s->chunk_buf)
+            return AVERROR(ENOMEM);
+        memcpy(s->chunk_buf, temp, len);
+        memcpy(s->chunk_buf + len, buf, size);
+        memcpy(s->chunk_buf + len + size, crlf, 2);
 
-        if ((ret = ffurl_write(s->hd, temp, strlen(temp))) < 0 ||
-            (ret = ffurl_write(s->hd, buf, size)) < 0          ||
-            (ret = ffurl_write(s->hd, crlf, sizeof(crlf) - 1)) < 0)
+        if ((ret = ffurl_write(s->hd, s->chunk_buf, len + size + 2)) < 0)
             return ret;
     }
     return size;
@@ -1064,6 +1309,73 @@ static int http_shutdown(URLContext *h, int flags)
     return ret;
 }
 
+/**
+ * Read the rest of the response, so that the connection can be used for
+ * another request.
+ *
+ * @return 0 if the connection can be reused, a negative value otherwise
+ */
+static int http_drain(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    uint8_t buf[1024];
+    char line[MAX_URL_SIZE];
+    int len, total = 0, err;
+
+    if (s->willclose || !s->keep_alive || s->icy_metaint > 0 ||
+        (s->chunksize < 0 && s->body_end < 0) ||
+        (s->method && !av_strcasecmp(s->method, "HEAD")))
+        return AVERROR(EINVAL);
+#if CONFIG_ZLIB
+    if (s->compressed)
+        return AVERROR(EINVAL);
+#endif
+
+    while (s->chunksize >= 0 ? !s->chunk_end : s->off < s->body_end) {
+        len = http_read_stream(h, buf, s->chunksize >= 0 ? sizeof(buf) :
+                               FFMIN(sizeof(buf), s->body_end - s->off));
+        if (len < 0 || (!len && !s->chunk_end))
+            return len < 0 ? len : AVERROR_EOF;
+        if ((total += len) > MAX_DRAIN_SIZE)
+            return AVERROR(EINVAL);
+    }
+    /* skip the trailer of a chunked response */
+    if (s->chunk_end) {
+        do {
+            if ((err = http_get_line(s, line, sizeof(line))) < 0)
+                return err;
+        } while (*line);
+    }
+
+    return s->buf_ptr == s->buf_end ? 0 : AVERROR(EINVAL);
+}
+
+/**
+ * Return the connection to the pool if the response has been or can be
+ * read completely.
+ *
+ * @return a negative value if the server rejected an upload, 0 otherwise
+ */
+static int http_release_connection(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    int err, new_location;
+
+    if (!s->end_header) {
+        /* without chunked encoding, the end of an upload is not marked */
+        if (!s->end_chunked_post)
+            return 0;
+        if ((err = http_read_header(h, &new_location)) < 0)
+            return err;
+    }
+    if (http_drain(h) < 0)
+        return 0;
+
+    pool_put(s->hd, s->pool_key);
+    s->hd = NULL;
+    return 0;
+}
+
 static int http_close(URLContext *h)
 {
     int ret = 0;
@@ -1078,8 +1390,12 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
+    if (s->hd && s->pool_key && ret >= 0)
+        ret = http_release_connection(h);
     if (s->hd)
         ffurl_closep(&s->hd);
+    av_freep(&s->pool_key);
+    av_freep(&s->chunk_buf);
     av_dict_free(&s->chained_options);
     return ret;
 }
@@ -1291,3 +1607,196 @@ URLProtocol ff_httpproxy_protocol = {
     .flags               = URL_PROTOCOL_FLAG_NETWORK,
 };
 #endif /* CONFIG_HTTPPROXY_PROTOCOL */
+
+#ifdef TEST
+
+#define TEST_FILE_SIZE 1000
+
+static int test_port, nb_connections;
+static int64_t deadline;
+
+#if HAVE_PTHREADS
+static pthread_mutex_t test_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static int read_request(int fd, char *buf, int size)
+{
+    int len = 0, ret;
+
+    while (len < size - 1) {
+        if ((ret = recv(fd, buf + len, size - 1 - len, 0)) <= 0)
+            return -1;
+        len     += ret;
+        buf[len] = 0;
+        if (strstr(buf, "\r\n\r\n"))
+            return 0;
+    }
+    return -1;
+}
+
+/*
+ * Answer a request on fd like a HTTP/1.1 server would, the file is
+ * TEST_FILE_SIZE bytes long. "/nolength" is sent without its length,
+ * "/stale" is not answered unless it is the first request on the
+ * connection, as if the server closed an idle connection just as the
+ * request arrived.
+ *
+ * @return 0 to wait for another request on the connection, 1 to close it,
+ *         -1 to stop the server
+ */
+static int serve_request(int fd, int first)
+{
+    char req[4096], head[256];
+    uint8_t body[TEST_FILE_SIZE];
+    const char *range;
+    int64_t start = 0, end = TEST_FILE_SIZE - 1;
+    int i, len;
+
+    if (read_request(fd, req, sizeof(req)) < 0)
+        return 1;
+    if (av_strstart(req, "GET /quit ", NULL))
+        return -1;
+    if (av_strstart(req, "GET /stale ", NULL) && !first)
+        return 1;
+    for (i = 0; i < TEST_FILE_SIZE; i++)
+        body[i] = i;
+
+    if (av_strstart(req, "GET /nolength ", NULL)) {
+        len = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\n\r\n");
+    } else if ((range = strstr(req, "\r\nRange: bytes="))) {
+        sscanf(range + 15, "%"SCNd64"-%"SCNd64, &start, &end);
+        len = snprintf(head, sizeof(head),
+                       "HTTP/1.1 206 Partial Content\r\n"
+                       "Content-Range: bytes %"PRId64"-%"PRId64"/%d\r\n"
+                       "Content-Length: %"PRId64"\r\n\r\n",
+                       start, end, TEST_FILE_SIZE, end - start + 1);
+    } else {
+        len = snprintf(head, sizeof(head),
+                       "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n",
+                       TEST_FILE_SIZE);
+    }
+    if (send(fd, head, len, 0) != len ||
+        send(fd, body + start, end - start + 1, 0) != end - start + 1)
+        return 1;
+    return 0;
+}
+
+#if HAVE_PTHREADS
+/* one connection at a time is all a client making one request at a time
+ * needs */
+static void *server_thread(void *arg)
+{
+    int listen_fd = *(int *)arg, fd, first, ret = 0;
+
+    while (ret >= 0 && (fd = accept(listen_fd, NULL, NULL)) >= 0) {
+        pthread_mutex_lock(&test_lock);
+        nb_connections++;
+        pthread_mutex_unlock(&test_lock);
+        for (first = 1; !(ret = serve_request(fd, first)); first = 0)
+            ;
+        closesocket(fd);
+    }
+    return NULL;
+}
+#endif
+
+static int test_interrupt_cb(void *opaque)
+{
+    return av_gettime_relative() > deadline;
+}
+
+static int test_request(const char *name, const char *path,
+                        int64_t offset, int64_t end_offset, int nb_read)
+{
+    AVIOInterruptCB int_cb = { test_interrupt_cb, NULL };
+    AVDictionary *opts = NULL;
+    URLContext *h = NULL;
+    uint8_t buf[TEST_FILE_SIZE];
+    char url[256];
+    int i, ret, len = 0, check_failed = 0, connections;
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d%s", test_port, path);
+    av_dict_set_int(&opts, "connection_pool", 1, 0);
+    av_dict_set_int(&opts, "offset", offset, 0);
+    av_dict_set_int(&opts, "end_offset", end_offset, 0);
+    /* a request waiting for data which never comes fails instead of hanging */
+    deadline = av_gettime_relative() + 5000000;
+    ret = ffurl_open(&h, url, AVIO_FLAG_READ, &int_cb, &opts);
+    av_dict_free(&opts);
+    if (ret >= 0) {
+        while (len < nb_read && (ret = ffurl_read(h, buf + len, nb_read - len)) > 0)
+            len += ret;
+        for (i = 0; i < len; i++)
+            if (buf[i] != ((offset + i) & 0xFF))
+                check_failed = 1;
+        ret = ffurl_close(h);
+    }
+    if (av_gettime_relative() > deadline)
+        check_failed = 1;
+
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&test_lock);
+#endif
+    connections = nb_connections;
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&test_lock);
+#endif
+    printf("%s: read %d, %d connections%s\n", name, len, connections,
+           check_failed ? " (check failed)" : ret < 0 ? " (error)" : "");
+    return check_failed || ret < 0;
+}
+
+int main(void)
+{
+#if HAVE_PTHREADS
+    struct sockaddr_in addr = { 0 };
+    socklen_t addr_len = sizeof(addr);
+    pthread_t thread;
+    URLContext *quit = NULL;
+    char url[64];
+    int listen_fd, ret = 0;
+
+    av_register_all();
+    avformat_network_init();
+
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((listen_fd = ff_socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+        bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(listen_fd, 1) ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) ||
+        pthread_create(&thread, NULL, server_thread, &listen_fd)) {
+        printf("server setup failed\n");
+        return 1;
+    }
+    test_port = ntohs(addr.sin_port);
+
+    ret |= test_request("whole file",           "/file",     0,   0, TEST_FILE_SIZE);
+    ret |= test_request("reuse",                "/file",     0,   0, TEST_FILE_SIZE);
+    /* the rest of the responses is read to reuse the connection */
+    ret |= test_request("partial read",         "/file",     0,   0, 10);
+    ret |= test_request("range",                "/file",   100, 200, 10);
+    ret |= test_request("after range",          "/file",     0,   0, TEST_FILE_SIZE);
+    /* the end of the response is not known, the connection is not reused */
+    ret |= test_request("unknown length",       "/nolength", 0,   0, TEST_FILE_SIZE);
+    ret |= test_request("after unknown length", "/file",     0,   0, TEST_FILE_SIZE);
+    /* the request is sent again on a new connection */
+    ret |= test_request("stale",                "/stale",    0,   0, TEST_FILE_SIZE);
+    ret |= test_request("after stale",          "/file",     0,   0, TEST_FILE_SIZE);
+
+    ff_http_close_idle_connections();
+    snprintf(url, sizeof(url), "tcp://127.0.0.1:%d", test_port);
+    if (ffurl_open(&quit, url, AVIO_FLAG_WRITE, NULL, NULL) >= 0) {
+        ffurl_write(quit, "GET /quit HTTP/1.1\r\n\r\n", 22);
+        ffurl_close(quit);
+    }
+    pthread_join(thread, NULL);
+    closesocket(listen_fd);
+    avformat_network_deinit();
+    return ret;
+#else
+    return 0;
+#endif
+}
+
+#endif
@@ -21,7 +21,9 @@
 #ifndef AVFORMAT_INTERNAL_H
 #define AVFORMAT_INTERNAL_H
 
+#include <errno.h>
 #include <stdint.h>
+#include <stdio.h>
 #include "avformat.h"
 
 #define MAX_URL_SIZE 4096
@@ -53,7 +55,33 @@ struct AVFormatInternal {
      */
     int nb_interleaved_streams;
 
+    /**
+     * Streams with packets waiting in the interleaving queues, as a binary
+     * heap ordered by the first packet of each stream. Only used by
+     * ff_interleave_packet_per_dts() without chunking and audio_preload;
+     * NULL when the interleaving queue is the packet_buffer list.
+     * Muxing only.
+     */
+    int *interleave_heap;
+    int interleave_heap_size;
+    struct AVPacketList **interleave_first;    ///< first queued packet of each stream
+    int interleave_nb_skippable;        ///< streams max_interleave_delta may skip, see interleave_can_skip()
+    int interleave_nb_skippable_queued; ///< those of them with queued packets
+    int64_t interleave_max_dts;     ///< largest queued dts in AV_TIME_BASE units
+
     int inject_global_side_data;
+
+    /**
+     * Sidecar seek index, see ff_seek_index_load().
+     * Demuxing only.
+     */
+    int seek_index_state;           ///< 0 if not looked at yet, 1 if usable, negative on error
+    int seek_index_loaded;          ///< index entries were read from the sidecar file
+    int seek_index_entries;         ///< number of index entries after loading the sidecar file
+    int seek_index_incomplete;      ///< a seek may have left holes in the index
+    int64_t seek_index_file_size;   ///< size of the input the index belongs to
+    int64_t seek_index_file_mtime;  ///< modification time of the input if it is a local file, else 0
+    uint32_t seek_index_crc;        ///< CRC of the first and last bytes of the input
 };
 
 #ifdef __GNUC__
@@ -329,6 +357,12 @@ int ff_read_packet(AVFormatContext *s, AVPacket *pkt);
 int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
                                  AVPacket *pkt, int flush);
 
+/**
+ * Free the packets left in the per-stream interleaving queues.
+ * Must be called before the streams are freed.
+ */
+void ff_interleave_free_queue(AVFormatContext *s);
+
 void ff_free_stream(AVFormatContext *s, AVStream *st);
 
 /**
@@ -399,6 +433,23 @@ int ff_rfps_add_frame(AVFormatContext *ic, AVStream *st, int64_t dts);
 
 void ff_rfps_calculate(AVFormatContext *ic);
 
+/**
+ * Rename a local file, replacing newpath if it exists.
+ *
+ * @param logctx context the failure is logged against, may be NULL
+ * @return 0 if OK, AVERROR_xxx on error
+ */
+static inline int ff_rename(const char *oldpath, const char *newpath, void *logctx)
+{
+    int ret = 0;
+    if (rename(oldpath, newpath) == -1) {
+        ret = AVERROR(errno);
+        if (logctx)
+            av_log(logctx, AV_LOG_ERROR, "failed to rename file %s to %s\n", oldpath, newpath);
+    }
+    return ret;
+}
+
 /**
  * Flags for AVFormatContext.write_uncoded_frame()
  */
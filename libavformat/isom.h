@@ -94,6 +94,41 @@ typedef struct MOVSbgp {
     unsigned int index;
 } MOVSbgp;
 
+/**
+ * Sample table left in the file and read in blocks when needed.
+ */
+typedef struct MOVLazyTable {
+    AVFormatContext *fc;
+    AVIOContext *pb;
+    int64_t pos;                ///< offset of the first entry in the file
+    unsigned int count;
+    int field_size;             ///< size of an entry in bits, 0 if unused
+    unsigned int first;         ///< first entry in the cache
+    unsigned int cached;        ///< number of entries in the cache
+    int64_t *cache;
+    int error;                  ///< set if the table could not be read
+} MOVLazyTable;
+
+/**
+ * State of the walk through the sample tables of a track, as done when
+ * building its index, before the sample it points to.
+ */
+typedef struct MOVSampleCursor {
+    unsigned int sample;
+    unsigned int chunk;
+    unsigned int chunk_sample;  ///< index of the sample in its chunk
+    unsigned int stsc_index;
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    unsigned int stss_index;
+    unsigned int stps_index;
+    unsigned int rap_group_index;
+    unsigned int rap_group_sample;
+    unsigned int distance;      ///< distance to the last keyframe
+    int64_t pos;
+    int64_t dts;
+} MOVSampleCursor;
+
 typedef struct MOVFragmentIndexItem {
     int64_t moof_offset;
     int64_t time;
@@ -161,6 +196,17 @@ typedef struct MOVStreamContext {
     int64_t duration_for_fps;
 
     int32_t *display_matrix;
+
+    int lazy_index;       ///< index entries are computed from the sample tables on demand
+    unsigned int lazy_sample_count;
+    MOVSampleCursor lazy_cursor;
+    AVIndexEntry lazy_entry;        ///< last entry computed
+    int lazy_entry_sample;          ///< sample of lazy_entry, -1 if none
+    MOVSampleCursor *lazy_checkpoints; ///< cursor every MOV_LAZY_INTERVAL samples
+    unsigned int lazy_nb_checkpoints;
+    unsigned int lazy_checkpoints_size;
+    MOVLazyTable lazy_stsz;         ///< sample sizes, if not loaded in sample_sizes
+    MOVLazyTable lazy_stco;         ///< chunk offsets, if not loaded in chunk_offsets
 } MOVStreamContext;
 
 typedef struct MOVContext {
@@ -188,6 +234,7 @@ typedef struct MOVContext {
     int has_looked_for_mfra;
     MOVFragmentIndex** fragment_index_data;
     unsigned fragment_index_count;
+    int lazy_index;
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
@@ -1245,6 +1245,113 @@ static int mov_read_strf(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+#define MOV_LAZY_TABLE_BLOCK 1024
+
+static int mov_lazy_tables_enabled(MOVContext *c, AVIOContext *pb, AVStream *st)
+{
+    return c->lazy_index && pb == c->fc->pb && pb->seekable &&
+           (st->codec->codec_type == AVMEDIA_TYPE_AUDIO ||
+            st->codec->codec_type == AVMEDIA_TYPE_VIDEO);
+}
+
+/* Check that the file holds the table following the current position. */
+static int mov_lazy_table_in_file(AVIOContext *pb, uint64_t size)
+{
+    int64_t file_size = avio_size(pb);
+    return file_size > 0 && avio_tell(pb) + size <= file_size;
+}
+
+static int mov_lazy_table_init(MOVLazyTable *t, AVFormatContext *fc, AVIOContext *pb,
+                               unsigned int count, int field_size)
+{
+    if (!(t->cache = av_malloc(MOV_LAZY_TABLE_BLOCK * sizeof(*t->cache))))
+        return AVERROR(ENOMEM);
+    t->fc         = fc;
+    t->pb         = pb;
+    t->pos        = avio_tell(pb);
+    t->count      = count;
+    t->field_size = field_size;
+    t->first      = 0;
+    t->cached     = 0;
+    t->error      = 0;
+    return 0;
+}
+
+static void mov_lazy_table_free(MOVLazyTable *t)
+{
+    av_freep(&t->cache);
+    t->field_size = 0;
+}
+
+static int64_t mov_lazy_table_get(MOVLazyTable *t, unsigned int n)
+{
+    if (n - t->first >= t->cached) {
+        uint8_t buf[MOV_LAZY_TABLE_BLOCK * 8];
+        int64_t pos = avio_tell(t->pb);
+        unsigned int i, count;
+        int size;
+
+        t->first = n - n % MOV_LAZY_TABLE_BLOCK;
+        count    = FFMIN(MOV_LAZY_TABLE_BLOCK, t->count - t->first);
+        size     = (count * t->field_size + 7) >> 3;
+        if (avio_seek(t->pb, t->pos + ((int64_t)t->first * t->field_size >> 3), SEEK_SET) < 0 ||
+            avio_read(t->pb, buf, size) != size) {
+            if (!t->error)
+                av_log(t->fc, AV_LOG_ERROR, "Error reading sample table at 0x%"PRIx64": partial file\n",
+                       t->pos);
+            t->error = AVERROR_INVALIDDATA;
+            memset(buf, 0, size);
+        }
+        avio_seek(t->pb, pos, SEEK_SET);
+
+        for (i = 0; i < count; i++) {
+            switch (t->field_size) {
+            case  4: t->cache[i] = buf[i >> 1] >> (i & 1 ? 0 : 4) & 15; break;
+            case  8: t->cache[i] = buf[i];               break;
+            case 16: t->cache[i] = AV_RB16(buf + 2 * i); break;
+            case 32: t->cache[i] = AV_RB32(buf + 4 * i); break;
+            default: t->cache[i] = AV_RB64(buf + 8 * i); break;
+            }
+        }
+        t->cached = count;
+    }
+    return t->cache[n - t->first];
+}
+
+/* Get the error of the sample tables left in the file, if any. */
+static int mov_lazy_tables_error(MOVStreamContext *sc)
+{
+    return sc->lazy_stsz.error ? sc->lazy_stsz.error : sc->lazy_stco.error;
+}
+
+/* Load the tables left in the file, for the code needing all the entries. */
+static int mov_lazy_tables_load(MOVStreamContext *sc)
+{
+    unsigned int i;
+    int ret;
+
+    if (sc->lazy_stco.field_size) {
+        if (!(sc->chunk_offsets = av_malloc_array(sc->lazy_stco.count, sizeof(*sc->chunk_offsets))))
+            return AVERROR(ENOMEM);
+        for (i = 0; i < sc->lazy_stco.count; i++)
+            sc->chunk_offsets[i] = mov_lazy_table_get(&sc->lazy_stco, i);
+        mov_lazy_table_free(&sc->lazy_stco);
+    }
+    if (sc->lazy_stsz.field_size) {
+        if (!(sc->sample_sizes = av_malloc_array(sc->lazy_stsz.count, sizeof(*sc->sample_sizes))))
+            return AVERROR(ENOMEM);
+        for (i = 0; i < sc->lazy_stsz.count; i++)
+            sc->sample_sizes[i] = mov_lazy_table_get(&sc->lazy_stsz, i);
+        mov_lazy_table_free(&sc->lazy_stsz);
+    }
+    if ((ret = mov_lazy_tables_error(sc)) < 0) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->sample_sizes);
+        return ret;
+    }
+    return 0;
+}
+
 static int mov_read_stco(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     AVStream *st;
@@ -1266,6 +1373,16 @@ static int mov_read_stco(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     if (entries >= UINT_MAX/sizeof(int64_t))
         return AVERROR_INVALIDDATA;
 
+    if (mov_lazy_tables_enabled(c, pb, st) && atom.size >= 8 &&
+        (atom.type == MKTAG('s','t','c','o') || atom.type == MKTAG('c','o','6','4'))) {
+        int field_size = atom.type == MKTAG('s','t','c','o') ? 32 : 64;
+        uint64_t table_size = (uint64_t)entries * (field_size >> 3);
+        if (table_size <= atom.size - 8 && mov_lazy_table_in_file(pb, table_size)) {
+            sc->chunk_count = entries;
+            return mov_lazy_table_init(&sc->lazy_stco, c->fc, pb, entries, field_size);
+        }
+    }
+
     sc->chunk_offsets = av_malloc(entries * sizeof(int64_t));
     if (!sc->chunk_offsets)
         return AVERROR(ENOMEM);
@@ -2001,6 +2118,18 @@ static int mov_read_stsz(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     if (entries >= UINT_MAX / sizeof(int) || entries >= (UINT_MAX - 4) / field_size)
         return AVERROR_INVALIDDATA;
+
+    if (mov_lazy_tables_enabled(c, pb, st) && atom.size >= 12 &&
+        ((uint64_t)entries * field_size + 7) / 8 <= atom.size - 12 &&
+        mov_lazy_table_in_file(pb, ((uint64_t)entries * field_size + 7) / 8)) {
+        int ret = mov_lazy_table_init(&sc->lazy_stsz, c->fc, pb, entries, field_size);
+        if (ret < 0)
+            return ret;
+        for (i = 0; i < entries; i++)
+            sc->data_size += mov_lazy_table_get(&sc->lazy_stsz, i);
+        return sc->lazy_stsz.error;
+    }
+
     sc->sample_sizes = av_malloc(entries * sizeof(int));
     if (!sc->sample_sizes)
         return AVERROR(ENOMEM);
@@ -2214,6 +2343,280 @@ static int mov_read_sbgp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return pb->eof_reached ? AVERROR_EOF : 0;
 }
 
+#define MOV_LAZY_INTERVAL 1024
+
+/* Move the cursor to the start of the next chunk holding samples. */
+static void mov_cursor_enter_chunk(MOVStreamContext *sc, MOVSampleCursor *c)
+{
+    for (; c->chunk < sc->chunk_count; c->chunk++) {
+        c->pos = sc->chunk_offsets ? sc->chunk_offsets[c->chunk] :
+                 mov_lazy_table_get(&sc->lazy_stco, c->chunk);
+        while (c->stsc_index + 1 < sc->stsc_count &&
+               c->chunk + 1 == sc->stsc_data[c->stsc_index + 1].first)
+            c->stsc_index++;
+        if (sc->stsc_data[c->stsc_index].count > 0)
+            break;
+    }
+    c->chunk_sample = 0;
+}
+
+/*
+ * Compute the index entry of the sample the cursor points to and move the
+ * cursor to the next sample. This must give the same entries as
+ * mov_build_index().
+ */
+static void mov_cursor_next(AVStream *st, MOVSampleCursor *c, AVIndexEntry *e)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int rap_group_present = sc->rap_group_count && sc->rap_group;
+    int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+    unsigned int sample_size;
+    int keyframe = 0;
+
+    if (!sc->keyframe_absent && (!sc->keyframe_count || c->sample+key_off == sc->keyframes[c->stss_index])) {
+        keyframe = 1;
+        if (c->stss_index + 1 < sc->keyframe_count)
+            c->stss_index++;
+    } else if (sc->stps_count && c->sample+key_off == sc->stps_data[c->stps_index]) {
+        keyframe = 1;
+        if (c->stps_index + 1 < sc->stps_count)
+            c->stps_index++;
+    }
+    if (rap_group_present && c->rap_group_index < sc->rap_group_count) {
+        if (sc->rap_group[c->rap_group_index].index > 0)
+            keyframe = 1;
+        if (++c->rap_group_sample == sc->rap_group[c->rap_group_index].count) {
+            c->rap_group_sample = 0;
+            c->rap_group_index++;
+        }
+    }
+    if (sc->keyframe_absent
+        && !sc->stps_count
+        && !rap_group_present
+        && (st->codec->codec_type == AVMEDIA_TYPE_AUDIO || (!c->chunk && !c->chunk_sample)))
+         keyframe = 1;
+    if (keyframe)
+        c->distance = 0;
+    if (sc->stsz_sample_size > 0)
+        sample_size = sc->stsz_sample_size;
+    else if (sc->sample_sizes)
+        sample_size = sc->sample_sizes[c->sample];
+    else
+        sample_size = mov_lazy_table_get(&sc->lazy_stsz, c->sample);
+
+    e->pos          = c->pos;
+    e->timestamp    = c->dts;
+    e->size         = sample_size;
+    e->min_distance = c->distance;
+    e->flags        = keyframe ? AVINDEX_KEYFRAME : 0;
+
+    c->pos += sample_size;
+    c->dts += sc->stts_data[c->stts_index].duration;
+    c->distance++;
+    c->stts_sample++;
+    c->sample++;
+    if (c->stts_index + 1 < sc->stts_count && c->stts_sample == sc->stts_data[c->stts_index].count) {
+        c->stts_sample = 0;
+        c->stts_index++;
+    }
+    if (++c->chunk_sample >= sc->stsc_data[c->stsc_index].count) {
+        c->chunk++;
+        mov_cursor_enter_chunk(sc, c);
+    }
+}
+
+static void mov_lazy_step(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVSampleCursor *c = &sc->lazy_cursor;
+
+    if (c->sample == (uint64_t)sc->lazy_nb_checkpoints * MOV_LAZY_INTERVAL) {
+        MOVSampleCursor *checkpoints = av_fast_realloc(sc->lazy_checkpoints,
+                                                       &sc->lazy_checkpoints_size,
+                                                       (sc->lazy_nb_checkpoints + 1) * sizeof(*checkpoints));
+        if (checkpoints) {
+            sc->lazy_checkpoints = checkpoints;
+            sc->lazy_checkpoints[sc->lazy_nb_checkpoints++] = *c;
+        }
+    }
+    sc->lazy_entry_sample = c->sample;
+    mov_cursor_next(st, c, &sc->lazy_entry);
+}
+
+/*
+ * Get the index entry of sample n by walking the sample tables from the
+ * cursor or from the closest checkpoint before n.
+ */
+static AVIndexEntry *mov_lazy_get_entry(AVStream *st, unsigned int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int k = FFMIN(n / MOV_LAZY_INTERVAL, sc->lazy_nb_checkpoints - 1);
+
+    if (sc->lazy_entry_sample == n)
+        return &sc->lazy_entry;
+    if (n < sc->lazy_cursor.sample || sc->lazy_checkpoints[k].sample > sc->lazy_cursor.sample)
+        sc->lazy_cursor = sc->lazy_checkpoints[k];
+    while (sc->lazy_cursor.sample <= n)
+        mov_lazy_step(st);
+    return &sc->lazy_entry;
+}
+
+/* Same as av_index_search_timestamp(), on the lazily computed index. */
+static int mov_lazy_search_timestamp(AVStream *st, int64_t timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int lo = 0, hi = sc->lazy_nb_checkpoints, n;
+    int a = -1, b = sc->lazy_sample_count, m;
+    AVIndexEntry *e;
+
+    /* binary search for the last checkpoint before the timestamp, then walk */
+    while (hi - lo > 1) {
+        unsigned int mid = (lo + hi) >> 1;
+        if (sc->lazy_checkpoints[mid].dts < timestamp)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    for (n = lo * MOV_LAZY_INTERVAL; n < sc->lazy_sample_count; n++) {
+        e = mov_lazy_get_entry(st, n);
+        if (e->timestamp >= timestamp && b == sc->lazy_sample_count)
+            b = n;
+        if (e->timestamp > timestamp)
+            break;
+        a = n;
+    }
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY) && m >= 0 && m < sc->lazy_sample_count) {
+        if (flags & AVSEEK_FLAG_BACKWARD) {
+            /* the distance is reset at each keyframe */
+            e = mov_lazy_get_entry(st, m);
+            if (!(e->flags & AVINDEX_KEYFRAME)) {
+                m -= e->min_distance;
+                if (!(mov_lazy_get_entry(st, m)->flags & AVINDEX_KEYFRAME))
+                    m = -1;
+            }
+        } else {
+            while (m < sc->lazy_sample_count &&
+                   !(mov_lazy_get_entry(st, m)->flags & AVINDEX_KEYFRAME))
+                m++;
+        }
+    }
+
+    if (m == sc->lazy_sample_count)
+        return -1;
+    return m;
+}
+
+/*
+ * Set up the stream for computing its index entries on demand instead of
+ * building the whole index. Files for which mov_build_index() has to fix
+ * the sample tables up are left to it.
+ */
+static int mov_lazy_index_init(MOVContext *mov, AVStream *st, int64_t current_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    uint64_t total = 0, stream_size = 0;
+    unsigned int i, stsc_index = 0;
+
+    if (st->codec->codec_type != AVMEDIA_TYPE_AUDIO &&
+        st->codec->codec_type != AVMEDIA_TYPE_VIDEO)
+        return AVERROR_PATCHWELCOME;
+
+    /* stsz sample sizes mov_build_index() might have to ignore */
+    if (sc->stsz_sample_size > 0 && sc->sample_size > 0 &&
+        sc->stsz_sample_size != sc->sample_size)
+        return AVERROR_PATCHWELCOME;
+
+    for (i = 0; i < sc->chunk_count; i++) {
+        while (stsc_index + 1 < sc->stsc_count &&
+            i + 1 == sc->stsc_data[stsc_index + 1].first)
+            stsc_index++;
+        if ((sc->pseudo_stream_id != -1 && sc->stsc_data[stsc_index].id - 1 != sc->pseudo_stream_id) ||
+            sc->stsc_data[stsc_index].count < 0)
+            return AVERROR_PATCHWELCOME;
+        total += sc->stsc_data[stsc_index].count;
+    }
+    if (total != sc->sample_count)
+        return AVERROR_INVALIDDATA;
+
+    if (!(sc->lazy_checkpoints = av_malloc(sizeof(*sc->lazy_checkpoints))))
+        return AVERROR(ENOMEM);
+    sc->lazy_checkpoints_size = sizeof(*sc->lazy_checkpoints);
+    sc->lazy_nb_checkpoints   = 1;
+
+    memset(&sc->lazy_cursor, 0, sizeof(sc->lazy_cursor));
+    sc->lazy_cursor.dts = current_dts;
+    mov_cursor_enter_chunk(sc, &sc->lazy_cursor);
+    sc->lazy_checkpoints[0] = sc->lazy_cursor;
+    sc->lazy_sample_count   = total;
+    sc->lazy_entry_sample   = -1;
+    sc->lazy_index          = 1;
+
+    if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+        for (i = 0; i < FFMIN(total, 99); i++)
+            ff_rfps_add_frame(mov->fc, st, mov_lazy_get_entry(st, i)->timestamp);
+    if (mov_lazy_tables_error(sc) < 0) {
+        sc->lazy_index = 0;
+        av_freep(&sc->lazy_checkpoints);
+        sc->lazy_nb_checkpoints = sc->lazy_checkpoints_size = 0;
+        return mov_lazy_tables_error(sc);
+    }
+
+    stream_size = sc->stsz_sample_size > 0 ? total * sc->stsz_sample_size : sc->data_size;
+    if (st->duration > 0)
+        st->codec->bit_rate = stream_size*8*sc->time_scale/st->duration;
+
+    return 0;
+}
+
+/* Build the full index of a stream using a lazy index. */
+static int mov_lazy_index_materialize(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int i;
+    int ret;
+
+    if (sc->lazy_sample_count >= UINT_MAX / sizeof(*st->index_entries))
+        return AVERROR(ENOMEM);
+    if ((ret = av_reallocp_array(&st->index_entries, sc->lazy_sample_count,
+                                 sizeof(*st->index_entries))) < 0)
+        return ret;
+    st->index_entries_allocated_size = sc->lazy_sample_count * sizeof(*st->index_entries);
+    for (i = 0; i < sc->lazy_sample_count; i++)
+        st->index_entries[i] = *mov_lazy_get_entry(st, i);
+    if ((ret = mov_lazy_tables_error(sc)) < 0)
+        return ret;
+    st->nb_index_entries = sc->lazy_sample_count;
+
+    sc->lazy_index = 0;
+    av_freep(&sc->lazy_checkpoints);
+    sc->lazy_nb_checkpoints = sc->lazy_checkpoints_size = 0;
+    return 0;
+}
+
+static int mov_nb_samples(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    return sc->lazy_index ? sc->lazy_sample_count : st->nb_index_entries;
+}
+
+static AVIndexEntry *mov_get_sample(AVStream *st, int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+    return sc->lazy_index ? mov_lazy_get_entry(st, n) : &st->index_entries[n];
+}
+
+/* Unlike mov_get_sample(), this keeps the entry of the last sample returned
+ * when reading the index sequentially. */
+static int64_t mov_get_sample_timestamp(AVStream *st, int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+    if (sc->lazy_index && sc->lazy_cursor.sample == n)
+        return sc->lazy_cursor.dts;
+    return mov_get_sample(st, n)->timestamp;
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
@@ -2257,6 +2660,10 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
 
         if (!sc->sample_count || st->nb_index_entries)
             return;
+        if (mov->lazy_index && mov_lazy_index_init(mov, st, current_dts) >= 0)
+            return;
+        if (mov_lazy_tables_load(sc) < 0)
+            return;
         if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
             return;
         if (av_reallocp_array(&st->index_entries,
@@ -2348,6 +2755,9 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     } else {
         unsigned chunk_samples, total = 0;
 
+        if (mov_lazy_tables_load(sc) < 0)
+            return;
+
         // compute total chunk count
         for (i = 0; i < sc->stsc_count; i++) {
             unsigned count, chunk_count;
@@ -2577,14 +2987,16 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         break;
     }
 
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->stsc_data);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
-    av_freep(&sc->rap_group);
+    /* Do not need those anymore, unless the index is built on demand. */
+    if (!sc->lazy_index) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->stsc_data);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+        av_freep(&sc->stps_data);
+        av_freep(&sc->rap_group);
+    }
 
     return 0;
 }
@@ -2974,6 +3386,9 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    /* fragments are added to the full index */
+    if (sc->lazy_index && (err = mov_lazy_index_materialize(st)) < 0)
+        return err;
     avio_r8(pb); /* version */
     flags = avio_rb24(pb);
     entries = avio_rb32(pb);
@@ -3695,6 +4110,9 @@ static int mov_read_close(AVFormatContext *s)
         av_freep(&sc->stps_data);
         av_freep(&sc->rap_group);
         av_freep(&sc->display_matrix);
+        av_freep(&sc->lazy_checkpoints);
+        mov_lazy_table_free(&sc->lazy_stsz);
+        mov_lazy_table_free(&sc->lazy_stco);
     }
 
     if (mov->dv_demux) {
@@ -3988,8 +4406,8 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        if (msc->pb && msc->current_sample < mov_nb_samples(avst)) {
+            AVIndexEntry *current_sample = mov_get_sample(avst, msc->current_sample);
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_dlog(s, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!s->pb->seekable && current_sample->pos < sample->pos) ||
@@ -4029,6 +4447,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         goto retry;
     }
     sc = st->priv_data;
+    if (sc->lazy_index && (ret = mov_lazy_tables_error(sc)) < 0)
+        return ret;
     /* must be done just before reading, to avoid infinite loop on sample */
     sc->current_sample++;
 
@@ -4083,8 +4503,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         if (sc->wrong_dts)
             pkt->dts = AV_NOPTS_VALUE;
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (sc->current_sample < mov_nb_samples(st)) ?
+            mov_get_sample_timestamp(st, sc->current_sample) : st->duration;
         pkt->duration = next_dts - pkt->dts;
         pkt->pts = pkt->dts;
     }
@@ -4103,9 +4523,14 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     int sample, time_sample;
     int i;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sc->lazy_index) {
+        sample = mov_lazy_search_timestamp(st, timestamp, flags);
+        if (mov_lazy_tables_error(sc) < 0)
+            return mov_lazy_tables_error(sc);
+    } else
+        sample = av_index_search_timestamp(st, timestamp, flags);
     av_dlog(s, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+    if (sample < 0 && mov_nb_samples(st) && timestamp < mov_get_sample_timestamp(st, 0))
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -4143,7 +4568,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         return sample;
 
     /* adjust seek timestamp to found sample timestamp */
-    seek_timestamp = st->index_entries[sample].timestamp;
+    seek_timestamp = mov_get_sample_timestamp(st, sample);
 
     for (i = 0; i < s->nb_streams; i++) {
         MOVStreamContext *sc = s->streams[i]->priv_data;
@@ -4177,6 +4602,10 @@ static const AVOption options[] = {
         AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM, "use_mfra_for" },
     {"pts", "pts", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_MFRA_PTS}, 0, 0,
         AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM, "use_mfra_for" },
+    {"lazy_index",
+        "compute the index entries of audio and video tracks from the sample tables on demand",
+        offsetof(MOVContext, lazy_index), FF_OPT_TYPE_INT, {.i64 = 0},
+        0, 1, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM},
     {NULL}
 };
 
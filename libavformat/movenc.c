@@ -61,6 +61,7 @@ static const AVOption options[] = {
     { "frag_custom", "Flush fragments on caller requests", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_CUSTOM}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "isml", "Create a live smooth streaming feed (for pushing to a publishing point)", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_ISML}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "faststart", "Run a second pass to put the index (moov atom) at the beginning of the file", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FASTSTART}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
+    { "reserve_moov", "Reserve estimated space, or moov_size bytes if set, for the moov atom at the beginning of the file and only move the data if it does not fit (implies faststart)", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RESERVE_MOOV}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "omit_tfhd_offset", "Omit the base data offset in tfhd atoms", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_OMIT_TFHD_OFFSET}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "disable_chpl", "Disable Nero chapter atom", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_DISABLE_CHPL}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     FF_RTP_FLAG_OPTS(MOVMuxContext, rtp_flags),
@@ -4315,12 +4316,94 @@ static int mov_create_dvd_sub_decoder_specific_info(MOVTrack *track,
     return 0;
 }
 
+/* Cost of the index entries for one sample (stsz, stts/ctts, stss) and for
+ * one chunk (co64 and a share of stsc), used for estimating the moov size. */
+#define MOOV_SAMPLE_COST 12
+#define MOOV_CHUNK_COST  8
+#define MOOV_TRACK_COST  1024
+
+/*
+ * Estimate the size of the moov atom from the expected number of samples of
+ * each stream. Every sample is assumed to be in its own chunk, which
+ * overestimates interleaved content but keeps the estimate on the safe side.
+ * Returns 0 if the duration of the output is not known.
+ */
+static int64_t estimate_moov_size(AVFormatContext *s)
+{
+    int64_t size = MOOV_TRACK_COST;
+    AVDictionaryEntry *t = NULL;
+    int i;
+
+    while ((t = av_dict_get(s->metadata, "", t, AV_DICT_IGNORE_SUFFIX)))
+        size += strlen(t->key) + strlen(t->value) + 32;
+    size += s->nb_chapters * 64LL;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        AVCodecContext *enc = st->codec;
+        double duration = 0, rate = 0, samples = st->nb_frames;
+
+        if (st->duration > 0 && st->time_base.num)
+            duration = st->duration * av_q2d(st->time_base);
+        else if (s->duration > 0)
+            duration = s->duration / (double)AV_TIME_BASE;
+
+        if (samples <= 0) {
+            if (enc->codec_type == AVMEDIA_TYPE_VIDEO) {
+                if (st->avg_frame_rate.num && st->avg_frame_rate.den)
+                    rate = av_q2d(st->avg_frame_rate);
+                else if (enc->time_base.num && enc->time_base.den)
+                    rate = 1 / av_q2d(enc->time_base);
+            } else if (enc->codec_type == AVMEDIA_TYPE_AUDIO) {
+                rate = enc->sample_rate / (double)(enc->frame_size > 1 ? enc->frame_size : 1024);
+            } else {
+                rate = 1;
+            }
+            samples = duration * rate;
+        }
+        if (samples <= 0 || samples > INT_MAX)
+            return 0;
+
+        size += MOOV_TRACK_COST + enc->extradata_size +
+                (int64_t)samples * (MOOV_SAMPLE_COST + MOOV_CHUNK_COST);
+    }
+
+    /* leave some headroom for the entries that are not accounted for */
+    size += size / 8;
+    return size <= INT_MAX ? size : 0;
+}
+
+/*
+ * Fill the space at the beginning of the file, where the moov atom will be
+ * written by the trailer, with a free atom. Its size is given by moov_size
+ * if set, estimated otherwise. If it turns out to be too small, the trailer
+ * falls back to moving the data like faststart does.
+ */
+static void reserve_moov_space(AVFormatContext *s, int moov_size)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *pb = s->pb;
+    int64_t size = moov_size > 0 ? FFMAX(moov_size, 8) : estimate_moov_size(s);
+
+    if (!size) {
+        av_log(s, AV_LOG_VERBOSE, "Unknown output duration, the moov atom "
+               "will be moved to the beginning of the file in a second pass\n");
+        return;
+    }
+    av_log(s, AV_LOG_VERBOSE, "Reserving %"PRId64" bytes for the moov atom\n", size);
+    mov->reserved_moov_space = size;
+    avio_wb32(pb, size);
+    ffio_wfourcc(pb, "free");
+    ffio_fill(pb, 0, size - 8);
+}
+
 static int mov_write_header(AVFormatContext *s)
 {
     AVIOContext *pb = s->pb;
     MOVMuxContext *mov = s->priv_data;
     AVDictionaryEntry *t, *global_tcr = av_dict_get(s->metadata, "timecode", NULL, 0);
     int i, ret, hint_track = 0, tmcd_track = 0;
+    int moov_size = mov->reserved_moov_size;
 
     mov->fc = s;
 
@@ -4353,13 +4436,16 @@ static int mov_write_header(AVFormatContext *s)
         mov->flags |= FF_MOV_FLAG_EMPTY_MOOV | FF_MOV_FLAG_SEPARATE_MOOF |
                       FF_MOV_FLAG_FRAGMENT;
 
+    if (mov->flags & FF_MOV_FLAG_RESERVE_MOOV)
+        mov->flags |= FF_MOV_FLAG_FASTSTART;
+
     /* faststart: moov at the beginning of the file, if supported */
     if (mov->flags & FF_MOV_FLAG_FASTSTART) {
         if ((mov->flags & FF_MOV_FLAG_FRAGMENT) ||
             (s->flags & AVFMT_FLAG_CUSTOM_IO)) {
             av_log(s, AV_LOG_WARNING, "The faststart flag is incompatible "
                    "with fragmentation and custom IO, disabling faststart\n");
-            mov->flags &= ~FF_MOV_FLAG_FASTSTART;
+            mov->flags &= ~(FF_MOV_FLAG_FASTSTART | FF_MOV_FLAG_RESERVE_MOOV);
         } else
             mov->reserved_moov_size = -1;
     }
@@ -4594,8 +4680,11 @@ static int mov_write_header(AVFormatContext *s)
             !mov->max_fragment_duration && !mov->max_fragment_size)
             mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
     } else {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
             mov->reserved_moov_pos = avio_tell(pb);
+            if (mov->flags & FF_MOV_FLAG_RESERVE_MOOV)
+                reserve_moov_space(s, moov_size);
+        }
         mov_write_mdat_tag(pb, mov);
     }
 
@@ -4668,22 +4757,27 @@ static int get_moov_size(AVFormatContext *s)
 }
 
 /*
- * This function gets the moov size if moved to the top of the file: the chunk
- * offset table can switch between stco (32-bit entries) to co64 (64-bit
- * entries) when the moov is moved to the beginning, so the size of the moov
- * would change. It also updates the chunk offset tables.
+ * This function computes how far the data has to be shifted to make room for
+ * the moov at the top of the file, given the space already reserved there: the
+ * chunk offset table can switch between stco (32-bit entries) to co64 (64-bit
+ * entries) when the data is moved, so the size of the moov would change. If
+ * the moov does not fill the space exactly, enough room is left after it for
+ * a free atom. It also updates the chunk offset tables.
  */
-static int compute_moov_size(AVFormatContext *s)
+static int compute_moov_shift(AVFormatContext *s, int reserved)
 {
-    int i, moov_size, moov_size2;
+    int i, moov_size, moov_size2, shift;
     MOVMuxContext *mov = s->priv_data;
 
     moov_size = get_moov_size(s);
     if (moov_size < 0)
         return moov_size;
 
+    shift = moov_size - reserved;
+    if (shift <= 0)
+        shift += 8;
     for (i = 0; i < mov->nb_streams; i++)
-        mov->tracks[i].data_offset += moov_size;
+        mov->tracks[i].data_offset += shift;
 
     moov_size2 = get_moov_size(s);
     if (moov_size2 < 0)
@@ -4691,38 +4785,47 @@ static int compute_moov_size(AVFormatContext *s)
 
     /* if the size changed, we just switched from stco to co64 and need to
      * update the offsets */
-    if (moov_size2 != moov_size)
+    if (moov_size2 != moov_size) {
         for (i = 0; i < mov->nb_streams; i++)
             mov->tracks[i].data_offset += moov_size2 - moov_size;
+        shift += moov_size2 - moov_size;
+    }
 
-    return moov_size2;
+    return shift;
 }
 
-static int shift_data(AVFormatContext *s)
+#define SHIFT_BLOCK_SIZE (1 << 20)
+
+/*
+ * Move the data following the reserved space forward to make room for the
+ * moov. Returns the number of bytes the data was moved by.
+ */
+static int shift_data(AVFormatContext *s, int reserved)
 {
-    int ret = 0, moov_size;
+    int ret = 0, shift, direct;
     MOVMuxContext *mov = s->priv_data;
-    int64_t pos, pos_end = avio_tell(s->pb);
-    uint8_t *buf, *read_buf[2];
-    int read_buf_id = 0;
-    int read_size[2];
+    int64_t pos, pos_end, written, buf_size;
+    uint8_t *buf;
     AVIOContext *read_pb;
 
-    moov_size = compute_moov_size(s);
-    if (moov_size < 0)
-        return moov_size;
+    shift = compute_moov_shift(s, reserved);
+    if (shift < 0)
+        return shift;
 
-    buf = av_malloc(moov_size * 2);
+    /* The data is copied through a ring buffer, in which the writes trail the
+     * reads by at least shift bytes, so that nothing gets overwritten before
+     * it has been read. Reads are made of blocks aligned to SHIFT_BLOCK_SIZE
+     * in the file, so they never wrap around the end of the buffer. */
+    buf_size = (shift / SHIFT_BLOCK_SIZE + 2) * (int64_t)SHIFT_BLOCK_SIZE;
+    buf = buf_size <= INT_MAX ? av_malloc(buf_size) : NULL;
     if (!buf)
         return AVERROR(ENOMEM);
-    read_buf[0] = buf;
-    read_buf[1] = buf + moov_size;
 
     /* Shift the data: the AVIO context of the output can only be used for
      * writing, so we re-open the same output, but for reading. It also avoids
      * a read/seek/write/seek back and forth. */
     avio_flush(s->pb);
-    ret = avio_open(&read_pb, s->filename, AVIO_FLAG_READ);
+    ret = avio_open(&read_pb, s->filename, AVIO_FLAG_READ | AVIO_FLAG_DIRECT);
     if (ret < 0) {
         av_log(s, AV_LOG_ERROR, "Unable to re-open %s output file for "
                "the second pass (faststart)\n", s->filename);
@@ -4732,33 +4835,42 @@ static int shift_data(AVFormatContext *s)
     /* mark the end of the shift to up to the last data we wrote, and get ready
      * for writing */
     pos_end = avio_tell(s->pb);
-    avio_seek(s->pb, mov->reserved_moov_pos + moov_size, SEEK_SET);
-
-    /* start reading at where the new moov will be placed */
-    avio_seek(read_pb, mov->reserved_moov_pos, SEEK_SET);
-    pos = avio_tell(read_pb);
-
-#define READ_BLOCK do {                                                             \
-    read_size[read_buf_id] = avio_read(read_pb, read_buf[read_buf_id], moov_size);  \
-    read_buf_id ^= 1;                                                               \
-} while (0)
-
-    /* shift data by chunk of at most moov_size */
-    READ_BLOCK;
-    do {
-        int n;
-        READ_BLOCK;
-        n = read_size[read_buf_id];
-        if (n <= 0)
-            break;
-        avio_write(s->pb, read_buf[read_buf_id], n);
-        pos += n;
-    } while (pos < pos_end);
+    pos = written = mov->reserved_moov_pos + reserved;
+    avio_seek(s->pb, pos + shift, SEEK_SET);
+    avio_seek(read_pb, pos, SEEK_SET);
+
+    /* bypass the output buffer, the blocks are large enough */
+    direct = s->pb->direct;
+    s->pb->direct = 1;
+
+    while (written < pos_end) {
+        int64_t limit;
+
+        if (pos < pos_end) {
+            int n = FFMIN(SHIFT_BLOCK_SIZE - pos % SHIFT_BLOCK_SIZE, pos_end - pos);
+            n = avio_read(read_pb, buf + pos % buf_size, n);
+            if (n <= 0) {
+                ret = n < 0 ? n : AVERROR(EIO);
+                break;
+            }
+            pos += n;
+        }
+
+        /* write everything that cannot be overwritten by the writes anymore */
+        limit = pos < pos_end ? pos - shift : pos;
+        while (written < limit) {
+            int64_t off = written % buf_size;
+            int n = FFMIN(limit - written, buf_size - off);
+            avio_write(s->pb, buf + off, n);
+            written += n;
+        }
+    }
+    s->pb->direct = direct;
     avio_close(read_pb);
 
 end:
     av_free(buf);
-    return ret;
+    return ret < 0 ? ret : shift;
 }
 
 static int mov_write_trailer(AVFormatContext *s)
@@ -4812,12 +4924,32 @@ static int mov_write_trailer(AVFormatContext *s)
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_moov_pos : moov_pos, SEEK_SET);
 
         if (mov->flags & FF_MOV_FLAG_FASTSTART) {
-            av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
-            res = shift_data(s);
-            if (res == 0) {
-                avio_seek(s->pb, mov->reserved_moov_pos, SEEK_SET);
-                mov_write_moov_tag(pb, mov, s);
+            int64_t space = mov->reserved_moov_space;
+
+            if (space) {
+                if ((res = get_moov_size(s)) < 0)
+                    goto error;
+                if (res != space && res + 8 > space) {
+                    av_log(s, AV_LOG_INFO, "The moov atom (%d bytes) does not fit "
+                           "in the reserved space (%"PRId64" bytes)\n", res, space);
+                    space = -1;
+                }
+            }
+            if (space <= 0) {
+                av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
+                res = shift_data(s, mov->reserved_moov_space);
+                if (res < 0)
+                    goto error;
+                space = mov->reserved_moov_space + res;
+            }
+            avio_seek(pb, mov->reserved_moov_pos, SEEK_SET);
+            mov_write_moov_tag(pb, mov, s);
+            space -= avio_tell(pb) - mov->reserved_moov_pos;
+            if (space) {
+                avio_wb32(pb, space);
+                ffio_wfourcc(pb, "free");
             }
+            res = 0;
         } else if (mov->reserved_moov_size > 0) {
             int64_t size;
             mov_write_moov_tag(pb, mov, s);
@@ -177,6 +177,7 @@ typedef struct MOVMuxContext {
 
     int reserved_moov_size; ///< 0 for disabled, -1 for automatic, size otherwise
     int64_t reserved_moov_pos;
+    int reserved_moov_space; ///< size of the space reserved for the moov by reserve_moov, 0 if none
 
     char *major_brand;
 
@@ -194,6 +195,7 @@ typedef struct MOVMuxContext {
 #define FF_MOV_FLAG_FASTSTART 128
 #define FF_MOV_FLAG_OMIT_TFHD_OFFSET 256
 #define FF_MOV_FLAG_DISABLE_CHPL 512
+#define FF_MOV_FLAG_RESERVE_MOOV 1024
 
 int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt);
 
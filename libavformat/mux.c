@@ -205,6 +205,15 @@ static int validate_codec_tag(AVFormatContext *s, AVStream *st)
 }
 
 
+/* Return nonzero if max_interleave_delta may force output while the
+ * stream has no queued packet, see ff_interleave_packet_per_dts(). */
+static int interleave_can_skip(const AVStream *st)
+{
+    return st->codec->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
+           st->codec->codec_id != AV_CODEC_ID_VP8 &&
+           st->codec->codec_id != AV_CODEC_ID_VP9;
+}
+
 static int init_muxer(AVFormatContext *s, AVDictionary **options)
 {
     int ret = 0, i;
@@ -330,6 +339,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
             s->internal->nb_interleaved_streams++;
     }
 
+    /* audio_preload does not order packets consistently enough for the
+     * heap to give the same order as the list */
+    if (!of->interleave_packet && s->nb_streams && !s->audio_preload &&
+        !s->max_chunk_size && !s->max_chunk_duration) {
+        s->internal->interleave_heap  = av_malloc_array(s->nb_streams, sizeof(*s->internal->interleave_heap));
+        s->internal->interleave_first = av_mallocz_array(s->nb_streams, sizeof(*s->internal->interleave_first));
+        if (!s->internal->interleave_heap || !s->internal->interleave_first) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        for (i = 0; i < s->nb_streams; i++)
+            s->internal->interleave_nb_skippable += interleave_can_skip(s->streams[i]);
+    }
+
     if (!s->priv_data && of->priv_data_size > 0) {
         s->priv_data = av_mallocz(of->priv_data_size);
         if (!s->priv_data) {
@@ -584,7 +607,11 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
         ret = s->oformat->write_uncoded_frame(s, pkt->stream_index, &frame, 0);
         av_frame_free(&frame);
     } else {
+        FF_PERF_TIMER_START(perf_start);
         ret = s->oformat->write_packet(s, pkt);
+        FF_PERF_TIMER_STOP("av_write_packet", perf_start);
+        if (ret >= 0)
+            FF_PERF_COUNTER_ADD("av_write_packet_bytes", pkt->size);
     }
 
     if (s->flush_packets && s->pb && ret >= 0 && s->flags & AVFMT_FLAG_FLUSH_PACKETS)
@@ -651,6 +678,100 @@ int av_write_frame(AVFormatContext *s, AVPacket *pkt)
 
 #define CHUNK_START 0x1000
 
+static int interleave_compare_dts(AVFormatContext *s, AVPacket *next,
+                                  AVPacket *pkt);
+
+/* Return nonzero if the first packet of stream a goes after the one of
+ * stream b. */
+static int interleave_heap_after(AVFormatContext *s, int a, int b)
+{
+    AVPacketList **first = s->internal->interleave_first;
+    return interleave_compare_dts(s, &first[a]->pkt, &first[b]->pkt);
+}
+
+static void interleave_heap_up(AVFormatContext *s, int i)
+{
+    int *heap = s->internal->interleave_heap;
+
+    while (i > 0) {
+        int parent = (i - 1) >> 1;
+        if (!interleave_heap_after(s, heap[parent], heap[i]))
+            break;
+        FFSWAP(int, heap[parent], heap[i]);
+        i = parent;
+    }
+}
+
+static void interleave_heap_down(AVFormatContext *s, int i)
+{
+    int *heap = s->internal->interleave_heap;
+    int size  = s->internal->interleave_heap_size;
+
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && interleave_heap_after(s, heap[child], heap[child + 1]))
+            child++;
+        if (!interleave_heap_after(s, heap[i], heap[child]))
+            break;
+        FFSWAP(int, heap[i], heap[child]);
+        i = child;
+    }
+}
+
+/* Append a packet to the queue of its stream, O(log nb_streams) if the
+ * queue was empty and O(1) otherwise. */
+static void interleave_heap_add(AVFormatContext *s, AVPacketList *pktl)
+{
+    AVFormatInternal *internal = s->internal;
+    AVStream *st = s->streams[pktl->pkt.stream_index];
+    int64_t dts  = av_rescale_q(pktl->pkt.dts, st->time_base, AV_TIME_BASE_Q);
+
+    internal->interleave_max_dts = internal->interleave_heap_size ?
+                                   FFMAX(internal->interleave_max_dts, dts) : dts;
+    if (st->last_in_packet_buffer) {
+        st->last_in_packet_buffer->next = pktl;
+    } else {
+        internal->interleave_first[st->index] = pktl;
+        internal->interleave_heap[internal->interleave_heap_size] = st->index;
+        interleave_heap_up(s, internal->interleave_heap_size++);
+        internal->interleave_nb_skippable_queued += interleave_can_skip(st);
+    }
+    st->last_in_packet_buffer = pktl;
+}
+
+/* Remove the first packet of the stream at the top of the heap. */
+static AVPacketList *interleave_heap_pop(AVFormatContext *s)
+{
+    AVFormatInternal *internal = s->internal;
+    AVStream *st = s->streams[internal->interleave_heap[0]];
+    AVPacketList *pktl = internal->interleave_first[st->index];
+
+    if (pktl->next) {
+        internal->interleave_first[st->index] = pktl->next;
+    } else {
+        internal->interleave_first[st->index] = NULL;
+        st->last_in_packet_buffer = NULL;
+        internal->interleave_nb_skippable_queued -= interleave_can_skip(st);
+        internal->interleave_heap[0] =
+            internal->interleave_heap[--internal->interleave_heap_size];
+    }
+    if (internal->interleave_heap_size)
+        interleave_heap_down(s, 0);
+    pktl->next = NULL;
+    return pktl;
+}
+
+void ff_interleave_free_queue(AVFormatContext *s)
+{
+    while (s->internal->interleave_heap_size) {
+        AVPacketList *pktl = interleave_heap_pop(s);
+        av_free_packet(&pktl->pkt);
+        av_freep(&pktl);
+    }
+}
+
 int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
                              int (*compare)(AVFormatContext *, AVPacket *, AVPacket *))
 {
@@ -682,6 +803,11 @@ FF_ENABLE_DEPRECATION_WARNINGS
         }
     }
 
+    if (s->internal->interleave_heap) {
+        interleave_heap_add(s, this_pktl);
+        return 0;
+    }
+
     if (s->streams[pkt->stream_index]->last_in_packet_buffer) {
         next_point = &(st->last_in_packet_buffer->next);
     } else {
@@ -759,7 +885,8 @@ static int interleave_compare_dts(AVFormatContext *s, AVPacket *next,
 int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
                                  AVPacket *pkt, int flush)
 {
-    AVPacketList *pktl;
+    AVFormatInternal *internal = s->internal;
+    AVPacketList *pktl, *top = s->packet_buffer;
     int stream_count = 0;
     int noninterleaved_count = 0;
     int i, ret;
@@ -769,41 +896,53 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
             return ret;
     }
 
-    for (i = 0; i < s->nb_streams; i++) {
-        if (s->streams[i]->last_in_packet_buffer) {
-            ++stream_count;
-        } else if (s->streams[i]->codec->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
-                   s->streams[i]->codec->codec_id != AV_CODEC_ID_VP8 &&
-                   s->streams[i]->codec->codec_id != AV_CODEC_ID_VP9) {
-            ++noninterleaved_count;
+    if (internal->interleave_heap) {
+        stream_count         = internal->interleave_heap_size;
+        noninterleaved_count = internal->interleave_nb_skippable -
+                               internal->interleave_nb_skippable_queued;
+        top = stream_count ? internal->interleave_first[internal->interleave_heap[0]] : NULL;
+    } else {
+        for (i = 0; i < s->nb_streams; i++) {
+            if (s->streams[i]->last_in_packet_buffer) {
+                ++stream_count;
+            } else if (interleave_can_skip(s->streams[i])) {
+                ++noninterleaved_count;
+            }
         }
     }
 
-    if (s->internal->nb_interleaved_streams == stream_count)
+    if (internal->nb_interleaved_streams == stream_count)
         flush = 1;
 
     if (s->max_interleave_delta > 0 &&
-        s->packet_buffer &&
+        top &&
         !flush &&
-        s->internal->nb_interleaved_streams == stream_count+noninterleaved_count
+        internal->nb_interleaved_streams == stream_count+noninterleaved_count
     ) {
-        AVPacket *top_pkt = &s->packet_buffer->pkt;
+        AVPacket *top_pkt = &top->pkt;
         int64_t delta_dts = INT64_MIN;
         int64_t top_dts = av_rescale_q(top_pkt->dts,
                                        s->streams[top_pkt->stream_index]->time_base,
                                        AV_TIME_BASE_Q);
 
-        for (i = 0; i < s->nb_streams; i++) {
-            int64_t last_dts;
-            const AVPacketList *last = s->streams[i]->last_in_packet_buffer;
+        /* packets leave the queues in dts order, so the largest dts queued
+         * since they were last empty is the one of the last packet of some
+         * stream */
+        if (internal->interleave_heap) {
+            delta_dts = internal->interleave_max_dts - top_dts;
+        } else {
+            for (i = 0; i < s->nb_streams; i++) {
+                int64_t last_dts;
+                const AVPacketList *last = s->streams[i]->last_in_packet_buffer;
 
-            if (!last)
-                continue;
+                if (!last)
+                    continue;
 
-            last_dts = av_rescale_q(last->pkt.dts,
-                                    s->streams[i]->time_base,
-                                    AV_TIME_BASE_Q);
-            delta_dts = FFMAX(delta_dts, last_dts - top_dts);
+                last_dts = av_rescale_q(last->pkt.dts,
+                                        s->streams[i]->time_base,
+                                        AV_TIME_BASE_Q);
+                delta_dts = FFMAX(delta_dts, last_dts - top_dts);
+            }
         }
 
         if (delta_dts > s->max_interleave_delta) {
@@ -815,7 +954,13 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
         }
     }
 
-    if (stream_count && flush) {
+    if (stream_count && flush && internal->interleave_heap) {
+        pktl = interleave_heap_pop(s);
+        *out = pktl->pkt;
+        av_freep(&pktl);
+
+        return 1;
+    } else if (stream_count && flush) {
         AVStream *st;
         pktl = s->packet_buffer;
         *out = pktl->pkt;
@@ -883,7 +1028,9 @@ int av_interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
 
     for (;; ) {
         AVPacket opkt;
+        FF_PERF_TIMER_START(perf_start);
         int ret = interleave_packet(s, &opkt, pkt, flush);
+        FF_PERF_TIMER_STOP("av_interleave_packet", perf_start);
         if (pkt) {
             memset(pkt, 0, sizeof(*pkt));
             av_init_packet(pkt);
@@ -940,6 +1087,7 @@ fail:
        avio_flush(s->pb);
     if (ret == 0)
        ret = s->pb ? s->pb->error : 0;
+    ff_interleave_free_queue(s);
     for (i = 0; i < s->nb_streams; i++) {
         av_freep(&s->streams[i]->priv_data);
         av_freep(&s->streams[i]->index_entries);
@@ -173,6 +173,9 @@ const AVCodecTag ff_nut_video_tags[] = {
     { AV_CODEC_ID_RAWVIDEO, MKTAG(0xBA, 'G', 'R', 16  ) },
     { AV_CODEC_ID_RAWVIDEO, MKTAG(16,   'R', 'G', 0xBA) },
 
+    { AV_CODEC_ID_RAWVIDEO, MKTAG('P', '0', '1', '0') },
+    { AV_CODEC_ID_RAWVIDEO, MKTAG('0', '1', '0', 'P') },
+
     { AV_CODEC_ID_NONE,             0 }
 };
 
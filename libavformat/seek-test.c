@@ -76,6 +76,8 @@ int main(int argc, char **argv)
             frame_count = atoi(argv[i+1]);
         } else if(!strcmp(argv[i], "-duration")){
             duration = atoi(argv[i+1]);
+        } else if (argv[i][0] == '-' && i + 1 < argc) {
+            av_dict_set(&format_opts, argv[i] + 1, argv[i+1], 0);
         } else {
             argc = 1;
         }
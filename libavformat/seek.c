@@ -20,12 +20,23 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include "seek.h"
+#include "libavutil/avstring.h"
+#include "libavutil/crc.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/mem.h"
+#include "libavcodec/bytestream.h"
 #include "internal.h"
+#include "os_support.h"
 
 // NOTE: implementation should be moved here in another patch, to keep patches
 // separated.
@@ -506,3 +517,259 @@ void ff_free_parser_state(AVFormatContext *s, AVParserState *state)
     av_free(state->stream_states);
     av_free(state);
 }
+
+/*
+ * The sidecar index file is made of a header identifying the input, one
+ * record per stream followed by its index entries, and a CRC of all the
+ * preceding bytes. All fields are big-endian.
+ */
+#define SEEK_INDEX_TAG          MKBETAG('F', 'F', 'S', 'I')
+#define SEEK_INDEX_VERSION      2
+#define SEEK_INDEX_HEADER_SIZE  32
+#define SEEK_INDEX_STREAM_SIZE  16
+#define SEEK_INDEX_ENTRY_SIZE   28
+#define SEEK_INDEX_KEY_SIZE     65536
+
+/**
+ * @return the path of url if it is a local file, NULL otherwise
+ */
+static const char *local_path(const char *url)
+{
+    const char *proto = avio_find_protocol_name(url), *path = url;
+
+    if (!proto || strcmp(proto, "file"))
+        return NULL;
+    av_strstart(url, "file:", &path);
+    return path;
+}
+
+/**
+ * Identify the input by its size, its modification time when it is a local
+ * file, and a CRC of its first and last bytes.
+ */
+static int seek_index_key(AVFormatContext *s, int64_t *size, int64_t *mtime,
+                          uint32_t *crc)
+{
+    const AVCRC *table = av_crc_get_table(AV_CRC_32_IEEE);
+    const char *path = local_path(s->filename);
+    int64_t pos = avio_tell(s->pb), ret = 0;
+    struct stat st;
+    uint8_t *buf;
+    int i, len;
+
+    if ((*size = avio_size(s->pb)) < 0)
+        return *size;
+    *mtime = path && !stat(path, &st) ? st.st_mtime : 0;
+    if (!(buf = av_malloc(SEEK_INDEX_KEY_SIZE)))
+        return AVERROR(ENOMEM);
+
+    *crc = 0;
+    for (i = 0; i < 2; i++) {
+        ret = avio_seek(s->pb, i ? FFMAX(*size - SEEK_INDEX_KEY_SIZE, 0) : 0, SEEK_SET);
+        if (ret < 0)
+            break;
+        if ((len = avio_read(s->pb, buf, SEEK_INDEX_KEY_SIZE)) < 0) {
+            ret = len;
+            break;
+        }
+        *crc = av_crc(table, *crc, buf, len);
+    }
+    avio_seek(s->pb, pos, SEEK_SET);
+    av_free(buf);
+    return ret < 0 ? ret : 0;
+}
+
+static int seek_index_init(AVFormatContext *s)
+{
+    AVFormatInternal *internal = s->internal;
+    int ret;
+
+    if (internal->seek_index_state)
+        return internal->seek_index_state;
+    if (!local_path(s->seek_index)) {
+        av_log(s, AV_LOG_WARNING, "Seek index %s is not a local file\n", s->seek_index);
+        return internal->seek_index_state = AVERROR(ENOSYS);
+    }
+    if (!s->pb || !s->pb->seekable) {
+        av_log(s, AV_LOG_WARNING, "Seek index needs a seekable input\n");
+        return internal->seek_index_state = AVERROR(ENOSYS);
+    }
+    ret = seek_index_key(s, &internal->seek_index_file_size,
+                         &internal->seek_index_file_mtime, &internal->seek_index_crc);
+    return internal->seek_index_state = ret < 0 ? ret : 1;
+}
+
+static int seek_index_parse(AVFormatContext *s, const uint8_t *buf, int size, int add)
+{
+    AVFormatInternal *internal = s->internal;
+    GetByteContext gb;
+    unsigned int i, j;
+
+    bytestream2_init(&gb, buf, size);
+    if (bytestream2_get_be32(&gb) != SEEK_INDEX_TAG ||
+        bytestream2_get_be32(&gb) != SEEK_INDEX_VERSION)
+        return AVERROR_INVALIDDATA;
+    if (bytestream2_get_be64(&gb) != internal->seek_index_file_size  ||
+        bytestream2_get_be64(&gb) != internal->seek_index_file_mtime ||
+        bytestream2_get_be32(&gb) != internal->seek_index_crc ||
+        bytestream2_get_be32(&gb) != s->nb_streams)
+        return AVERROR(EINVAL);
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        unsigned int nb_entries;
+
+        if (bytestream2_get_bytes_left(&gb) < SEEK_INDEX_STREAM_SIZE)
+            return AVERROR_INVALIDDATA;
+        if (bytestream2_get_be32(&gb) != st->id ||
+            bytestream2_get_be32(&gb) != st->codec->codec_type ||
+            bytestream2_get_be32(&gb) != st->codec->codec_id)
+            return AVERROR(EINVAL);
+        nb_entries = bytestream2_get_be32(&gb);
+        if (nb_entries > bytestream2_get_bytes_left(&gb) / SEEK_INDEX_ENTRY_SIZE)
+            return AVERROR_INVALIDDATA;
+        if (!add) {
+            bytestream2_skip(&gb, nb_entries * SEEK_INDEX_ENTRY_SIZE);
+            continue;
+        }
+        for (j = 0; j < nb_entries; j++) {
+            int64_t pos       = bytestream2_get_be64(&gb);
+            int64_t timestamp = bytestream2_get_be64(&gb);
+            int size          = bytestream2_get_be32(&gb);
+            int distance      = bytestream2_get_be32(&gb);
+            int flags         = bytestream2_get_be32(&gb);
+            ff_add_index_entry(&st->index_entries, &st->nb_index_entries,
+                               &st->index_entries_allocated_size,
+                               pos, timestamp, size, distance, flags);
+        }
+    }
+    return bytestream2_get_bytes_left(&gb) ? AVERROR_INVALIDDATA : 0;
+}
+
+void ff_seek_index_load(AVFormatContext *s)
+{
+    AVFormatInternal *internal = s->internal;
+    AVIOContext *pb = NULL;
+    uint8_t *buf = NULL;
+    int64_t size;
+    int i, ret;
+
+    if (!s->seek_index || internal->seek_index_state || seek_index_init(s) < 0)
+        return;
+    if (avio_open2(&pb, s->seek_index, AVIO_FLAG_READ, &s->interrupt_callback, NULL) < 0)
+        return;
+
+    size = avio_size(pb);
+    if (size < SEEK_INDEX_HEADER_SIZE + 4 || size > INT_MAX) {
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+    if (!(buf = av_malloc(size))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if (avio_read(pb, buf, size) != size) {
+        ret = AVERROR(EIO);
+        goto end;
+    }
+    size -= 4;
+    if (av_crc(av_crc_get_table(AV_CRC_32_IEEE), 0, buf, size) != AV_RB32(buf + size)) {
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+    /* check everything before touching the existing index */
+    if ((ret = seek_index_parse(s, buf, size, 0)) < 0)
+        goto end;
+    seek_index_parse(s, buf, size, 1);
+
+    internal->seek_index_loaded = 1;
+    for (i = 0; i < s->nb_streams; i++)
+        internal->seek_index_entries += s->streams[i]->nb_index_entries;
+    av_log(s, AV_LOG_VERBOSE, "Loaded %d index entries from %s\n",
+           internal->seek_index_entries, s->seek_index);
+
+end:
+    if (ret == AVERROR(EINVAL))
+        av_log(s, AV_LOG_INFO, "Seek index %s does not match the input, ignoring it\n",
+               s->seek_index);
+    else if (ret < 0)
+        av_log(s, AV_LOG_WARNING, "Invalid seek index %s\n", s->seek_index);
+    av_free(buf);
+    avio_close(pb);
+}
+
+void ff_seek_index_save(AVFormatContext *s)
+{
+    AVFormatInternal *internal = s->internal;
+    AVIOContext *pb;
+    uint8_t *buf;
+    char *temp_filename = NULL;
+    int i, j, size, nb_entries = 0;
+
+    if (!s->seek_index)
+        return;
+    /* only an index built by reading the whole input is worth keeping */
+    if (internal->seek_index_incomplete || !s->pb || !s->pb->eof_reached) {
+        av_log(s, AV_LOG_DEBUG, "Input not read to the end, not writing seek index\n");
+        return;
+    }
+    for (i = 0; i < s->nb_streams; i++)
+        nb_entries += s->streams[i]->nb_index_entries;
+    if (nb_entries <= internal->seek_index_entries || seek_index_init(s) < 0)
+        return;
+
+    if (avio_open_dyn_buf(&pb) < 0)
+        return;
+    avio_wb32(pb, SEEK_INDEX_TAG);
+    avio_wb32(pb, SEEK_INDEX_VERSION);
+    avio_wb64(pb, internal->seek_index_file_size);
+    avio_wb64(pb, internal->seek_index_file_mtime);
+    avio_wb32(pb, internal->seek_index_crc);
+    avio_wb32(pb, s->nb_streams);
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+
+        avio_wb32(pb, st->id);
+        avio_wb32(pb, st->codec->codec_type);
+        avio_wb32(pb, st->codec->codec_id);
+        avio_wb32(pb, st->nb_index_entries);
+        for (j = 0; j < st->nb_index_entries; j++) {
+            const AVIndexEntry *ie = &st->index_entries[j];
+            avio_wb64(pb, ie->pos);
+            avio_wb64(pb, ie->timestamp);
+            avio_wb32(pb, ie->size);
+            avio_wb32(pb, ie->min_distance);
+            avio_wb32(pb, ie->flags);
+        }
+    }
+    if ((size = avio_close_dyn_buf(pb, &buf)) < 0)
+        return;
+
+    /* write to a temporary file first so that readers never see a
+     * partially written index, seek_index_init() made sure it is local */
+    if (!(temp_filename = av_asprintf("%s.tmp", s->seek_index)))
+        goto end;
+    if (avio_open2(&pb, temp_filename, AVIO_FLAG_WRITE, &s->interrupt_callback, NULL) < 0) {
+        av_log(s, AV_LOG_WARNING, "Cannot write seek index %s\n", temp_filename);
+        goto end;
+    }
+    avio_write(pb, buf, size);
+    avio_wb32(pb, av_crc(av_crc_get_table(AV_CRC_32_IEEE), 0, buf, size));
+    avio_flush(pb);
+    if (pb->error < 0) {
+        av_log(s, AV_LOG_WARNING, "Error writing seek index %s\n", temp_filename);
+        avio_close(pb);
+        unlink(local_path(temp_filename));
+        goto end;
+    }
+    avio_close(pb);
+    if (ff_rename(local_path(temp_filename), local_path(s->seek_index), s) < 0)
+        unlink(local_path(temp_filename));
+    else
+        av_log(s, AV_LOG_VERBOSE, "Wrote %d index entries to %s\n",
+               nb_entries, s->seek_index);
+
+end:
+    av_free(temp_filename);
+    av_free(buf);
+}
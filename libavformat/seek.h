@@ -119,4 +119,22 @@ void ff_restore_parser_state(AVFormatContext *s, AVParserState *state);
  */
 void ff_free_parser_state(AVFormatContext *s, AVParserState *state);
 
+/**
+ * Load the index entries stored in the sidecar index file set with the
+ * seek_index option, if it exists and matches the input.
+ * Does nothing when called again.
+ *
+ * @param s media file handle
+ */
+void ff_seek_index_load(AVFormatContext *s);
+
+/**
+ * Write the index entries of all streams to the sidecar index file set with
+ * the seek_index option, if the input was read to the end without seeking
+ * and the index grew since it was loaded.
+ *
+ * @param s media file handle
+ */
+void ff_seek_index_save(AVFormatContext *s);
+
 #endif /* AVFORMAT_SEEK_H */
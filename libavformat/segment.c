@@ -31,6 +31,7 @@
 
 #include "avformat.h"
 #include "internal.h"
+#include "segment_finalize.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/log.h"
@@ -112,6 +113,10 @@ typedef struct {
     SegmentListEntry cur_entry;
     SegmentListEntry *segment_list_entries;
     SegmentListEntry *segment_list_entries_end;
+
+    int async_finalize;    ///< close segments and write the list in a background thread
+    int sync;              ///< sync segments and list to stable storage
+    SegmentFinalizer *finalizer;
 } SegmentContext;
 
 static void print_csv_escaped_str(AVIOContext *ctx, const char *str)
@@ -243,8 +248,12 @@ static int segment_list_open(AVFormatContext *s)
     SegmentContext *seg = s->priv_data;
     int ret;
 
-    ret = avio_open2(&seg->list_pb, seg->list, AVIO_FLAG_WRITE,
-                     &s->interrupt_callback, NULL);
+    /* with a finalizer, the list is built in memory and written by it */
+    if (seg->finalizer)
+        ret = avio_open_dyn_buf(&seg->list_pb);
+    else
+        ret = avio_open2(&seg->list_pb, seg->list, AVIO_FLAG_WRITE,
+                         &s->interrupt_callback, NULL);
     if (ret < 0) {
         av_log(s, AV_LOG_ERROR, "Failed to open segment list '%s'\n", seg->list);
         return ret;
@@ -273,6 +282,20 @@ static int segment_list_open(AVFormatContext *s)
     return ret;
 }
 
+static void segment_list_close(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+
+    if (seg->finalizer) {
+        uint8_t *buf;
+        avio_close_dyn_buf(seg->list_pb, &buf);
+        av_free(buf);
+        seg->list_pb = NULL;
+    } else {
+        avio_closep(&seg->list_pb);
+    }
+}
+
 static void segment_list_print_entry(AVIOContext      *list_ioctx,
                                      ListType          list_type,
                                      const SegmentListEntry *list_entry,
@@ -346,7 +369,7 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
                 av_freep(&entry);
             }
 
-            avio_close(seg->list_pb);
+            segment_list_close(s);
             if ((ret = segment_list_open(s)) < 0)
                 goto end;
             for (entry = seg->segment_list_entries; entry; entry = entry->next)
@@ -364,7 +387,24 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
     seg->segment_count++;
 
 end:
-    avio_close(oc->pb);
+    if (seg->finalizer) {
+        int append = !(seg->list_size || seg->list_type == LIST_TYPE_M3U8);
+        uint8_t *buf = NULL;
+        int size = 0, err;
+
+        if (seg->list_pb) {
+            size = avio_close_dyn_buf(seg->list_pb, &buf);
+            seg->list_pb = NULL;
+            if (append && (err = avio_open_dyn_buf(&seg->list_pb)) < 0 && ret >= 0)
+                ret = err;
+        }
+        err = ff_segment_finalizer_submit(seg->finalizer, &oc->pb, oc->filename,
+                                          buf, size, append);
+        if (err < 0 && ret >= 0)
+            ret = err;
+    } else {
+        avio_close(oc->pb);
+    }
 
     return ret;
 }
@@ -616,6 +656,13 @@ static int seg_write_header(AVFormatContext *s)
             else if (av_match_ext(seg->list, "ffcat,ffconcat")) seg->list_type = LIST_TYPE_FFCONCAT;
             else                                      seg->list_type = LIST_TYPE_FLAT;
         }
+    }
+    if (seg->async_finalize || seg->sync) {
+        if ((ret = ff_segment_finalizer_alloc(&seg->finalizer, s, seg->list,
+                                              seg->sync, seg->async_finalize)) < 0)
+            goto fail;
+    }
+    if (seg->list) {
         if ((ret = segment_list_open(s)) < 0)
             goto fail;
     }
@@ -688,7 +735,8 @@ fail:
     av_dict_free(&options);
     if (ret) {
         if (seg->list)
-            avio_close(seg->list_pb);
+            segment_list_close(s);
+        ff_segment_finalizer_free(&seg->finalizer);
         if (seg->avf)
             avformat_free_context(seg->avf);
     }
@@ -809,7 +857,7 @@ static int seg_write_trailer(struct AVFormatContext *s)
     AVFormatContext *oc = seg->avf;
     SegmentListEntry *cur, *next;
 
-    int ret;
+    int ret, err;
     if (!seg->write_header_trailer) {
         if ((ret = segment_end(s, 0, 1)) < 0)
             goto fail;
@@ -821,7 +869,9 @@ static int seg_write_trailer(struct AVFormatContext *s)
     }
 fail:
     if (seg->list)
-        avio_close(seg->list_pb);
+        segment_list_close(s);
+    if ((err = ff_segment_finalizer_free(&seg->finalizer)) < 0 && ret >= 0)
+        ret = err;
 
     av_dict_free(&seg->format_options);
     av_opt_free(seg);
@@ -876,6 +926,8 @@ static const AVOption options[] = {
     { "write_header_trailer", "write a header to the first segment and a trailer to the last one", OFFSET(write_header_trailer), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E },
     { "reset_timestamps", "reset timestamps at the begin of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
     { "initial_offset", "set initial timestamp offset", OFFSET(initial_offset), AV_OPT_TYPE_DURATION, {.i64 = 0}, -INT64_MAX, INT64_MAX, E },
+    { "segment_async_finalize", "close segments and update the list in a background thread", OFFSET(async_finalize), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
+    { "segment_fsync", "sync segments to stable storage before listing them", OFFSET(sync), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
     { NULL },
 };
 
@@ -0,0 +1,337 @@
+/*
+ * Background finalization of segment files
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#elif HAVE_OS2THREADS
+#include "compat/os2threads.h"
+#endif
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavutil/time.h"
+#include "avformat.h"
+#include "segment_finalize.h"
+#include "url.h"
+
+/** Number of segments which may wait for finalization before the muxer blocks. */
+#define MAX_PENDING 16
+
+typedef struct FinalizeJob {
+    AVIOContext *pb;
+    char filename[1024];
+    uint8_t *list_buf;
+    int list_size;
+    int append;
+    int64_t submit_time;
+    struct FinalizeJob *next;
+} FinalizeJob;
+
+struct SegmentFinalizer {
+    void *log_ctx;
+    AVIOInterruptCB interrupt_callback;
+    char *list;
+    AVIOContext *list_pb;       ///< list opened for appending
+    int sync;
+    int threaded;
+    int error;                  ///< first error encountered
+
+    int nb_finalized;
+    int64_t max_wait;           ///< longest time a segment waited in the queue
+    int64_t max_close;          ///< longest time spent syncing and closing a segment
+
+#if HAVE_THREADS
+    FinalizeJob *first, *last;
+    int nb_pending;             ///< jobs queued or being processed
+    int finished;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+};
+
+/**
+ * Write out the buffered data of pb and, if it is a local file, sync it to
+ * stable storage.
+ */
+static int sync_file(AVIOContext *pb)
+{
+#if HAVE_FSYNC
+    URLContext *h = pb->opaque;
+    int fd;
+#endif
+
+    avio_flush(pb);
+    if (pb->error < 0)
+        return pb->error;
+#if HAVE_FSYNC
+    if (!h || strcmp(h->prot->name, "file"))
+        return 0;
+    fd = ffurl_get_file_handle(h);
+    if (fd >= 0 && fsync(fd) < 0)
+        return AVERROR(errno);
+#endif
+    return 0;
+}
+
+static int close_file(SegmentFinalizer *f, AVIOContext **pb)
+{
+    int ret = f->sync ? sync_file(*pb) : 0;
+
+    avio_flush(*pb);
+    if (!ret && (*pb)->error < 0)
+        ret = (*pb)->error;
+    avio_closep(pb);
+    return ret;
+}
+
+static int write_list(SegmentFinalizer *f, const uint8_t *buf, int size, int append)
+{
+    AVIOContext *pb = append ? f->list_pb : NULL;
+    int ret;
+
+    if (!pb) {
+        if ((ret = avio_open2(&pb, f->list, AVIO_FLAG_WRITE,
+                              &f->interrupt_callback, NULL)) < 0)
+            return ret;
+    }
+    avio_write(pb, buf, size);
+    if (append) {
+        f->list_pb = pb;
+        ret = f->sync ? sync_file(pb) : 0;
+        avio_flush(pb);
+        return ret < 0 ? ret : pb->error;
+    }
+    return close_file(f, &pb);
+}
+
+static int finalize(SegmentFinalizer *f, FinalizeJob *job)
+{
+    int64_t start = av_gettime_relative(), closed, end, size = 0;
+    int ret = 0;
+
+    if (job->pb) {
+        size = avio_tell(job->pb);
+        ret  = close_file(f, &job->pb);
+        if (ret < 0)
+            av_log(f->log_ctx, AV_LOG_ERROR, "Failed to finalize segment '%s': %s\n",
+                   job->filename, av_err2str(ret));
+    }
+    closed = av_gettime_relative();
+
+    /* f->error is only set by the thread finalizing the segments, so it
+     * needs no locking here. Once a segment has failed, the lists of the
+     * following ones would reference it, so the list is left as it was. */
+    if (ret >= 0 && !f->error && job->list_buf && f->list) {
+        ret = write_list(f, job->list_buf, job->list_size, job->append);
+        if (ret < 0)
+            av_log(f->log_ctx, AV_LOG_ERROR, "Failed to write segment list '%s': %s\n",
+                   f->list, av_err2str(ret));
+    }
+    end = av_gettime_relative();
+
+    av_log(f->log_ctx, AV_LOG_VERBOSE,
+           "segment:'%s' size:%"PRId64" finalized: wait:%.3fs close:%.3fs list:%.3fs\n",
+           job->filename, size, (start - job->submit_time) / 1000000.0,
+           (closed - start) / 1000000.0, (end - closed) / 1000000.0);
+    f->nb_finalized++;
+    f->max_wait  = FFMAX(f->max_wait,  start  - job->submit_time);
+    f->max_close = FFMAX(f->max_close, closed - start);
+
+    av_freep(&job->list_buf);
+    return ret;
+}
+
+#if HAVE_THREADS
+static void *finalize_thread(void *arg)
+{
+    SegmentFinalizer *f = arg;
+
+    pthread_mutex_lock(&f->mutex);
+    for (;;) {
+        FinalizeJob *job;
+        int ret;
+
+        while (!f->first && !f->finished)
+            pthread_cond_wait(&f->cond, &f->mutex);
+        if (!f->first)
+            break;
+        job = f->first;
+        if (!(f->first = job->next))
+            f->last = NULL;
+        pthread_mutex_unlock(&f->mutex);
+
+        ret = finalize(f, job);
+        av_free(job);
+
+        pthread_mutex_lock(&f->mutex);
+        if (ret < 0 && !f->error)
+            f->error = ret;
+        f->nb_pending--;
+        pthread_cond_signal(&f->cond);
+    }
+    pthread_mutex_unlock(&f->mutex);
+    return NULL;
+}
+#endif
+
+int ff_segment_finalizer_alloc(SegmentFinalizer **pf, AVFormatContext *s,
+                               const char *list, int sync, int threaded)
+{
+    SegmentFinalizer *f = av_mallocz(sizeof(*f));
+#if HAVE_THREADS
+    int ret;
+#endif
+
+    if (!f)
+        return AVERROR(ENOMEM);
+    f->log_ctx            = s;
+    f->interrupt_callback = s->interrupt_callback;
+    f->sync               = sync;
+    if (list && !(f->list = av_strdup(list))) {
+        av_free(f);
+        return AVERROR(ENOMEM);
+    }
+
+#if HAVE_THREADS
+    if (threaded) {
+        if ((ret = pthread_mutex_init(&f->mutex, NULL))) {
+            av_log(s, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", av_err2str(AVERROR(ret)));
+            goto fail;
+        }
+        if ((ret = pthread_cond_init(&f->cond, NULL))) {
+            av_log(s, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(AVERROR(ret)));
+            pthread_mutex_destroy(&f->mutex);
+            goto fail;
+        }
+        if ((ret = pthread_create(&f->thread, NULL, finalize_thread, f))) {
+            av_log(s, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(AVERROR(ret)));
+            pthread_cond_destroy(&f->cond);
+            pthread_mutex_destroy(&f->mutex);
+            goto fail;
+        }
+        f->threaded = 1;
+    }
+#else
+    if (threaded)
+        av_log(s, AV_LOG_WARNING,
+               "Threads are not supported, segments are finalized synchronously\n");
+#endif
+
+    *pf = f;
+    return 0;
+
+#if HAVE_THREADS
+fail:
+    av_free(f->list);
+    av_free(f);
+    return AVERROR(ret);
+#endif
+}
+
+int ff_segment_finalizer_submit(SegmentFinalizer *f, AVIOContext **pb,
+                                const char *filename, uint8_t *list_buf,
+                                int list_size, int append)
+{
+    FinalizeJob *job = av_mallocz(sizeof(*job));
+    int ret;
+
+    if (!job) {
+        if (pb)
+            avio_closep(pb);
+        av_free(list_buf);
+        return AVERROR(ENOMEM);
+    }
+    if (pb) {
+        job->pb = *pb;
+        *pb     = NULL;
+    }
+    av_strlcpy(job->filename, filename, sizeof(job->filename));
+    job->list_buf    = list_buf;
+    job->list_size   = list_size;
+    job->append      = append;
+    job->submit_time = av_gettime_relative();
+
+#if HAVE_THREADS
+    if (f->threaded) {
+        pthread_mutex_lock(&f->mutex);
+        while (f->nb_pending >= MAX_PENDING)
+            pthread_cond_wait(&f->cond, &f->mutex);
+        if (f->last)
+            f->last->next = job;
+        else
+            f->first = job;
+        f->last = job;
+        f->nb_pending++;
+        pthread_cond_signal(&f->cond);
+        ret = f->error;
+        pthread_mutex_unlock(&f->mutex);
+        return ret;
+    }
+#endif
+
+    ret = finalize(f, job);
+    av_free(job);
+    if (ret < 0 && !f->error)
+        f->error = ret;
+    return ret;
+}
+
+int ff_segment_finalizer_free(SegmentFinalizer **pf)
+{
+    SegmentFinalizer *f = *pf;
+    int ret;
+
+    if (!f)
+        return 0;
+
+#if HAVE_THREADS
+    if (f->threaded) {
+        pthread_mutex_lock(&f->mutex);
+        f->finished = 1;
+        pthread_cond_signal(&f->cond);
+        pthread_mutex_unlock(&f->mutex);
+
+        if ((ret = pthread_join(f->thread, NULL)))
+            av_log(f->log_ctx, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&f->cond);
+        pthread_mutex_destroy(&f->mutex);
+    }
+#endif
+
+    if (f->list_pb && (ret = close_file(f, &f->list_pb)) < 0 && !f->error)
+        f->error = ret;
+
+    av_log(f->log_ctx, AV_LOG_VERBOSE,
+           "%d segments finalized, max wait:%.3fs max close:%.3fs\n",
+           f->nb_finalized, f->max_wait / 1000000.0, f->max_close / 1000000.0);
+
+    ret = f->error;
+    av_free(f->list);
+    av_freep(pf);
+    return ret;
+}
@@ -0,0 +1,79 @@
+/*
+ * Background finalization of segment files
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_SEGMENT_FINALIZE_H
+#define AVFORMAT_SEGMENT_FINALIZE_H
+
+#include <stdint.h>
+
+#include "avformat.h"
+
+/**
+ * Closes the files of finished segments, optionally syncing them to stable
+ * storage, and then writes the segment list that references them.
+ *
+ * Segments are finalized in the order they are submitted, and the list
+ * submitted with a segment is written only once that segment has been
+ * closed successfully, so that a list never references a segment which is
+ * not complete yet. After a segment failed, the list is no longer updated. With a worker thread, this happens in the background
+ * and the muxing thread only waits when too many segments are pending.
+ */
+typedef struct SegmentFinalizer SegmentFinalizer;
+
+/**
+ * Create a segment finalizer.
+ *
+ * @param s        muxer used for logging and whose interrupt callback is
+ *                 used when opening the list
+ * @param list     name of the segment list file, may be NULL
+ * @param sync     sync segments and list to stable storage before closing
+ * @param threaded finalize segments in a worker thread
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int ff_segment_finalizer_alloc(SegmentFinalizer **pf, AVFormatContext *s,
+                               const char *list, int sync, int threaded);
+
+/**
+ * Hand a finished segment over to the finalizer.
+ *
+ * @param pb       the I/O context of the segment, opened with avio_open2();
+ *                 the finalizer takes ownership of it and sets *pb to NULL.
+ *                 May be NULL to only update the list.
+ * @param filename name of the segment, used in log messages
+ * @param list_buf content to write to the list once the segment is closed,
+ *                 allocated with av_malloc(); the finalizer takes ownership
+ *                 of it. May be NULL.
+ * @param list_size size of list_buf
+ * @param append   append list_buf to the list instead of replacing its
+ *                 content
+ * @return 0 on success, or the error of a previously submitted segment
+ */
+int ff_segment_finalizer_submit(SegmentFinalizer *f, AVIOContext **pb,
+                                const char *filename, uint8_t *list_buf,
+                                int list_size, int append);
+
+/**
+ * Finalize all pending segments, close the list and free the finalizer.
+ *
+ * @return 0 on success, or the first error encountered while finalizing
+ */
+int ff_segment_finalizer_free(SegmentFinalizer **pf);
+
+#endif /* AVFORMAT_SEGMENT_FINALIZE_H */
@@ -38,17 +38,29 @@ void ff_srtp_free(struct SRTPContext *s)
     s->hmac = NULL;
 }
 
+#define CTR_BLOCKS 16
+
 static void encrypt_counter(struct AVAES *aes, uint8_t *iv, uint8_t *outbuf,
                             int outlen)
 {
-    int i, j, outpos;
-    for (i = 0, outpos = 0; outpos < outlen; i++) {
-        uint8_t keystream[16];
-        AV_WB16(&iv[14], i);
-        av_aes_crypt(aes, keystream, iv, 1, NULL, 0);
-        for (j = 0; j < 16 && outpos < outlen; j++, outpos++)
-            outbuf[outpos] ^= keystream[j];
+    uint8_t counter[CTR_BLOCKS * 16], keystream[CTR_BLOCKS * 16];
+    int i = 0, j, outpos;
+
+    /* Generate the keystream for several counter blocks per call, so that
+     * the block cipher can process them back to back. */
+    for (outpos = 0; outpos < outlen; outpos += j) {
+        int len    = FFMIN(outlen - outpos, CTR_BLOCKS * 16);
+        int blocks = (len + 15) >> 4;
+        for (j = 0; j < blocks; j++, i++) {
+            memcpy(&counter[16 * j], iv, 14);
+            AV_WB16(&counter[16 * j + 14], i);
+        }
+        av_aes_crypt(aes, keystream, counter, blocks, NULL, 0);
+        for (j = 0; j < len; j++)
+            outbuf[outpos + j] ^= keystream[j];
     }
+    if (i)
+        AV_WB16(&iv[14], i - 1);
 }
 
 static void derive_key(struct AVAES *aes, const uint8_t *salt, int label,
@@ -19,14 +19,31 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#elif HAVE_OS2THREADS
+#include "compat/os2threads.h"
+#endif
 
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
 #include "libavutil/opt.h"
 #include "avformat.h"
 
 #define MAX_SLAVES 16
 
+/** What to do when a packet is written to a slave whose queue is full. */
+enum OverflowPolicy {
+    OVERFLOW_BLOCK,      ///< wait for the slave to catch up
+    OVERFLOW_DROP,       ///< drop packets up to the next keyframe of the stream
+    OVERFLOW_DISCONNECT, ///< stop writing to the slave
+};
+
 typedef struct {
     AVFormatContext *avf;
     AVBitStreamFilterContext **bsfs; ///< bitstream filters per stream
@@ -34,6 +51,32 @@ typedef struct {
     /** map from input to output streams indexes,
      * disabled output streams are set to -1 */
     int *stream_map;
+
+    /**
+     * Packets are written by a separate thread through a queue of at most
+     * queue_size packets, 0 if they are written synchronously.
+     */
+    int queue_size;
+    enum OverflowPolicy overflow;
+#if HAVE_THREADS
+    AVFifoBuffer *queue;        ///< queued AVPacket structs
+    int *wait_key;              ///< per output stream, drop packets until a keyframe
+    int thread_started;
+    int thread_done;            ///< the writer thread exited
+    int finished;               ///< no more packets will be queued
+    int disconnected;
+    int error;                  ///< error returned by the writer thread
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    /* statistics, dts are in AV_TIME_BASE units */
+    int64_t last_queued_dts;
+    int64_t last_written_dts;
+    int64_t max_lag;
+    int max_queued;
+    unsigned nb_dropped;
+#endif
 } TeeSlave;
 
 typedef struct TeeContext {
@@ -132,13 +175,196 @@ end:
     return ret;
 }
 
+#if HAVE_THREADS
+static int slave_interrupt_cb(void *opaque)
+{
+    TeeSlave *tee_slave = opaque;
+    return tee_slave->disconnected;
+}
+
+static int64_t slave_dts(TeeSlave *tee_slave, const AVPacket *pkt)
+{
+    if (pkt->dts == AV_NOPTS_VALUE)
+        return AV_NOPTS_VALUE;
+    return av_rescale_q(pkt->dts, tee_slave->avf->streams[pkt->stream_index]->time_base,
+                        AV_TIME_BASE_Q);
+}
+
+/** Free the queued packets, must be called with the mutex locked. */
+static void flush_queue(TeeSlave *tee_slave)
+{
+    AVPacket pkt;
+
+    while (av_fifo_size(tee_slave->queue) >= sizeof(pkt)) {
+        av_fifo_generic_read(tee_slave->queue, &pkt, sizeof(pkt), NULL);
+        av_free_packet(&pkt);
+    }
+}
+
+static void *slave_writer_thread(void *arg)
+{
+    TeeSlave *tee_slave = arg;
+    AVPacket pkt;
+    int64_t dts;
+    int ret;
+
+    pthread_mutex_lock(&tee_slave->mutex);
+    while (!tee_slave->disconnected) {
+        if (!av_fifo_size(tee_slave->queue)) {
+            if (tee_slave->finished)
+                break;
+            pthread_cond_wait(&tee_slave->cond, &tee_slave->mutex);
+            continue;
+        }
+        av_fifo_generic_read(tee_slave->queue, &pkt, sizeof(pkt), NULL);
+        pthread_cond_signal(&tee_slave->cond);
+        pthread_mutex_unlock(&tee_slave->mutex);
+
+        dts = slave_dts(tee_slave, &pkt);
+        ret = av_interleaved_write_frame(tee_slave->avf, &pkt);
+
+        pthread_mutex_lock(&tee_slave->mutex);
+        if (dts != AV_NOPTS_VALUE)
+            tee_slave->last_written_dts = dts;
+        if (ret < 0) {
+            tee_slave->error = ret;
+            break;
+        }
+    }
+    flush_queue(tee_slave);
+    tee_slave->thread_done = 1;
+    pthread_cond_signal(&tee_slave->cond);
+    pthread_mutex_unlock(&tee_slave->mutex);
+    return NULL;
+}
+
+static int start_slave_thread(void *log, TeeSlave *tee_slave)
+{
+    int ret;
+
+    tee_slave->queue    = av_fifo_alloc_array(tee_slave->queue_size, sizeof(AVPacket));
+    tee_slave->wait_key = av_calloc(tee_slave->avf->nb_streams, sizeof(*tee_slave->wait_key));
+    if (!tee_slave->queue || !tee_slave->wait_key)
+        return AVERROR(ENOMEM);
+    tee_slave->last_queued_dts = tee_slave->last_written_dts = AV_NOPTS_VALUE;
+
+    if ((ret = pthread_mutex_init(&tee_slave->mutex, NULL))) {
+        av_log(log, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&tee_slave->cond, NULL))) {
+        av_log(log, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(AVERROR(ret)));
+        pthread_mutex_destroy(&tee_slave->mutex);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&tee_slave->thread, NULL, slave_writer_thread, tee_slave))) {
+        av_log(log, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&tee_slave->cond);
+        pthread_mutex_destroy(&tee_slave->mutex);
+        return AVERROR(ret);
+    }
+    tee_slave->thread_started = 1;
+    return 0;
+}
+
+/**
+ * Wait for the writer thread to write the queued packets and exit.
+ *
+ * @return the error returned by the writer thread, if any
+ */
+static int stop_slave_thread(void *log, TeeSlave *tee_slave)
+{
+    int ret;
+
+    if (tee_slave->thread_started) {
+        pthread_mutex_lock(&tee_slave->mutex);
+        tee_slave->finished = 1;
+        pthread_cond_signal(&tee_slave->cond);
+        pthread_mutex_unlock(&tee_slave->mutex);
+
+        if ((ret = pthread_join(tee_slave->thread, NULL)))
+            av_log(log, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&tee_slave->cond);
+        pthread_mutex_destroy(&tee_slave->mutex);
+        tee_slave->thread_started = 0;
+
+        av_log(log, AV_LOG_VERBOSE, "Slave '%s': at most %d packets queued, "
+               "max lag %.3fs, %u packets dropped\n", tee_slave->avf->filename,
+               tee_slave->max_queued, tee_slave->max_lag / (double)AV_TIME_BASE,
+               tee_slave->nb_dropped);
+    }
+    av_fifo_freep(&tee_slave->queue);
+    av_freep(&tee_slave->wait_key);
+    return tee_slave->error;
+}
+
+/**
+ * Queue a packet for the writer thread, applying the overflow policy if
+ * the queue is full. The packet is always consumed.
+ */
+static int queue_packet(void *log, TeeSlave *tee_slave, AVPacket *pkt)
+{
+    int s = pkt->stream_index;
+    int key = pkt->flags & AV_PKT_FLAG_KEY;
+    int64_t dts = slave_dts(tee_slave, pkt);
+    int nb_queued, ret = 0;
+
+    pthread_mutex_lock(&tee_slave->mutex);
+    if (tee_slave->overflow == OVERFLOW_DROP && tee_slave->wait_key[s] && !key)
+        goto drop;
+    while (!av_fifo_space(tee_slave->queue) && !tee_slave->thread_done) {
+        if (tee_slave->overflow == OVERFLOW_DISCONNECT) {
+            av_log(log, AV_LOG_WARNING, "Slave '%s': queue full, disconnecting\n",
+                   tee_slave->avf->filename);
+            tee_slave->disconnected = 1;
+            flush_queue(tee_slave);
+            pthread_cond_signal(&tee_slave->cond);
+            break;
+        }
+        if (tee_slave->overflow == OVERFLOW_DROP && !key) {
+            tee_slave->wait_key[s] = 1;
+            goto drop;
+        }
+        pthread_cond_wait(&tee_slave->cond, &tee_slave->mutex);
+    }
+    if (tee_slave->thread_done || tee_slave->disconnected) {
+        ret = tee_slave->disconnected ? 0 : tee_slave->error;
+        av_free_packet(pkt);
+        goto end;
+    }
+
+    av_fifo_generic_write(tee_slave->queue, pkt, sizeof(*pkt), NULL);
+    pthread_cond_signal(&tee_slave->cond);
+    tee_slave->wait_key[s] = 0;
+
+    nb_queued = av_fifo_size(tee_slave->queue) / sizeof(*pkt);
+    tee_slave->max_queued = FFMAX(tee_slave->max_queued, nb_queued);
+    if (dts != AV_NOPTS_VALUE) {
+        tee_slave->last_queued_dts = dts;
+        if (tee_slave->last_written_dts != AV_NOPTS_VALUE)
+            tee_slave->max_lag = FFMAX(tee_slave->max_lag,
+                                       dts - tee_slave->last_written_dts);
+    }
+    goto end;
+
+drop:
+    if (!tee_slave->nb_dropped++)
+        av_log(log, AV_LOG_WARNING, "Slave '%s': queue full, dropping packets\n",
+               tee_slave->avf->filename);
+    av_free_packet(pkt);
+end:
+    pthread_mutex_unlock(&tee_slave->mutex);
+    return ret;
+}
+#endif
+
 static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
 {
     int i, ret;
     AVDictionary *options = NULL;
     AVDictionaryEntry *entry;
     char *filename;
-    char *format = NULL, *select = NULL;
+    char *format = NULL, *select = NULL, *queue_size = NULL, *overflow = NULL;
     AVFormatContext *avf2 = NULL;
     AVStream *st, *st2;
     int stream_count;
@@ -156,6 +382,41 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
 
     STEAL_OPTION("f", format);
     STEAL_OPTION("select", select);
+    STEAL_OPTION("queue_size", queue_size);
+    STEAL_OPTION("overflow", overflow);
+
+    if (queue_size) {
+        char *tail;
+        long n = strtol(queue_size, &tail, 10);
+        if (*tail || n < 0 || n > INT_MAX / sizeof(AVPacket)) {
+            av_log(avf, AV_LOG_ERROR, "Invalid queue_size '%s' for output '%s'\n",
+                   queue_size, slave);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+        tee_slave->queue_size = n;
+    }
+    if (overflow) {
+        if (!strcmp(overflow, "block")) {
+            tee_slave->overflow = OVERFLOW_BLOCK;
+        } else if (!strcmp(overflow, "drop")) {
+            tee_slave->overflow = OVERFLOW_DROP;
+        } else if (!strcmp(overflow, "disconnect")) {
+            tee_slave->overflow = OVERFLOW_DISCONNECT;
+        } else {
+            av_log(avf, AV_LOG_ERROR, "Invalid overflow policy '%s' for output '%s'\n",
+                   overflow, slave);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+    }
+#if !HAVE_THREADS
+    if (tee_slave->queue_size) {
+        av_log(avf, AV_LOG_ERROR, "queue_size requires threads support\n");
+        ret = AVERROR(ENOSYS);
+        goto end;
+    }
+#endif
 
     ret = avformat_alloc_output_context2(&avf2, NULL, format, filename);
     if (ret < 0)
@@ -205,8 +466,15 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
             goto end;
     }
 
+#if HAVE_THREADS
+    if (tee_slave->queue_size) {
+        avf2->interrupt_callback.callback = slave_interrupt_cb;
+        avf2->interrupt_callback.opaque   = tee_slave;
+    }
+#endif
     if (!(avf2->oformat->flags & AVFMT_NOFILE)) {
-        if ((ret = avio_open(&avf2->pb, filename, AVIO_FLAG_WRITE)) < 0) {
+        if ((ret = avio_open2(&avf2->pb, filename, AVIO_FLAG_WRITE,
+                              &avf2->interrupt_callback, NULL)) < 0) {
             av_log(avf, AV_LOG_ERROR, "Slave '%s': error opening: %s\n",
                    slave, av_err2str(ret));
             goto end;
@@ -278,9 +546,16 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
         goto end;
     }
 
+#if HAVE_THREADS
+    if (tee_slave->queue_size)
+        ret = start_slave_thread(avf, tee_slave);
+#endif
+
 end:
     av_free(format);
     av_free(select);
+    av_free(queue_size);
+    av_free(overflow);
     av_dict_free(&options);
     return ret;
 }
@@ -294,6 +569,9 @@ static void close_slaves(AVFormatContext *avf)
     for (i = 0; i < tee->nb_slaves; i++) {
         avf2 = tee->slaves[i].avf;
 
+#if HAVE_THREADS
+        stop_slave_thread(avf, &tee->slaves[i]);
+#endif
         for (j = 0; j < avf2->nb_streams; j++) {
             AVBitStreamFilterContext *bsf_next, *bsf = tee->slaves[i].bsfs[j];
             while (bsf) {
@@ -362,12 +640,12 @@ static int tee_write_header(AVFormatContext *avf)
     for (i = 0; i < nb_slaves; i++) {
         if ((ret = open_slave(avf, slaves[i], &tee->slaves[i])) < 0)
             goto fail;
+        /* opened slaves may run a writer thread, close_slaves() stops it */
+        tee->nb_slaves = i + 1;
         log_slave(&tee->slaves[i], avf, AV_LOG_VERBOSE);
         av_freep(&slaves[i]);
     }
 
-    tee->nb_slaves = nb_slaves;
-
     for (i = 0; i < avf->nb_streams; i++) {
         int j, mapped = 0;
         for (j = 0; j < tee->nb_slaves; j++)
@@ -432,12 +710,22 @@ static int tee_write_trailer(AVFormatContext *avf)
     unsigned i;
 
     for (i = 0; i < tee->nb_slaves; i++) {
+        /* errors of disconnected slaves have already been reported */
+        int ignore_errors = 0;
+
         avf2 = tee->slaves[i].avf;
-        if ((ret = av_write_trailer(avf2)) < 0)
+#if HAVE_THREADS
+        ret = stop_slave_thread(avf, &tee->slaves[i]);
+        ignore_errors = tee->slaves[i].disconnected;
+        if (ret < 0 && !ignore_errors)
+            if (!ret_all)
+                ret_all = ret;
+#endif
+        if ((ret = av_write_trailer(avf2)) < 0 && !ignore_errors)
             if (!ret_all)
                 ret_all = ret;
         if (!(avf2->oformat->flags & AVFMT_NOFILE)) {
-            if ((ret = avio_close(avf2->pb)) < 0)
+            if ((ret = avio_close(avf2->pb)) < 0 && !ignore_errors)
                 if (!ret_all)
                     ret_all = ret;
             avf2->pb = NULL;
@@ -478,7 +766,13 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
         pkt2.stream_index = s2;
 
         filter_packet(avf2, &pkt2, avf2, tee->slaves[i].bsfs[s2]);
-        if ((ret = av_interleaved_write_frame(avf2, &pkt2)) < 0)
+#if HAVE_THREADS
+        if (tee->slaves[i].queue_size)
+            ret = queue_packet(avf, &tee->slaves[i], &pkt2);
+        else
+#endif
+        ret = av_interleaved_write_frame(avf2, &pkt2);
+        if (ret < 0)
             if (!ret_all)
                 ret_all = ret;
     }
@@ -25,6 +25,9 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE    /* Needed for sendmmsg() and recvmmsg() */
+#endif
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -55,6 +58,7 @@
 
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
+#define UDP_MAX_BATCH_SIZE 1024
 
 typedef struct {
     const AVClass *class;
@@ -84,8 +88,32 @@ typedef struct {
     int remaining_in_dg;
     char *local_addr;
     int packet_size;
+    int packet_align;
     int timeout;
     struct sockaddr_storage local_addr_storage;
+
+    /* batched sending and receiving */
+    int batch_size;
+    uint8_t *batch_buf;                 ///< batch_size slots of batch_slot_size bytes
+    int batch_slot_size;
+    int batch_count;                    ///< datagrams queued for sending
+    int batch_delay;                    ///< longest time a datagram may stay queued, in microseconds
+    int64_t batch_start;                ///< time the first queued datagram was queued
+    int *batch_len;
+#if HAVE_SENDMMSG || HAVE_RECVMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+#endif
+
+    /* pacing */
+    int64_t bitrate;
+    int64_t pace_start;
+    int64_t pace_bytes;
+
+    /* statistics */
+    int64_t rx_overruns;
+    int64_t rx_truncated;
+    int64_t tx_batches;
 } UDPContext;
 
 #define OFFSET(x) offsetof(UDPContext, x)
@@ -104,6 +132,13 @@ static const AVOption options[] = {
 {"fifo_size", "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
 {"overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D },
 {"timeout", "set raise error timeout (only in read mode)", OFFSET(timeout), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, D },
+{"batch_size", "set the number of datagrams sent or received per system call", OFFSET(batch_size), AV_OPT_TYPE_INT, {.i64 = 1}, 1, UDP_MAX_BATCH_SIZE, D|E },
+{"batch_delay", "set the time after which an incomplete batch is sent (in microseconds)", OFFSET(batch_delay), AV_OPT_TYPE_INT, {.i64 = 10000}, 0, INT_MAX, E },
+{"pkt_align", "round the packet size down to a multiple of this value (188 for MPEG-TS)", OFFSET(packet_align), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, E },
+{"bitrate", "pace sending to this bitrate (in bits per second)", OFFSET(bitrate), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E },
+{"rx_overruns", "number of datagrams dropped because the circular buffer was full", OFFSET(rx_overruns), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+{"rx_truncated", "number of datagrams truncated because they did not fit the buffer", OFFSET(rx_truncated), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+{"tx_batches", "number of system calls used to send datagrams", OFFSET(tx_batches), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
 {NULL}
 };
 
@@ -445,6 +480,42 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+/**
+ * Receive up to batch_size datagrams into the slots of batch_buf, each
+ * slot starting with 4 bytes reserved for the length.
+ *
+ * @return number of datagrams received or a negative error code
+ */
+static int udp_recv_batch(UDPContext *s)
+{
+    int len;
+#if HAVE_RECVMMSG
+    if (s->batch_size > 1) {
+        int i, n;
+
+        for (i = 0; i < s->batch_size; i++) {
+            s->iov[i].iov_base = s->batch_buf + i * s->batch_slot_size + 4;
+            s->iov[i].iov_len  = s->batch_slot_size - 4;
+            memset(&s->msgs[i].msg_hdr, 0, sizeof(s->msgs[i].msg_hdr));
+            s->msgs[i].msg_hdr.msg_iov    = &s->iov[i];
+            s->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        /* return as soon as at least one datagram is available */
+        n = recvmmsg(s->udp_fd, s->msgs, s->batch_size, MSG_WAITFORONE, NULL);
+        if (n < 0)
+            return ff_neterrno();
+        for (i = 0; i < n; i++)
+            s->batch_len[i] = s->msgs[i].msg_len;
+        return n;
+    }
+#endif
+    len = recv(s->udp_fd, s->batch_buf + 4, s->batch_slot_size - 4, 0);
+    if (len < 0)
+        return ff_neterrno();
+    s->batch_len[0] = len;
+    return 1;
+}
+
 static void *circular_buffer_task( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -459,40 +530,45 @@ static void *circular_buffer_task( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int i, n;
 
         pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+        n = udp_recv_batch(s);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
-            if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
+        if (n < 0) {
+            if (n != AVERROR(EAGAIN) && n != AVERROR(EINTR)) {
+                s->circular_buffer_error = n;
                 goto end;
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
-
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+        for (i = 0; i < n; i++) {
+            uint8_t *slot = s->batch_buf + i * s->batch_slot_size;
+            int len = s->batch_len[i];
+
+            AV_WL32(slot, len);
+            if(av_fifo_space(s->fifo) < len + 4) {
+                /* No Space left */
+                s->rx_overruns++;
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
             }
+            av_fifo_generic_write(s->fifo, slot, len+4, NULL);
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
         pthread_cond_signal(&s->cond);
     }
 
@@ -524,6 +600,46 @@ static int parse_source_list(char *buf, char **sources, int *num_sources,
     return 0;
 }
 
+static void udp_free_batch(UDPContext *s)
+{
+    if (s->batch_buf != s->tmp)
+        av_freep(&s->batch_buf);
+    s->batch_buf = NULL;
+    av_freep(&s->batch_len);
+#if HAVE_SENDMMSG || HAVE_RECVMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+#endif
+}
+
+static int udp_alloc_batch(UDPContext *s, int is_output)
+{
+#if !HAVE_RECVMMSG
+    /* datagrams are received one by one anyway */
+    if (!is_output)
+        s->batch_size = 1;
+#endif
+    if (!(s->batch_len = av_malloc_array(s->batch_size, sizeof(*s->batch_len))))
+        return AVERROR(ENOMEM);
+    if (s->batch_size == 1) {
+        s->batch_buf       = s->tmp;
+        s->batch_slot_size = sizeof(s->tmp);
+        return 0;
+    }
+
+    s->batch_slot_size = is_output ? s->packet_size : sizeof(s->tmp);
+    s->batch_buf = av_malloc_array(s->batch_size, s->batch_slot_size);
+#if HAVE_SENDMMSG || HAVE_RECVMMSG
+    s->msgs = av_mallocz_array(s->batch_size, sizeof(*s->msgs));
+    s->iov  = av_mallocz_array(s->batch_size, sizeof(*s->iov));
+    if (!s->msgs || !s->iov)
+        return AVERROR(ENOMEM);
+#endif
+    if (!s->batch_buf)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
 /* put it in UDP context */
 /* return non zero if error */
 static int udp_open(URLContext *h, const char *uri, int flags)
@@ -606,9 +722,19 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             s->timeout = strtol(buf, NULL, 10);
         if (is_output && av_find_info_tag(buf, sizeof(buf), "broadcast", p))
             s->is_broadcast = strtol(buf, NULL, 10);
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p))
+            s->batch_size = av_clip(strtol(buf, NULL, 10), 1, UDP_MAX_BATCH_SIZE);
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "batch_delay", p))
+            s->batch_delay = strtol(buf, NULL, 10);
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "pkt_align", p))
+            s->packet_align = strtol(buf, NULL, 10);
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "bitrate", p))
+            s->bitrate = strtoll(buf, NULL, 10);
     }
     /* handling needed to support options picking from both AVOption and URL */
     s->circular_buffer_size *= 188;
+    if (s->packet_align > 0 && s->packet_size >= s->packet_align)
+        s->packet_size -= s->packet_size % s->packet_align;
     if (flags & AVIO_FLAG_WRITE) {
         h->max_packet_size = s->packet_size;
     } else {
@@ -737,6 +863,9 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->udp_fd = udp_fd;
 
+    if (udp_alloc_batch(s, is_output) < 0)
+        goto fail;
+
 #if HAVE_PTHREAD_CANCEL
     if (!is_output && s->circular_buffer_size) {
         int ret;
@@ -773,6 +902,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+    udp_free_batch(s);
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -797,6 +927,7 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
                 av_fifo_generic_read(s->fifo, tmp, 4, NULL);
                 avail= AV_RL32(tmp);
                 if(avail > size){
+                    s->rx_truncated++;
                     av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
                     avail= size;
                 }
@@ -839,11 +970,133 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+/**
+ * @return the time at which pacing allows sending size more bytes after
+ *         those already sent
+ */
+static int64_t udp_pace_target(UDPContext *s, int64_t size)
+{
+    return s->pace_start + av_rescale(s->pace_bytes + size, 8 * 1000000LL, s->bitrate);
+}
+
+/**
+ * Delay sending so that the output does not exceed the requested bitrate.
+ */
+static void udp_pace(UDPContext *s, int size)
+{
+    int64_t now, target;
+
+    if (!s->bitrate)
+        return;
+
+    now = av_gettime_relative();
+    if (!s->pace_start)
+        s->pace_start = now;
+    target = udp_pace_target(s, 0);
+    if (target > now) {
+        av_usleep(target - now);
+    } else if (now - target > 1000000) {
+        /* the input stalled, do not send a burst to catch up */
+        s->pace_start = now;
+        s->pace_bytes = 0;
+    }
+    s->pace_bytes += size;
+}
+
+static int udp_send_batch(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    int i, sent = 0, ret = 0, size = 0;
+
+    for (i = 0; i < s->batch_count; i++)
+        size += s->batch_len[i];
+    udp_pace(s, size);
+
+    while (sent < s->batch_count) {
+        if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+            ret = ff_network_wait_fd(s->udp_fd, 1);
+            if (ret < 0)
+                break;
+        }
+#if HAVE_SENDMMSG
+        for (i = sent; i < s->batch_count; i++) {
+            s->iov[i].iov_base = s->batch_buf + i * s->batch_slot_size;
+            s->iov[i].iov_len  = s->batch_len[i];
+            memset(&s->msgs[i].msg_hdr, 0, sizeof(s->msgs[i].msg_hdr));
+            s->msgs[i].msg_hdr.msg_iov    = &s->iov[i];
+            s->msgs[i].msg_hdr.msg_iovlen = 1;
+            if (!s->is_connected) {
+                s->msgs[i].msg_hdr.msg_name    = &s->dest_addr;
+                s->msgs[i].msg_hdr.msg_namelen = s->dest_addr_len;
+            }
+        }
+        ret = sendmmsg(s->udp_fd, s->msgs + sent, s->batch_count - sent, 0);
+#else
+        if (!s->is_connected)
+            ret = sendto(s->udp_fd, s->batch_buf + sent * s->batch_slot_size,
+                         s->batch_len[sent], 0,
+                         (struct sockaddr *) &s->dest_addr, s->dest_addr_len);
+        else
+            ret = send(s->udp_fd, s->batch_buf + sent * s->batch_slot_size,
+                       s->batch_len[sent], 0);
+        ret = FFMIN(ret, 1);
+#endif
+        s->tx_batches++;
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret == AVERROR(EINTR) ||
+                (ret == AVERROR(EAGAIN) && !(h->flags & AVIO_FLAG_NONBLOCK)))
+                continue;
+            break;
+        }
+        sent += ret;
+    }
+
+    /* datagrams that could not be sent are dropped, like with send() */
+    s->batch_count = 0;
+    return ret < 0 ? ret : 0;
+}
+
+/**
+ * Check whether an incomplete batch must be sent now: its first datagram
+ * has been queued for batch_delay, or pacing would hold the batch back for
+ * longer than that anyway.
+ */
+static int udp_batch_due(UDPContext *s)
+{
+    int64_t now = av_gettime_relative();
+    int i, size = 0;
+
+    if (now - s->batch_start >= s->batch_delay)
+        return 1;
+    if (!s->bitrate)
+        return 0;
+    if (!s->pace_start)
+        s->pace_start = now;
+    for (i = 0; i < s->batch_count; i++)
+        size += s->batch_len[i];
+    return udp_pace_target(s, size) - now > s->batch_delay;
+}
+
 static int udp_write(URLContext *h, const uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
     int ret;
 
+    if (s->batch_size > 1 && size <= s->batch_slot_size) {
+        if (!s->batch_count)
+            s->batch_start = av_gettime_relative();
+        memcpy(s->batch_buf + s->batch_count * s->batch_slot_size, buf, size);
+        s->batch_len[s->batch_count++] = size;
+        if ((s->batch_count == s->batch_size || udp_batch_due(s)) &&
+            (ret = udp_send_batch(h)) < 0)
+            return ret;
+        return size;
+    }
+    if (s->batch_count && (ret = udp_send_batch(h)) < 0)
+        return ret;
+
+    udp_pace(s, size);
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
@@ -856,6 +1109,7 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
                       s->dest_addr_len);
     } else
         ret = send(s->udp_fd, buf, size, 0);
+    s->tx_batches++;
 
     return ret < 0 ? ff_neterrno() : ret;
 }
@@ -864,6 +1118,8 @@ static int udp_close(URLContext *h)
 {
     UDPContext *s = h->priv_data;
 
+    if (s->batch_count)
+        udp_send_batch(h);
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr,(struct sockaddr *)&s->local_addr_storage);
     closesocket(s->udp_fd);
@@ -879,6 +1135,7 @@ static int udp_close(URLContext *h)
     }
 #endif
     av_fifo_freep(&s->fifo);
+    udp_free_batch(s);
     return 0;
 }
 
@@ -87,6 +87,12 @@ typedef struct URLProtocol {
     const AVClass *priv_data_class;
     int flags;
     int (*url_check)(URLContext *h, int mask);
+    /**
+     * Get a read only mapping of the resource, for protocols which can
+     * provide one. The mapping stays valid until the next read, seek or
+     * close call on the context.
+     */
+    int (*url_get_mapping)(URLContext *h, const uint8_t **data, int64_t *size);
 } URLProtocol;
 
 /**
@@ -44,8 +44,10 @@
 #include "audiointerleave.h"
 #include "avformat.h"
 #include "avio_internal.h"
+#include "http.h"
 #include "id3v2.h"
 #include "internal.h"
+#include "seek.h"
 #include "metadata.h"
 #if CONFIG_NETWORK
 #include "network.h"
@@ -1272,6 +1274,17 @@ static int64_t ts_to_samples(AVStream *st, int64_t ts)
     return av_rescale(ts, st->time_base.num * st->codec->sample_rate, st->time_base.den);
 }
 
+/**
+ * Return 1 if the index must be built from the key frames read, either
+ * for seeking in formats lacking an index or for the sidecar seek index.
+ */
+static int has_generic_index(AVFormatContext *s)
+{
+    return s->iformat->flags & AVFMT_GENERIC_INDEX ||
+           (s->seek_index && s->internal->seek_index_state >= 0 &&
+            !s->iformat->read_seek && !s->iformat->read_seek2);
+}
+
 static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
 {
     int ret = 0, i, got_packet = 0;
@@ -1339,7 +1352,7 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
             /* no parsing needed: we just output the packet as is */
             *pkt = cur_pkt;
             compute_pkt_fields(s, st, NULL, pkt);
-            if ((s->iformat->flags & AVFMT_GENERIC_INDEX) &&
+            if (has_generic_index(s) &&
                 (pkt->flags & AV_PKT_FLAG_KEY) && pkt->dts != AV_NOPTS_VALUE) {
                 ff_reduce_index(s, st->index);
                 av_add_index_entry(st, pkt->pos, pkt->dts,
@@ -1512,7 +1525,7 @@ int av_read_frame(AVFormatContext *s, AVPacket *pkt)
 return_packet:
 
     st = s->streams[pkt->stream_index];
-    if ((s->iformat->flags & AVFMT_GENERIC_INDEX) && pkt->flags & AV_PKT_FLAG_KEY) {
+    if (has_generic_index(s) && pkt->flags & AV_PKT_FLAG_KEY) {
         ff_reduce_index(s, st->index);
         av_add_index_entry(st, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
     }
@@ -1654,17 +1667,24 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
     if (is_relative(timestamp)) //FIXME this maintains previous behavior but we should shift by the correct offset once known
         timestamp -= RELATIVE_TS_BASE;
 
-    entries = av_fast_realloc(*index_entries,
-                              index_entries_allocated_size,
-                              (*nb_index_entries + 1) *
-                              sizeof(AVIndexEntry));
-    if (!entries)
-        return -1;
-
-    *index_entries = entries;
+    if ((*nb_index_entries + 1) * sizeof(AVIndexEntry) > *index_entries_allocated_size) {
+        /* grow geometrically so that building the index while reading
+         * stays amortized O(1) per entry */
+        unsigned int new_size = *nb_index_entries + 1;
+        new_size = FFMIN(new_size + new_size / 2 + 16, UINT_MAX / sizeof(AVIndexEntry));
+        entries  = av_realloc(*index_entries, new_size * sizeof(AVIndexEntry));
+        if (!entries)
+            return -1;
+        *index_entries                = entries;
+        *index_entries_allocated_size = new_size * sizeof(AVIndexEntry);
+    }
+    entries = *index_entries;
 
-    index = ff_index_search_timestamp(*index_entries, *nb_index_entries,
-                                      timestamp, AVSEEK_FLAG_ANY);
+    if (!*nb_index_entries || entries[*nb_index_entries - 1].timestamp < timestamp)
+        index = -1;
+    else
+        index = ff_index_search_timestamp(entries, *nb_index_entries,
+                                          timestamp, AVSEEK_FLAG_ANY);
 
     if (index < 0) {
         index = (*nb_index_entries)++;
@@ -2048,12 +2068,39 @@ static int seek_frame_generic(AVFormatContext *s, int stream_index,
     return 0;
 }
 
+/**
+ * Seek to an entry of an index loaded from the sidecar seek index, if the
+ * index covers the timestamp.
+ */
+static int seek_frame_index(AVFormatContext *s, int stream_index,
+                            int64_t timestamp, int flags)
+{
+    AVStream *st = s->streams[stream_index];
+    AVIndexEntry *ie;
+    int64_t ret;
+    int index;
+
+    index = av_index_search_timestamp(st, timestamp, flags);
+    if (index < 0 || timestamp > st->index_entries[st->nb_index_entries - 1].timestamp)
+        return -1;
+
+    ie = &st->index_entries[index];
+    if ((ret = avio_seek(s->pb, ie->pos, SEEK_SET)) < 0)
+        return ret;
+    ff_update_cur_dts(s, st, ie->timestamp);
+
+    return 0;
+}
+
 static int seek_frame_internal(AVFormatContext *s, int stream_index,
                                int64_t timestamp, int flags)
 {
     int ret;
     AVStream *st;
 
+    ff_seek_index_load(s);
+    s->internal->seek_index_incomplete = 1;
+
     if (flags & AVSEEK_FLAG_BYTE) {
         if (s->iformat->flags & AVFMT_NO_BYTE_SEEK)
             return -1;
@@ -2084,6 +2131,9 @@ static int seek_frame_internal(AVFormatContext *s, int stream_index,
     if (s->iformat->read_timestamp &&
         !(s->iformat->flags & AVFMT_NOBINSEARCH)) {
         ff_read_frame_flush(s);
+        if (s->internal->seek_index_loaded &&
+            seek_frame_index(s, stream_index, timestamp, flags) >= 0)
+            return 0;
         return ff_seek_frame_binary(s, stream_index, timestamp, flags);
     } else if (!(s->iformat->flags & AVFMT_NOGENSEARCH)) {
         ff_read_frame_flush(s);
@@ -2130,6 +2180,7 @@ int avformat_seek_file(AVFormatContext *s, int stream_index, int64_t min_ts,
     if (s->iformat->read_seek2) {
         int ret;
         ff_read_frame_flush(s);
+        s->internal->seek_index_incomplete = 1;
 
         if (stream_index == -1 && s->nb_streams == 1) {
             AVRational time_base = s->streams[0]->time_base;
@@ -3382,6 +3433,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 
     compute_chapters_end(ic);
 
+    ff_seek_index_load(ic);
+
 find_stream_info_err:
     for (i = 0; i < ic->nb_streams; i++) {
         st = ic->streams[i];
@@ -3534,6 +3587,8 @@ void avformat_free_context(AVFormatContext *s)
         return;
 
     av_opt_free(s);
+    if (s->internal)
+        ff_interleave_free_queue(s);
     if (s->iformat && s->iformat->priv_class && s->priv_data)
         av_opt_free(s->priv_data);
     if (s->oformat && s->oformat->priv_class && s->priv_data)
@@ -3556,6 +3611,10 @@ void avformat_free_context(AVFormatContext *s)
     av_freep(&s->chapters);
     av_dict_free(&s->metadata);
     av_freep(&s->streams);
+    if (s->internal) {
+        av_freep(&s->internal->interleave_heap);
+        av_freep(&s->internal->interleave_first);
+    }
     av_freep(&s->internal);
     flush_packet_queue(s);
     av_free(s);
@@ -3578,6 +3637,9 @@ void avformat_close_input(AVFormatContext **ps)
 
     flush_packet_queue(s);
 
+    if (s->iformat)
+        ff_seek_index_save(s);
+
     if (s->iformat)
         if (s->iformat->read_close)
             s->iformat->read_close(s);
@@ -4046,6 +4108,9 @@ int avformat_network_init(void)
 
 int avformat_network_deinit(void)
 {
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_close_idle_connections();
+#endif
 #if CONFIG_NETWORK
     ff_network_close();
     ff_tls_deinit();
@@ -32,6 +32,7 @@
 
 #include "config.h"
 #include "adler32.h"
+#include "adler32_internal.h"
 #include "common.h"
 #include "intreadwrite.h"
 
@@ -47,6 +48,21 @@ unsigned long av_adler32_update(unsigned long adler, const uint8_t * buf,
     unsigned long s1 = adler & 0xffff;
     unsigned long s2 = adler >> 16;
 
+    if (ARCH_X86 && len >= 64) {
+        ff_adler32_block_fn block = ff_adler32_block_x86();
+
+        while (block && len >= 64) {
+            unsigned n = FFMIN(len, ADLER32_NMAX) & ~31;
+            uint32_t s[2] = { s1, s2 };
+
+            block(s, buf, n);
+            s1   = s[0] % BASE;
+            s2   = s[1] % BASE;
+            buf += n;
+            len -= n;
+        }
+    }
+
     while (len > 0) {
 #if HAVE_FAST_64BIT && HAVE_FAST_UNALIGNED && !CONFIG_SMALL
         unsigned len2 = FFMIN((len-1) & ~7, 23*8);
@@ -105,10 +121,24 @@ unsigned long av_adler32_update(unsigned long adler, const uint8_t * buf,
 
 static volatile int checksum;
 
+static unsigned long adler32_ref(unsigned long adler, const uint8_t *buf,
+                                 unsigned len)
+{
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = adler >> 16;
+
+    while (len--) {
+        s1 = (s1 + *buf++) % 65521;
+        s2 = (s2 + s1)     % 65521;
+    }
+    return (s2 << 16) | s1;
+}
+
 int main(int argc, char **argv)
 {
-    int i;
+    int i, ret = 0;
     char data[LEN];
+    uint8_t max[3 * 5552 + 67];
 
     av_log_set_level(AV_LOG_DEBUG);
 
@@ -126,7 +156,28 @@ int main(int argc, char **argv)
     }
 
     av_log(NULL, AV_LOG_DEBUG, "%X (expected 50E6E508)\n", checksum);
-    return checksum == 0x50e6e508 ? 0 : 1;
+    if (checksum != 0x50e6e508)
+        ret = 1;
+
+    /* All 0xFF is the worst case for the unreduced sums. */
+    memset(max, 0xFF, sizeof(max));
+    for (i = 0; i < 4 * 300; i++) {
+        int off = i & 3, len = i >> 2;
+        if (av_adler32_update(0xFFF0FFF0, (uint8_t *)data + off, len) !=
+            adler32_ref(0xFFF0FFF0, (uint8_t *)data + off, len)) {
+            av_log(NULL, AV_LOG_ERROR, "mismatch at offset %d length %d\n", off, len);
+            ret = 1;
+        }
+    }
+    for (i = 0; i < 64; i++) {
+        int len = sizeof(max) - i;
+        if (av_adler32_update(0xFFF0FFF0, max + i, len) !=
+            adler32_ref(0xFFF0FFF0, max + i, len)) {
+            av_log(NULL, AV_LOG_ERROR, "mismatch at length %d\n", len);
+            ret = 1;
+        }
+    }
+    return ret;
 }
 // LCOV_EXCL_STOP
 #endif
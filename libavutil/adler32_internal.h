@@ -0,0 +1,43 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_ADLER32_INTERNAL_H
+#define AVUTIL_ADLER32_INTERNAL_H
+
+#include <stdint.h>
+
+/**
+ * Largest n such that 255n(n+1)/2 + (n+1)(BASE-1) <= 2^32-1, i.e. the
+ * number of bytes that can be summed before s2 has to be reduced.
+ */
+#define ADLER32_NMAX 5552
+
+/**
+ * Add len bytes of buf to the running sums s[0] (s1) and s[1] (s2) without
+ * reducing them modulo 65521. len must be a nonzero multiple of 32 and
+ * at most ADLER32_NMAX, s[0] and s[1] must be reduced on entry.
+ */
+typedef void (*ff_adler32_block_fn)(uint32_t *s, const uint8_t *buf,
+                                    unsigned len);
+
+/**
+ * @return the fastest block function for the running CPU, or NULL
+ */
+ff_adler32_block_fn ff_adler32_block_x86(void);
+
+#endif /* AVUTIL_ADLER32_INTERNAL_H */
@@ -19,9 +19,27 @@
  */
 
 #include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include "common.h"
 #include "bswap.h"
 #include "crc.h"
+#include "crc_internal.h"
+
+static struct {
+    uint8_t  le;
+    uint8_t  bits;
+    uint32_t poly;
+} av_crc_table_params[AV_CRC_MAX] = {
+    [AV_CRC_8_ATM]      = { 0,  8,       0x07 },
+    [AV_CRC_16_ANSI]    = { 0, 16,     0x8005 },
+    [AV_CRC_16_CCITT]   = { 0, 16,     0x1021 },
+    [AV_CRC_24_IEEE]    = { 0, 24,   0x864CFB },
+    [AV_CRC_32_IEEE]    = { 0, 32, 0x04C11DB7 },
+    [AV_CRC_32_IEEE_LE] = { 1, 32, 0xEDB88320 },
+    [AV_CRC_16_ANSI_LE] = { 1, 16,     0xA001 },
+};
 
 #if CONFIG_HARDCODED_TABLES
 static const AVCRC av_crc_table[AV_CRC_MAX][257] = {
@@ -290,22 +308,65 @@ static const AVCRC av_crc_table[AV_CRC_MAX][257] = {
 #else
 #define CRC_TABLE_SIZE 1024
 #endif
-static struct {
-    uint8_t  le;
-    uint8_t  bits;
-    uint32_t poly;
-} av_crc_table_params[AV_CRC_MAX] = {
-    [AV_CRC_8_ATM]      = { 0,  8,       0x07 },
-    [AV_CRC_16_ANSI]    = { 0, 16,     0x8005 },
-    [AV_CRC_16_CCITT]   = { 0, 16,     0x1021 },
-    [AV_CRC_24_IEEE]    = { 0, 24,   0x864CFB },
-    [AV_CRC_32_IEEE]    = { 0, 32, 0x04C11DB7 },
-    [AV_CRC_32_IEEE_LE] = { 1, 32, 0xEDB88320 },
-    [AV_CRC_16_ANSI_LE] = { 1, 16,     0xA001 },
-};
 static AVCRC av_crc_table[AV_CRC_MAX][CRC_TABLE_SIZE];
 #endif
 
+/* Carry-less multiplication folding for the 32 bit CRCs, see
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+ * Instruction", Intel, 2009. */
+#define CRC_FOLD_MIN_LEN 64
+
+static CRCFold crc_fold[AV_CRC_MAX];
+
+/* x^n mod P in the bit order the fold code multiplies in: bit-reflected in
+ * the upper half for the little-endian CRCs, plain for the big-endian ones. */
+static uint64_t crc_xpow(int le, uint32_t poly, int n)
+{
+    uint32_t v = le ? 0x80000000 : 1;
+
+    while (n--) {
+        if (le)
+            v = (v >> 1) ^ (poly & -(v & 1));
+        else
+            v = (v << 1) ^ (poly & -(v >> 31));
+    }
+    return le ? (uint64_t)v << 32 : v;
+}
+
+static av_cold void crc_fold_init(CRCFold *f, int le, uint32_t poly)
+{
+    if (le) {
+        f->k[0] = crc_xpow(le, poly, 512 + 63);
+        f->k[1] = crc_xpow(le, poly, 512 - 1);
+        f->k[2] = crc_xpow(le, poly, 128 + 63);
+        f->k[3] = crc_xpow(le, poly, 128 - 1);
+    } else {
+        f->k[0] = crc_xpow(le, poly, 512);
+        f->k[1] = crc_xpow(le, poly, 512 + 64);
+        f->k[2] = crc_xpow(le, poly, 128);
+        f->k[3] = crc_xpow(le, poly, 128 + 64);
+    }
+    if (ARCH_X86)
+        ff_crc_fold_init_x86(f, le);
+    f->init = 1;
+}
+
+static av_cold void crc_fold_init_all(void)
+{
+    int i;
+
+    for (i = 0; i < AV_CRC_MAX; i++)
+        if (av_crc_table_params[i].bits == 32)
+            crc_fold_init(&crc_fold[i], av_crc_table_params[i].le,
+                          av_crc_table_params[i].poly);
+}
+
+#if HAVE_PTHREADS
+/* av_crc() may run on other threads as soon as fold is set, so the
+ * constants must be complete and visible before that */
+static pthread_once_t crc_fold_once = PTHREAD_ONCE_INIT;
+#endif
+
 int av_crc_init(AVCRC *ctx, int le, int bits, uint32_t poly, int ctx_size)
 {
     unsigned i, j;
@@ -349,6 +410,12 @@ const AVCRC *av_crc_get_table(AVCRCId crc_id)
                         av_crc_table_params[crc_id].poly,
                         sizeof(av_crc_table[crc_id])) < 0)
             return NULL;
+#endif
+#if HAVE_PTHREADS
+    pthread_once(&crc_fold_once, crc_fold_init_all);
+#else
+    if (!crc_fold[AV_CRC_32_IEEE].init)
+        crc_fold_init_all();
 #endif
     return av_crc_table[crc_id];
 }
@@ -358,6 +425,23 @@ uint32_t av_crc(const AVCRC *ctx, uint32_t crc,
 {
     const uint8_t *end = buffer + length;
 
+    if (length >= CRC_FOLD_MIN_LEN) {
+        const CRCFold *f = NULL;
+
+        if (ctx == av_crc_table[AV_CRC_32_IEEE])
+            f = &crc_fold[AV_CRC_32_IEEE];
+        else if (ctx == av_crc_table[AV_CRC_32_IEEE_LE])
+            f = &crc_fold[AV_CRC_32_IEEE_LE];
+        if (f && f->fold) {
+            uint8_t rem[16];
+            size_t len = length & ~15;
+
+            f->fold(rem, buffer, len, crc, f->k);
+            crc     = av_crc(ctx, 0, rem, sizeof(rem));
+            buffer += len;
+        }
+    }
+
 #if !CONFIG_SMALL
     if (!ctx[256]) {
         while (((intptr_t) buffer & 3) && buffer < end)
@@ -382,7 +466,8 @@ uint32_t av_crc(const AVCRC *ctx, uint32_t crc,
 int main(void)
 {
     uint8_t buf[1999];
-    int i;
+    AVCRC ref[1024];
+    int i, j, ret = 0;
     int p[6][3] = { { AV_CRC_32_IEEE_LE, 0xEDB88320, 0x3D5CDD04 },
                     { AV_CRC_32_IEEE   , 0x04C11DB7, 0xC0F5BAE0 },
                     { AV_CRC_24_IEEE   , 0x864CFB  , 0xB704CE   },
@@ -399,6 +484,22 @@ int main(void)
         ctx = av_crc_get_table(p[i][0]);
         printf("crc %08X = %X\n", p[i][1], av_crc(ctx, 0, buf, sizeof(buf)));
     }
-    return 0;
+
+    /* Compare the builtin tables, which may use SIMD folding, against
+     * plain tables over all alignments and lengths around the cutoffs. */
+    for (i = 0; i < 2; i++) {
+        ctx = av_crc_get_table(p[i][0]);
+        av_crc_init(ref, !i, 32, p[i][1], sizeof(ref));
+        for (j = 0; j < 16 * 200; j++) {
+            int off = j & 15, len = j >> 4;
+            uint32_t crc = j * 0x9E3779B9U;
+            if (av_crc(ctx, crc, buf + off, len) != av_crc(ref, crc, buf + off, len)) {
+                printf("crc %08X mismatch at offset %d length %d\n",
+                       p[i][1], off, len);
+                ret = 1;
+            }
+        }
+    }
+    return ret;
 }
 #endif
@@ -0,0 +1,45 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_CRC_INTERNAL_H
+#define AVUTIL_CRC_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mem.h"
+
+typedef struct CRCFold {
+    /**
+     * Fold len bytes of src, len being a nonzero multiple of 16, into a
+     * 16 byte block dst. The CRC of dst with an initial value of 0 equals
+     * the CRC of src with an initial value of crc.
+     */
+    void (*fold)(uint8_t *dst, const uint8_t *src, size_t len, uint32_t crc,
+                 const uint64_t *k);
+    /**
+     * Folding constants x^n mod P: k[0], k[1] for folding four blocks
+     * forward by 512 bits, k[2], k[3] for folding one block by 128 bits.
+     */
+    DECLARE_ALIGNED(16, uint64_t, k)[4];
+    int init;
+} CRCFold;
+
+void ff_crc_fold_init_x86(CRCFold *f, int le);
+
+#endif /* AVUTIL_CRC_INTERNAL_H */
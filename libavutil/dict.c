@@ -25,11 +25,94 @@
 #include "internal.h"
 #include "mem.h"
 
+/**
+ * Number of entries above which av_dict_set() starts maintaining a hash
+ * index of the keys. Below it a linear scan is cheaper than hashing.
+ */
+#define DICT_HASH_THRESHOLD 32
+
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+
+    /* Optional hash index over the keys, see dict_index_build().
+     * hash_size is 0 when no index exists, otherwise it is a power of two
+     * >= count and is both the number of buckets and the capacity of the
+     * per entry hash_val/hash_next arrays. Entries are chained through
+     * hash_next, -1 terminates a chain. */
+    int hash_size;
+    int *hash_head;
+    int *hash_next;
+    unsigned *hash_val;
 };
 
+/* Keys are hashed case-insensitively so that one index serves both
+ * case sensitive and insensitive lookups. */
+static unsigned dict_hash(const char *key)
+{
+    unsigned h = 0;
+    while (*key)
+        h = h * 31 + av_toupper(*key++);
+    return h;
+}
+
+static void dict_index_free(AVDictionary *m)
+{
+    av_freep(&m->hash_head);
+    av_freep(&m->hash_next);
+    av_freep(&m->hash_val);
+    m->hash_size = 0;
+}
+
+static void dict_index_insert(AVDictionary *m, int i, unsigned h)
+{
+    int b = h & (m->hash_size - 1);
+    m->hash_val[i]  = h;
+    m->hash_next[i] = m->hash_head[b];
+    m->hash_head[b] = i;
+}
+
+static void dict_index_remove(AVDictionary *m, int i)
+{
+    int *p = &m->hash_head[m->hash_val[i] & (m->hash_size - 1)];
+    while (*p != i)
+        p = &m->hash_next[*p];
+    *p = m->hash_next[i];
+}
+
+/**
+ * (Re)build the hash index so that it can hold at least size entries.
+ * On allocation failure the index is dropped and lookups fall back to the
+ * linear scan, so this never fails.
+ */
+static void dict_index_build(AVDictionary *m, int size)
+{
+    int i, hash_size = 2 * DICT_HASH_THRESHOLD;
+
+    while (hash_size < size)
+        hash_size <<= 1;
+
+    dict_index_free(m);
+    m->hash_head = av_malloc_array(hash_size, sizeof(*m->hash_head));
+    m->hash_next = av_malloc_array(hash_size, sizeof(*m->hash_next));
+    m->hash_val  = av_malloc_array(hash_size, sizeof(*m->hash_val));
+    if (!m->hash_head || !m->hash_next || !m->hash_val) {
+        dict_index_free(m);
+        return;
+    }
+    m->hash_size = hash_size;
+    memset(m->hash_head, -1, hash_size * sizeof(*m->hash_head));
+    for (i = 0; i < m->count; i++)
+        dict_index_insert(m, i, dict_hash(m->elems[i].key));
+}
+
+static int dict_key_equal(const char *s, const char *key, int flags)
+{
+    if (flags & AV_DICT_MATCH_CASE)
+        return !strcmp(s, key);
+    return !av_strcasecmp(s, key);
+}
+
 int av_dict_count(const AVDictionary *m)
 {
     return m ? m->count : 0;
@@ -48,6 +131,19 @@ AVDictionaryEntry *av_dict_get(FF_CONST_AVUTIL53 AVDictionary *m, const char *ke
     else
         i = 0;
 
+    if (m->hash_size && !(flags & AV_DICT_IGNORE_SUFFIX)) {
+        unsigned h = dict_hash(key);
+        int k, best = -1;
+
+        /* chains are unordered, the first match in entry order wins */
+        for (k = m->hash_head[h & (m->hash_size - 1)]; k >= 0; k = m->hash_next[k]) {
+            if (k >= i && (best < 0 || k < best) && m->hash_val[k] == h &&
+                dict_key_equal(m->elems[k].key, key, flags))
+                best = k;
+        }
+        return best >= 0 ? &m->elems[best] : NULL;
+    }
+
     for (; i < m->count; i++) {
         const char *s = m->elems[i].key;
         if (flags & AV_DICT_MATCH_CASE)
@@ -86,6 +182,15 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
         else
             av_free(tag->value);
         av_free(tag->key);
+        if (m->hash_size) {
+            int i = tag - m->elems, last = m->count - 1;
+            dict_index_remove(m, i);
+            if (i != last) {
+                unsigned h = m->hash_val[last];
+                dict_index_remove(m, last);
+                dict_index_insert(m, i, h);
+            }
+        }
         *tag = m->elems[--m->count];
     } else {
         AVDictionaryEntry *tmp = av_realloc(m->elems,
@@ -94,6 +199,9 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             goto err_out;
         m->elems = tmp;
     }
+    if (value && (m->hash_size ? m->count >= m->hash_size
+                               : m->count >= DICT_HASH_THRESHOLD))
+        dict_index_build(m, m->count + 1);
     if (value) {
         if (flags & AV_DICT_DONT_STRDUP_KEY)
             m->elems[m->count].key = (char*)(intptr_t)key;
@@ -112,9 +220,12 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             m->elems[m->count].value = newval;
         } else
             m->elems[m->count].value = av_strdup(value);
+        if (m->hash_size)
+            dict_index_insert(m, m->count, dict_hash(m->elems[m->count].key));
         m->count++;
     }
     if (!m->count) {
+        dict_index_free(m);
         av_free(m->elems);
         av_freep(pm);
     }
@@ -123,6 +234,7 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
 
 err_out:
     if (!m->count) {
+        dict_index_free(m);
         av_free(m->elems);
         av_freep(pm);
     }
@@ -196,6 +308,7 @@ void av_dict_free(AVDictionary **pm)
             av_free(m->elems[m->count].value);
         }
         av_free(m->elems);
+        dict_index_free(m);
     }
     av_freep(pm);
 }
@@ -207,3 +320,144 @@ void av_dict_copy(AVDictionary **dst, FF_CONST_AVUTIL53 AVDictionary *src, int f
     while ((t = av_dict_get(src, "", t, AV_DICT_IGNORE_SUFFIX)))
         av_dict_set(dst, t->key, t->value, flags);
 }
+
+#ifdef TEST
+// LCOV_EXCL_START
+#include "lfg.h"
+#include "log.h"
+#include "time.h"
+
+#define NB_KEYS 300
+#define NB_OPS  40000
+
+/* Reference model of the dictionary semantics using plain linear scans.
+ * Case insensitive sets only replace the first match, so keys differing
+ * in case can accumulate and the model needs room for every operation. */
+static char ref_key[NB_OPS][16];
+static char ref_val[NB_OPS][16];
+static int  ref_count;
+
+static int ref_find(const char *key, int start, int flags)
+{
+    int i;
+    for (i = start; i < ref_count; i++)
+        if (dict_key_equal(ref_key[i], key, flags))
+            return i;
+    return -1;
+}
+
+static void ref_set(const char *key, const char *value, int flags)
+{
+    int i = ref_find(key, 0, flags);
+    if (i >= 0 && i != --ref_count) {
+        strcpy(ref_key[i], ref_key[ref_count]);
+        strcpy(ref_val[i], ref_val[ref_count]);
+    }
+    if (value) {
+        strcpy(ref_key[ref_count], key);
+        strcpy(ref_val[ref_count], value);
+        ref_count++;
+    }
+}
+
+static int check_dict(AVDictionary *m, AVLFG *prng)
+{
+    AVDictionaryEntry *t = NULL;
+    int i = 0, j;
+
+    while ((t = av_dict_get(m, "", t, AV_DICT_IGNORE_SUFFIX))) {
+        if (i >= ref_count || strcmp(t->key, ref_key[i]) ||
+            strcmp(t->value, ref_val[i])) {
+            av_log(NULL, AV_LOG_ERROR, "order mismatch at %d\n", i);
+            return 1;
+        }
+        i++;
+    }
+    if (i != ref_count || av_dict_count(m) != ref_count) {
+        av_log(NULL, AV_LOG_ERROR, "count mismatch %d %d\n", i, ref_count);
+        return 1;
+    }
+
+    for (i = 0; i < 64; i++) {
+        int flags = av_lfg_get(prng) & 1 ? AV_DICT_MATCH_CASE : 0;
+        char key[16];
+        snprintf(key, sizeof(key), av_lfg_get(prng) & 1 ? "key%d" : "KEY%d",
+                 av_lfg_get(prng) % NB_KEYS);
+        t = NULL;
+        j = 0;
+        while ((j = ref_find(key, j, flags)) >= 0) {
+            t = av_dict_get(m, key, t, flags);
+            if (!t || t - m->elems != j) {
+                av_log(NULL, AV_LOG_ERROR, "lookup mismatch for %s\n", key);
+                return 1;
+            }
+            j++;
+        }
+        if (av_dict_get(m, key, t, flags)) {
+            av_log(NULL, AV_LOG_ERROR, "spurious match for %s\n", key);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    AVDictionary *m = NULL;
+    AVDictionaryEntry *t;
+    AVLFG prng;
+    int i;
+
+    av_lfg_init(&prng, 1);
+
+    for (i = 0; i < NB_OPS; i++) {
+        unsigned r = av_lfg_get(&prng);
+        int flags  = r & 1 ? AV_DICT_MATCH_CASE : 0;
+        char key[16], val[16];
+
+        snprintf(key, sizeof(key), r & 2 ? "key%d" : "KEY%d",
+                 (r >> 8) % NB_KEYS);
+        snprintf(val, sizeof(val), "%d", i);
+        /* grow the dictionary first, then mix in deletions */
+        if (i > NB_OPS / 2 && (r & 12) == 12) {
+            av_dict_set(&m, key, NULL, flags);
+            ref_set(key, NULL, flags);
+        } else {
+            av_dict_set(&m, key, val, flags);
+            ref_set(key, val, flags);
+        }
+        if (!(i % 1000) && check_dict(m, &prng))
+            return 1;
+    }
+    if (check_dict(m, &prng))
+        return 1;
+
+    t = av_dict_get(m, "KEY1", NULL, AV_DICT_IGNORE_SUFFIX);
+    if (!t || av_strncasecmp(t->key, "key1", 4)) {
+        av_log(NULL, AV_LOG_ERROR, "prefix match failed\n");
+        return 1;
+    }
+    av_dict_free(&m);
+
+    if (argc > 1 && !strcmp(argv[1], "-t")) {
+        int n, count;
+        for (n = 16; n <= 65536; n *= 4) {
+            int64_t start = av_gettime_relative();
+            char key[16];
+            for (i = 0; i < n; i++) {
+                snprintf(key, sizeof(key), "key%d", i);
+                av_dict_set(&m, key, "value", 0);
+            }
+            for (i = 0, count = 0; i < n; i++) {
+                snprintf(key, sizeof(key), "KEY%d", i);
+                count += !!av_dict_get(m, key, NULL, 0);
+            }
+            av_log(NULL, AV_LOG_INFO, "%6d entries: %"PRId64" us (%d found)\n",
+                   n, av_gettime_relative() - start, count);
+            av_dict_free(&m);
+        }
+    }
+    return 0;
+}
+// LCOV_EXCL_STOP
+#endif
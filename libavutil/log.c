@@ -236,16 +236,22 @@ static const char *get_level_str(int level)
     }
 }
 
-static void format_line(void *avcl, int level, const char *fmt, va_list vl,
-                        AVBPrint part[4], int *print_prefix, int type[2])
+static void format_message(const char *fmt, va_list vl, AVBPrint part[4], int type[2])
 {
-    AVClass* avc = avcl ? *(AVClass **) avcl : NULL;
     av_bprint_init(part+0, 0, 1);
     av_bprint_init(part+1, 0, 1);
     av_bprint_init(part+2, 0, 1);
     av_bprint_init(part+3, 0, 65536);
 
     if(type) type[0] = type[1] = AV_CLASS_CATEGORY_NA + 16;
+    av_vbprintf(part+3, fmt, vl);
+}
+
+static void format_prefix(void *avcl, int level, AVBPrint part[4],
+                          int *print_prefix, int type[2])
+{
+    AVClass* avc = avcl ? *(AVClass **) avcl : NULL;
+
     if (*print_prefix && avc) {
         if (avc->parent_log_context_offset) {
             AVClass** parent = *(AVClass ***) (((uint8_t *) avcl) +
@@ -264,14 +270,19 @@ static void format_line(void *avcl, int level, const char *fmt, va_list vl,
             av_bprintf(part+2, "[%s] ", get_level_str(level));
     }
 
-    av_vbprintf(part+3, fmt, vl);
-
     if(*part[0].str || *part[1].str || *part[2].str || *part[3].str) {
         char lastc = part[3].len && part[3].len <= part[3].size ? part[3].str[part[3].len - 1] : 0;
         *print_prefix = lastc == '\n' || lastc == '\r';
     }
 }
 
+static void format_line(void *avcl, int level, const char *fmt, va_list vl,
+                        AVBPrint part[4], int *print_prefix, int type[2])
+{
+    format_message(fmt, vl, part, type);
+    format_prefix(avcl, level, part, print_prefix, type);
+}
+
 void av_log_format_line(void *ptr, int level, const char *fmt, va_list vl,
                         char *line, int line_size, int *print_prefix)
 {
@@ -299,11 +310,16 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
 
     if (level > av_log_level)
         return;
+
+    /* Format the message into this thread's own buffer before taking the
+     * lock. Whether it gets a prefix depends on the previous message ending
+     * its line, so the prefix is added under the lock. */
+    format_message(fmt, vl, part, type);
+
 #if HAVE_PTHREADS
     pthread_mutex_lock(&mutex);
 #endif
-
-    format_line(ptr, level, fmt, vl, part, &print_prefix, type);
+    format_prefix(ptr, level, part, &print_prefix, type);
     snprintf(line, sizeof(line), "%s%s%s%s", part[0].str, part[1].str, part[2].str, part[3].str);
 
 #if HAVE_ISATTY
@@ -314,7 +330,9 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
     if (print_prefix && (flags & AV_LOG_SKIP_REPEATED) && !strcmp(line, prev) &&
         *line && line[strlen(line) - 1] != '\r'){
         count++;
-        if (is_atty == 1)
+        /* Only refresh the status line at power of two counts, a flood of
+         * identical messages must not turn into a flood of terminal writes. */
+        if (is_atty == 1 && !(count & (count - 1)))
             fprintf(stderr, "    Last message repeated %d times\r", count);
         goto end;
     }
@@ -332,10 +350,10 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
     sanitize(part[3].str);
     colored_fputs(av_clip(level >> 3, 0, 6), tint >> 8, part[3].str);
 end:
-    av_bprint_finalize(part+3, NULL);
 #if HAVE_PTHREADS
     pthread_mutex_unlock(&mutex);
 #endif
+    av_bprint_finalize(part+3, NULL);
 }
 
 static void (*av_log_callback)(void*, int, const char*, va_list) =
@@ -0,0 +1,331 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "atomic.h"
+#include "bprint.h"
+#include "common.h"
+#include "error.h"
+#include "mem.h"
+#include "perf.h"
+#include "time.h"
+#include "timer.h"
+
+#define MAX_TIMERS 128
+
+typedef struct PerfStat {
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+} PerfStat;
+
+/* Statistics of one thread, only ever written by that thread. */
+typedef struct PerfThread {
+    PerfStat stat[MAX_TIMERS];
+    struct PerfThread *prev, *next;
+} PerfThread;
+
+static volatile int enabled;
+
+/* Registered timers and the statistics of threads that have exited,
+ * protected by lock. */
+static FFPerfTimer *timers[MAX_TIMERS];
+static int nb_timers;
+static PerfStat retired[MAX_TIMERS];
+static PerfThread *threads;
+
+#if HAVE_PTHREADS
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;
+#define LOCK()   pthread_mutex_lock(&lock)
+#define UNLOCK() pthread_mutex_unlock(&lock)
+#else
+static PerfThread main_thread;
+#define LOCK()
+#define UNLOCK()
+#endif
+
+static void merge_stat(PerfStat *dst, const PerfStat *src)
+{
+    if (!src->count)
+        return;
+    dst->min    = dst->count ? FFMIN(dst->min, src->min) : src->min;
+    dst->max    = FFMAX(dst->max, src->max);
+    dst->count += src->count;
+    dst->total += src->total;
+}
+
+#if HAVE_PTHREADS
+static void thread_exit(void *arg)
+{
+    PerfThread *t = arg;
+    int i;
+
+    LOCK();
+    for (i = 0; i < MAX_TIMERS; i++)
+        merge_stat(&retired[i], &t->stat[i]);
+    if (t->prev)
+        t->prev->next = t->next;
+    else
+        threads = t->next;
+    if (t->next)
+        t->next->prev = t->prev;
+    UNLOCK();
+    av_free(t);
+}
+
+static void make_key(void)
+{
+    pthread_key_create(&key, thread_exit);
+}
+#endif
+
+static PerfThread *get_thread(void)
+{
+#if HAVE_PTHREADS
+    PerfThread *t;
+
+    pthread_once(&key_once, make_key);
+    t = pthread_getspecific(key);
+    if (!t) {
+        if (!(t = av_mallocz(sizeof(*t))))
+            return NULL;
+        if (pthread_setspecific(key, t)) {
+            av_free(t);
+            return NULL;
+        }
+        LOCK();
+        t->next = threads;
+        if (threads)
+            threads->prev = t;
+        threads = t;
+        UNLOCK();
+    }
+    return t;
+#else
+    if (!threads)
+        threads = &main_thread;
+    return &main_thread;
+#endif
+}
+
+static uint64_t perf_read_time(void)
+{
+#ifdef AV_READ_TIME
+    return AV_READ_TIME();
+#else
+    return av_gettime_relative();
+#endif
+}
+
+void av_perf_set_enabled(int enable)
+{
+    avpriv_atomic_int_set(&enabled, !!enable);
+}
+
+int av_perf_get_enabled(void)
+{
+    return avpriv_atomic_int_get(&enabled);
+}
+
+uint64_t avpriv_perf_timer_start(void)
+{
+    uint64_t now;
+
+    if (!enabled)
+        return 0;
+    now = perf_read_time();
+    return now ? now : 1;
+}
+
+static void perf_account(FFPerfTimer *timer, uint64_t value)
+{
+    int id = avpriv_atomic_int_get(&timer->id);
+    PerfThread *t;
+    PerfStat *s;
+
+    if (!id) {
+        LOCK();
+        if (!(id = timer->id)) {
+            id = nb_timers < MAX_TIMERS ? nb_timers + 1 : -1;
+            if (id > 0)
+                timers[nb_timers++] = timer;
+            avpriv_atomic_int_set(&timer->id, id);
+        }
+        UNLOCK();
+    }
+    if (id < 0 || !(t = get_thread()))
+        return;
+
+    s = &t->stat[id - 1];
+    s->min = s->count ? FFMIN(s->min, value) : value;
+    s->max = FFMAX(s->max, value);
+    s->total += value;
+    s->count++;
+}
+
+void avpriv_perf_timer_stop(FFPerfTimer *timer, uint64_t start)
+{
+    perf_account(timer, perf_read_time() - start);
+}
+
+void avpriv_perf_counter_add(FFPerfTimer *counter, uint64_t value)
+{
+    if (enabled)
+        perf_account(counter, value);
+}
+
+static void json_escape(AVBPrint *bp, const char *str)
+{
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            av_bprint_chars(bp, '\\', 1);
+        av_bprint_chars(bp, *str, 1);
+    }
+}
+
+static void dump_entries(AVBPrint *bp, const PerfStat *stat, int counter)
+{
+    int i, n = 0;
+
+    for (i = 0; i < nb_timers; i++) {
+        if (timers[i]->counter != counter)
+            continue;
+        av_bprintf(bp, "%s\n        { \"name\": \"", n++ ? "," : "");
+        json_escape(bp, timers[i]->name);
+        av_bprintf(bp, "\", \"count\": %"PRIu64", \"total\": %"PRIu64
+                   ", \"min\": %"PRIu64", \"max\": %"PRIu64" }",
+                   stat[i].count, stat[i].total, stat[i].min, stat[i].max);
+    }
+}
+
+int av_perf_dump_json(char **json)
+{
+    AVBPrint bp;
+    PerfStat stat[MAX_TIMERS];
+    PerfThread *t;
+    int i;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+
+    LOCK();
+    memcpy(stat, retired, sizeof(stat));
+    for (t = threads; t; t = t->next)
+        for (i = 0; i < nb_timers; i++)
+            merge_stat(&stat[i], &t->stat[i]);
+
+    av_bprintf(&bp, "{\n    \"unit\": \"%s\",\n    \"timers\": [",
+#ifdef AV_READ_TIME
+               "ticks"
+#else
+               "microseconds"
+#endif
+               );
+    dump_entries(&bp, stat, 0);
+    av_bprintf(&bp, "\n    ],\n    \"counters\": [");
+    dump_entries(&bp, stat, 1);
+    UNLOCK();
+    av_bprintf(&bp, "\n    ]\n}\n");
+
+    if (!av_bprint_is_complete(&bp)) {
+        av_bprint_finalize(&bp, NULL);
+        return AVERROR(ENOMEM);
+    }
+    return av_bprint_finalize(&bp, json);
+}
+
+#ifdef TEST
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NB_THREADS 2
+#define NB_CALLS   1000
+
+static void *run(void *arg)
+{
+    int i;
+
+    for (i = 0; i < NB_CALLS; i++) {
+        FF_PERF_TIMER_START(start);
+        FF_PERF_COUNTER_ADD("test_bytes", i);
+        FF_PERF_TIMER_STOP("test_section", start);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+#if HAVE_PTHREADS
+    pthread_t thread[NB_THREADS];
+#endif
+    char *json, *line, *next;
+    int i, counters = 0;
+
+    /* nothing is recorded while disabled */
+    run(NULL);
+
+    av_perf_set_enabled(1);
+    for (i = 0; i < NB_THREADS; i++) {
+#if HAVE_PTHREADS
+        if (pthread_create(&thread[i], NULL, run, NULL)) {
+            fprintf(stderr, "pthread_create() failed\n");
+            return 1;
+        }
+#else
+        run(NULL);
+#endif
+    }
+#if HAVE_PTHREADS
+    for (i = 0; i < NB_THREADS; i++)
+        pthread_join(thread[i], NULL);
+#endif
+    av_perf_set_enabled(0);
+
+    if (av_perf_dump_json(&json) < 0)
+        return 1;
+    for (line = json; line; line = next) {
+        char name[64];
+        uint64_t count, total, min, max;
+
+        if ((next = strchr(line, '\n')))
+            *next++ = 0;
+        if (strstr(line, "\"counters\""))
+            counters = 1;
+        if (sscanf(line, " { \"name\": \"%63[^\"]\", \"count\": %"SCNu64
+                   ", \"total\": %"SCNu64", \"min\": %"SCNu64", \"max\": %"SCNu64,
+                   name, &count, &total, &min, &max) != 5)
+            continue;
+        /* only counter values are deterministic */
+        if (counters)
+            printf("counter %s: count %"PRIu64" total %"PRIu64" min %"PRIu64" max %"PRIu64"\n",
+                   name, count, total, min, max);
+        else
+            printf("timer %s: count %"PRIu64"\n", name, count);
+    }
+    av_free(json);
+    return 0;
+}
+#endif
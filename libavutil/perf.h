@@ -0,0 +1,63 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_PERF_H
+#define AVUTIL_PERF_H
+
+/**
+ * @file
+ * Runtime controlled timing of the main library entry points.
+ *
+ * The libraries contain named timers around their hot entry points
+ * (decoding, encoding, filtering, muxing), and named counters of the
+ * bytes passing through them. They cost a single check while disabled;
+ * once enabled every call is timed or counted and accumulated per thread.
+ */
+
+/**
+ * Enable or disable the collection of timing statistics.
+ *
+ * Statistics already collected are kept when disabling.
+ *
+ * @param enable nonzero to enable collection
+ */
+void av_perf_set_enabled(int enable);
+
+/**
+ * @return nonzero if timing statistics are being collected
+ */
+int av_perf_get_enabled(void);
+
+/**
+ * Write the accumulated statistics of all timers and counters as a JSON
+ * object.
+ *
+ * The object contains the time unit used, one entry per timer with its
+ * name, call count, and the total, minimum and maximum time spent, and one
+ * entry per counter with its name, the number of values added to it, and
+ * their total, minimum and maximum.
+ * Statistics of threads that are still running timed code may be
+ * incomplete, so this is best called once processing has finished.
+ *
+ * @param json set to a newly allocated, 0-terminated string which must be
+ *             freed with av_free()
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_perf_dump_json(char **json);
+
+#endif /* AVUTIL_PERF_H */
@@ -87,4 +87,48 @@
 #define STOP_TIMER(id) { }
 #endif
 
+/**
+ * Statically registered timer or counter, see FF_PERF_TIMER_STOP() and
+ * FF_PERF_COUNTER_ADD().
+ * Unlike START_TIMER/STOP_TIMER these are always compiled in and are only
+ * active while enabled with av_perf_set_enabled().
+ */
+typedef struct FFPerfTimer {
+    const char *name;
+    int counter;        ///< 1 for a counter, 0 for a timer
+    volatile int id;    ///< index + 1 once registered, -1 if out of slots
+} FFPerfTimer;
+
+/**
+ * @return a nonzero start time if timers are enabled, 0 otherwise
+ */
+uint64_t avpriv_perf_timer_start(void);
+
+/**
+ * Account the time elapsed since start to timer in the calling thread.
+ */
+void avpriv_perf_timer_stop(FFPerfTimer *timer, uint64_t start);
+
+/**
+ * Add value to counter in the calling thread if timers are enabled.
+ */
+void avpriv_perf_counter_add(FFPerfTimer *counter, uint64_t value);
+
+#define FF_PERF_TIMER_START(start)                                        \
+    uint64_t start = avpriv_perf_timer_start()
+
+#define FF_PERF_TIMER_STOP(name, start)                                   \
+    do {                                                                  \
+        if (start) {                                                      \
+            static FFPerfTimer perf_timer = { name };                     \
+            avpriv_perf_timer_stop(&perf_timer, start);                   \
+        }                                                                 \
+    } while (0)
+
+#define FF_PERF_COUNTER_ADD(name, value)                                  \
+    do {                                                                  \
+        static FFPerfTimer perf_counter = { name, 1 };                    \
+        avpriv_perf_counter_add(&perf_counter, value);                    \
+    } while (0)
+
 #endif /* AVUTIL_TIMER_H */
@@ -0,0 +1,87 @@
+;*****************************************************************************
+;* SIMD optimized Adler-32
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION_RODATA 32
+
+pb_weights: db 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17
+            db 16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1
+pw_1:       times 16 dw 1
+
+SECTION .text
+
+;-----------------------------------------------------------------------------
+; void ff_adler32_block(uint32_t *s, const uint8_t *buf, unsigned len)
+;
+; For each block of mmsize bytes b[0..n-1]:
+;   s2 += n * s1 + sum((n - i) * b[i])
+;   s1 += sum(b[i])
+; The n * s1 terms are collected in m2 and scaled once at the end.
+;-----------------------------------------------------------------------------
+%macro ADLER32_BLOCK 0
+cglobal adler32_block, 3,3,8, s, buf, len
+    movd            xm0, [sq]
+    movd            xm1, [sq + 4]
+    pxor             m2, m2
+    pxor             m3, m3
+    mova             m4, [pb_weights + 32 - mmsize]
+    mova             m5, [pw_1]
+.loop:
+    movu             m6, [bufq]
+    paddd            m2, m0
+    psadbw           m7, m6, m3
+    paddd            m0, m7
+    pmaddubsw        m6, m4
+    pmaddwd          m6, m5
+    paddd            m1, m6
+    add            bufq, mmsize
+    sub            lend, mmsize
+    jg .loop
+
+%if mmsize == 32
+    pslld            m2, 5
+%else
+    pslld            m2, 4
+%endif
+    paddd            m1, m2
+%if mmsize == 32
+    vextracti128    xm2, m0, 1
+    paddd           xm0, xm2
+    vextracti128    xm2, m1, 1
+    paddd           xm1, xm2
+%endif
+    pshufd          xm2, xm0, q1032
+    paddd           xm0, xm2
+    pshufd          xm2, xm1, q1032
+    paddd           xm1, xm2
+    pshufd          xm2, xm1, q2301
+    paddd           xm1, xm2
+    movd           [sq], xm0
+    movd       [sq + 4], xm1
+    RET
+%endmacro
+
+INIT_XMM ssse3
+ADLER32_BLOCK
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+ADLER32_BLOCK
+%endif
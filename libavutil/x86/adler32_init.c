@@ -0,0 +1,39 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stddef.h>
+
+#include "config.h"
+
+#include "libavutil/adler32_internal.h"
+#include "libavutil/cpu.h"
+#include "cpu.h"
+
+void ff_adler32_block_ssse3(uint32_t *s, const uint8_t *buf, unsigned len);
+void ff_adler32_block_avx2(uint32_t *s, const uint8_t *buf, unsigned len);
+
+ff_adler32_block_fn ff_adler32_block_x86(void)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_AVX2(cpu_flags))
+        return ff_adler32_block_avx2;
+    if (EXTERNAL_SSSE3(cpu_flags))
+        return ff_adler32_block_ssse3;
+    return NULL;
+}
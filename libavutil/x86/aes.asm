@@ -0,0 +1,97 @@
+;*****************************************************************************
+;* AES-NI accelerated AES encryption and decryption
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION .text
+
+;-----------------------------------------------------------------------------
+; void ff_aes_encrypt(AVAES *a, uint8_t *dst, const uint8_t *src, int count,
+;                     uint8_t *iv, int rounds)
+; void ff_aes_decrypt(AVAES *a, uint8_t *dst, const uint8_t *src, int count,
+;                     uint8_t *iv, int rounds)
+;
+; The round keys are the first member of AVAES and are stored in the order
+; they are applied from round_key[rounds] down to round_key[0]; the
+; decryption keys already have InvMixColumns applied, as aesdec expects.
+;-----------------------------------------------------------------------------
+%macro AES_CRYPT 1
+cglobal aes_%1rypt, 6,6,2, ctx, dst, src, count, iv, rounds
+    test        countd, countd
+    jz .end
+    shl         countd, 4
+    add        roundsd, roundsd
+    add           ctxq, 0x60
+    add           srcq, countq
+    add           dstq, countq
+    neg         countq
+    pxor            m1, m1
+    test           ivq, ivq
+    jz .block
+    movu            m1, [ivq]
+.block:
+    movu            m0, [srcq + countq]
+%ifidn %1, enc
+    pxor            m0, m1
+%endif
+    pxor            m0, [ctxq + 8*roundsq - 0x60]
+    cmp        roundsd, 24
+    je .rounds12
+    jl .rounds10
+    aes%1           m0, [ctxq + 0x70]
+    aes%1           m0, [ctxq + 0x60]
+.rounds12:
+    aes%1           m0, [ctxq + 0x50]
+    aes%1           m0, [ctxq + 0x40]
+.rounds10:
+    aes%1           m0, [ctxq + 0x30]
+    aes%1           m0, [ctxq + 0x20]
+    aes%1           m0, [ctxq + 0x10]
+    aes%1           m0, [ctxq + 0x00]
+    aes%1           m0, [ctxq - 0x10]
+    aes%1           m0, [ctxq - 0x20]
+    aes%1           m0, [ctxq - 0x30]
+    aes%1           m0, [ctxq - 0x40]
+    aes%1           m0, [ctxq - 0x50]
+    aes%1last       m0, [ctxq - 0x60]
+    test           ivq, ivq
+    jz .noiv
+%ifidn %1, enc
+    mova            m1, m0
+%else
+    pxor            m0, m1
+    movu            m1, [srcq + countq]
+%endif
+.noiv:
+    movu [dstq + countq], m0
+    add         countq, 16
+    jl .block
+    test           ivq, ivq
+    jz .end
+    movu         [ivq], m1
+.end:
+    RET
+%endmacro
+
+%if HAVE_AESNI_EXTERNAL
+INIT_XMM aesni
+AES_CRYPT enc
+AES_CRYPT dec
+%endif
@@ -0,0 +1,120 @@
+;*****************************************************************************
+;* PCLMULQDQ accelerated CRC-32 folding
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION_RODATA
+
+pb_reverse: db 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+
+SECTION .text
+
+; %1 = %1.lo * m4.lo ^ %1.hi * m4.hi ^ %2, clobbers %3
+%macro FOLD 3
+    mova            %3, %1
+    pclmulqdq       %1, m4, 0x00
+    pclmulqdq       %3, m4, 0x11
+    pxor            %1, %3
+    pxor            %1, %2
+%endmacro
+
+; load 16 bytes, highest degree coefficient first for the big-endian CRCs
+%macro LOAD 2
+    movu            %1, %2
+%if crc_be
+    pshufb          %1, m7
+%endif
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void ff_crc32_fold_{le,be}(uint8_t *dst, const uint8_t *src, size_t len,
+;                            uint32_t crc, const uint64_t *k)
+;
+; Folds four 16 byte blocks at a time while at least 64 bytes are left, then
+; one at a time. The bit-reflected little-endian CRCs map the first byte to
+; the low quadword, the big-endian ones are byte reversed on load.
+;-----------------------------------------------------------------------------
+%macro CRC32_FOLD 2 ; le/be, byte reversed
+%assign crc_be %2
+cglobal crc32_fold_%1, 5,5,8, dst, src, len, crc, k
+%if crc_be
+    mova            m7, [pb_reverse]
+%endif
+    movd            m1, crcd
+    movu            m0, [srcq]
+    pxor            m0, m1
+%if crc_be
+    pshufb          m0, m7
+%endif
+    add           srcq, 16
+    sub           lenq, 16
+    cmp           lenq, 48
+    jb .fold1
+    LOAD            m1, [srcq]
+    LOAD            m2, [srcq + 16]
+    LOAD            m3, [srcq + 32]
+    add           srcq, 48
+    sub           lenq, 48
+    mova            m4, [kq]
+    cmp           lenq, 64
+    jb .fold4_end
+.fold4:
+    LOAD            m6, [srcq]
+    FOLD            m0, m6, m5
+    LOAD            m6, [srcq + 16]
+    FOLD            m1, m6, m5
+    LOAD            m6, [srcq + 32]
+    FOLD            m2, m6, m5
+    LOAD            m6, [srcq + 48]
+    FOLD            m3, m6, m5
+    add           srcq, 64
+    sub           lenq, 64
+    cmp           lenq, 64
+    jae .fold4
+.fold4_end:
+    mova            m4, [kq + 16]
+    FOLD            m0, m1, m5
+    FOLD            m0, m2, m5
+    FOLD            m0, m3, m5
+    jmp .fold1_test
+.fold1:
+    mova            m4, [kq + 16]
+.fold1_test:
+    test          lenq, lenq
+    jz .end
+.fold1_loop:
+    LOAD            m6, [srcq]
+    FOLD            m0, m6, m5
+    add           srcq, 16
+    sub           lenq, 16
+    jnz .fold1_loop
+.end:
+%if crc_be
+    pshufb          m0, m7
+%endif
+    movu        [dstq], m0
+    RET
+%endmacro
+
+%if HAVE_CLMUL_EXTERNAL
+INIT_XMM clmul
+CRC32_FOLD le, 0
+CRC32_FOLD be, 1
+%endif
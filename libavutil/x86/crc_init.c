@@ -0,0 +1,37 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/crc_internal.h"
+#include "cpu.h"
+
+void ff_crc32_fold_le_clmul(uint8_t *dst, const uint8_t *src, size_t len,
+                            uint32_t crc, const uint64_t *k);
+void ff_crc32_fold_be_clmul(uint8_t *dst, const uint8_t *src, size_t len,
+                            uint32_t crc, const uint64_t *k);
+
+av_cold void ff_crc_fold_init_x86(CRCFold *f, int le)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_CLMUL(cpu_flags))
+        f->fold = le ? ff_crc32_fold_le_clmul : ff_crc32_fold_be_clmul;
+}
@@ -97,6 +97,12 @@ static const AVOption options[]={
                                                         , OFFSET(precision)      , AV_OPT_TYPE_DOUBLE,{.dbl=20.0                  }, 15.0   , 33.0      , PARAM },
 {"cheby"                , "enable soxr Chebyshev passband & higher-precision irrational ratio approximation"
                                                         , OFFSET(cheby)          , AV_OPT_TYPE_INT  , {.i64=0                     }, 0      , 1         , PARAM },
+{"threads"              , "set number of threads used to resample the channels in parallel (0 for automatic)"
+                                                        , OFFSET(threads)        , AV_OPT_TYPE_INT  , {.i64=1                     }, 0      , SWR_CH_MAX, PARAM },
+{"thread_min_samples"   , "set minimum number of samples per call for which the channels are resampled in parallel"
+                                                        , OFFSET(thread_min_samples), AV_OPT_TYPE_INT, {.i64=256                  }, 0      , INT_MAX   , PARAM },
+{"filter_cache_file"    , "set file to load precomputed filter banks from and store new ones to"
+                                                        , OFFSET(filter_cache_file), AV_OPT_TYPE_STRING, {.str=NULL              }, 0      , 0         , PARAM },
 {"min_comp"             , "set minimum difference between timestamps and audio data (in seconds) below which no timestamp compensation of either kind is applied"
                                                         , OFFSET(min_compensation),AV_OPT_TYPE_FLOAT ,{.dbl=FLT_MAX               }, 0      , FLT_MAX   , PARAM },
 {"min_hard_comp"        , "set minimum difference between timestamps and audio data (in seconds) to trigger padding/trimming the data."
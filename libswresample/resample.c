@@ -173,11 +173,12 @@ static int build_filter(ResampleContext *c, void *filter, double factor, int tap
 
 static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff0, enum AVSampleFormat format, enum SwrFilterType filter_type, int kaiser_beta,
-                                    double precision, int cheby)
+                                    double precision, int cheby, const char *filter_cache_file)
 {
     double cutoff = cutoff0? cutoff0 : 0.97;
     double factor= FFMIN(out_rate * cutoff / in_rate, 1.0);
     int phase_count= 1<<phase_shift;
+    FilterBankKey key;
 
     if (!c || c->phase_shift != phase_shift || c->linear!=linear || c->factor != factor
            || c->filter_length != FFMAX((int)ceil(filter_size/factor), 1) || c->format != format
@@ -217,15 +218,38 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
         c->factor        = factor;
         c->filter_length = FFMAX((int)ceil(filter_size/factor), 1);
         c->filter_alloc  = FFALIGN(c->filter_length, 8);
-        c->filter_bank   = av_calloc(c->filter_alloc, (phase_count+1)*c->felem_size);
         c->filter_type   = filter_type;
         c->kaiser_beta   = kaiser_beta;
-        if (!c->filter_bank)
-            goto error;
-        if (build_filter(c, (void*)c->filter_bank, factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, filter_type, kaiser_beta))
-            goto error;
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
+
+        key.factor        = factor;
+        key.filter_length = c->filter_length;
+        key.filter_alloc  = c->filter_alloc;
+        key.phase_shift   = phase_shift;
+        key.filter_type   = filter_type;
+        key.kaiser_beta   = kaiser_beta;
+        key.format        = format;
+
+        c->filter_bank_buf = swri_filter_cache_get(&key, filter_cache_file);
+        if (!c->filter_bank_buf) {
+            int64_t size = c->filter_alloc * (phase_count + 1LL) * c->felem_size;
+            AVBufferRef *bank;
+            uint8_t *filter;
+
+            if (size > INT_MAX || !(bank = av_buffer_allocz(size)))
+                goto error;
+            filter = bank->data;
+            if (build_filter(c, (void*)filter, factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, filter_type, kaiser_beta)) {
+                av_buffer_unref(&bank);
+                goto error;
+            }
+            memcpy(filter + (c->filter_alloc*phase_count+1)*c->felem_size, filter, (c->filter_alloc-1)*c->felem_size);
+            memcpy(filter + (c->filter_alloc*phase_count  )*c->felem_size, filter + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
+
+            c->filter_bank_buf = swri_filter_cache_add(&key, bank, filter_cache_file);
+            if (!c->filter_bank_buf)
+                goto error;
+        }
+        c->filter_bank = c->filter_bank_buf->data;
     }
 
     c->compensation_distance= 0;
@@ -242,7 +266,7 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
 
     return c;
 error:
-    av_freep(&c->filter_bank);
+    av_buffer_unref(&c->filter_bank_buf);
     av_free(c);
     return NULL;
 }
@@ -250,7 +274,7 @@ error:
 static void resample_free(ResampleContext **c){
     if(!*c)
         return;
-    av_freep(&(*c)->filter_bank);
+    av_buffer_unref(&(*c)->filter_bank_buf);
     av_freep(c);
 }
 
@@ -305,6 +329,36 @@ static int swri_resample(ResampleContext *c,
     return dst_size;
 }
 
+typedef struct ResampleThreadArg {
+    ResampleContext *c;
+    ResampleContext last;       ///< copy updated by the last channel, the others only read c
+    AudioData *dst, *src;
+    int src_size, dst_size;
+    int ret, consumed;
+} ResampleThreadArg;
+
+static void resample_channel(void *arg, int ch)
+{
+    ResampleThreadArg *t = arg;
+    int consumed, ret;
+
+    if (ch + 1 < t->dst->ch_count) {
+        swri_resample(t->c, t->dst->ch[ch], t->src->ch[ch],
+                      &consumed, t->src_size, t->dst_size, 0);
+    } else {
+        ret = swri_resample(&t->last, t->dst->ch[ch], t->src->ch[ch],
+                            &consumed, t->src_size, t->dst_size, 1);
+        t->ret      = ret;
+        t->consumed = consumed;
+    }
+}
+
+void swri_resample_set_threads(ResampleContext *c, SwrThreadPool *pool, int min_samples)
+{
+    c->pool               = pool;
+    c->thread_min_samples = min_samples;
+}
+
 static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
     int i, ret= -1;
     int av_unused mm_flags = av_get_cpu_flags();
@@ -316,9 +370,25 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
         dst_size = FFMIN(dst_size, c->compensation_distance);
     src_size = FFMIN(src_size, max_src_size);
 
-    for(i=0; i<dst->ch_count; i++){
-        ret= swri_resample(c, dst->ch[i], src->ch[i],
-                           consumed, src_size, dst_size, i+1==dst->ch_count);
+    if (c->pool && dst->ch_count > 1 && !need_emms &&
+        FFMIN(src_size, dst_size) >= c->thread_min_samples) {
+        ResampleThreadArg t = {
+            .c        = c,
+            .last     = *c,
+            .dst      = dst,
+            .src      = src,
+            .src_size = src_size,
+            .dst_size = dst_size,
+        };
+        swri_thread_pool_execute(c->pool, resample_channel, &t, dst->ch_count);
+        *c        = t.last;
+        *consumed = t.consumed;
+        ret       = t.ret;
+    } else {
+        for(i=0; i<dst->ch_count; i++){
+            ret= swri_resample(c, dst->ch[i], src->ch[i],
+                               consumed, src_size, dst_size, i+1==dst->ch_count);
+        }
     }
     if(need_emms)
         emms_c();
@@ -22,6 +22,7 @@
 #ifndef SWRESAMPLE_RESAMPLE_H
 #define SWRESAMPLE_RESAMPLE_H
 
+#include "libavutil/buffer.h"
 #include "libavutil/log.h"
 #include "libavutil/samplefmt.h"
 
@@ -49,6 +50,9 @@ typedef struct ResampleContext {
     enum AVSampleFormat format;
     int felem_size;
     int filter_shift;
+    SwrThreadPool *pool;            ///< threads the channels are distributed on, may be NULL
+    AVBufferRef *filter_bank_buf;   ///< reference to the shared filter bank, filter_bank points into it
+    int thread_min_samples;
 
     struct {
         void (*resample_one)(void *dst, const void *src,
@@ -58,6 +62,36 @@ typedef struct ResampleContext {
     } dsp;
 } ResampleContext;
 
+/**
+ * Parameters that fully determine the contents of a filter bank.
+ */
+typedef struct FilterBankKey {
+    double factor;
+    int filter_length;
+    int filter_alloc;
+    int phase_shift;
+    enum SwrFilterType filter_type;
+    int kaiser_beta;
+    enum AVSampleFormat format;
+} FilterBankKey;
+
+/**
+ * Look up a filter bank in the process wide cache and, if path is not NULL
+ * and the bank is not cached yet, in the cache file.
+ *
+ * @return a new reference to the filter bank or NULL if it is not cached
+ */
+AVBufferRef *swri_filter_cache_get(const FilterBankKey *key, const char *path);
+
+/**
+ * Add a newly built filter bank to the cache, taking ownership of bank, and
+ * append it to the cache file if path is not NULL.
+ *
+ * @return a reference to the cached filter bank, which may be a different
+ *         buffer if another context added the same bank concurrently
+ */
+AVBufferRef *swri_filter_cache_add(const FilterBankKey *key, AVBufferRef *bank, const char *path);
+
 void swri_resample_dsp_init(ResampleContext *c);
 void swri_resample_dsp_x86_init(ResampleContext *c);
 
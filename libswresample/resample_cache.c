@@ -0,0 +1,314 @@
+/*
+ * This file is part of libswresample
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Process wide cache of resampler filter banks, optionally backed by a file.
+ *
+ * The file is a sequence of records, each made of a header holding the key
+ * and an adler32 checksum of the data followed by the filter bank as stored
+ * in memory. Records with a wrong checksum are skipped, and reading stops at
+ * a truncated record. New filter banks are added by writing a new file which
+ * replaces the old one, leaving out the damaged records.
+ */
+
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include <stdio.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/avstring.h"
+#include "libavutil/avutil.h"
+#include "libavutil/buffer.h"
+#include "libavutil/intfloat.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/random_seed.h"
+#include "resample.h"
+
+#define MAX_UNUSED_ENTRIES  8
+#define MAX_UNUSED_SIZE     (64 << 20)
+
+#define RECORD_TAG          MKTAG('S', 'W', 'F', 'B')
+#define RECORD_VERSION      (1 | HAVE_BIGENDIAN << 8)
+#define RECORD_HEADER_SIZE  48
+
+typedef struct FilterCacheEntry {
+    FilterBankKey key;
+    AVBufferRef *bank;
+    struct FilterCacheEntry *next;
+} FilterCacheEntry;
+
+#if HAVE_PTHREADS
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static FilterCacheEntry *cache;     ///< most recently used entry first
+
+static void lock_cache(void)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&cache_lock);
+#endif
+}
+
+static void unlock_cache(void)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&cache_lock);
+#endif
+}
+
+static int key_equal(const FilterBankKey *a, const FilterBankKey *b)
+{
+    return av_double2int(a->factor) == av_double2int(b->factor) &&
+           a->filter_length == b->filter_length &&
+           a->filter_alloc  == b->filter_alloc  &&
+           a->phase_shift   == b->phase_shift   &&
+           a->filter_type   == b->filter_type   &&
+           a->kaiser_beta   == b->kaiser_beta   &&
+           a->format        == b->format;
+}
+
+static int64_t bank_size(const FilterBankKey *key)
+{
+    return key->filter_alloc * ((1LL << key->phase_shift) + 1) *
+           av_get_bytes_per_sample(key->format);
+}
+
+/**
+ * Drop the least recently used filter banks that are referenced only by the
+ * cache, keeping at most MAX_UNUSED_ENTRIES / MAX_UNUSED_SIZE of them.
+ * Must be called with the cache locked.
+ */
+static void prune_cache(void)
+{
+    FilterCacheEntry **e = &cache;
+    int unused = 0;
+    int64_t unused_size = 0;
+
+    while (*e) {
+        FilterCacheEntry *entry = *e;
+        if (av_buffer_get_ref_count(entry->bank) == 1) {
+            unused++;
+            unused_size += entry->bank->size;
+            if (unused > MAX_UNUSED_ENTRIES || unused_size > MAX_UNUSED_SIZE) {
+                *e = entry->next;
+                av_buffer_unref(&entry->bank);
+                av_free(entry);
+                continue;
+            }
+        }
+        e = &entry->next;
+    }
+}
+
+static void write_header(uint8_t *buf, const FilterBankKey *key, int size, unsigned checksum)
+{
+    AV_WL32(buf +  0, RECORD_TAG);
+    AV_WL32(buf +  4, RECORD_VERSION);
+    AV_WL64(buf +  8, av_double2int(key->factor));
+    AV_WL32(buf + 16, key->filter_length);
+    AV_WL32(buf + 20, key->filter_alloc);
+    AV_WL32(buf + 24, key->phase_shift);
+    AV_WL32(buf + 28, key->filter_type);
+    AV_WL32(buf + 32, key->kaiser_beta);
+    AV_WL32(buf + 36, key->format);
+    AV_WL32(buf + 40, size);
+    AV_WL32(buf + 44, checksum);
+}
+
+/**
+ * Read the record header at the current position of f.
+ * @return the size of the filter bank following it, or -1 at the end of the
+ *         file or if the rest of the file is damaged
+ */
+static int64_t read_header(FILE *f, uint8_t *header)
+{
+    if (fread(header, RECORD_HEADER_SIZE, 1, f) != 1 ||
+        AV_RL32(header) != RECORD_TAG || !AV_RL32(header + 40))
+        return -1;
+    return AV_RL32(header + 40);
+}
+
+static AVBufferRef *load_bank(const FilterBankKey *key, const char *path)
+{
+    uint8_t wanted[RECORD_HEADER_SIZE], header[RECORD_HEADER_SIZE];
+    int64_t size = bank_size(key), record_size;
+    AVBufferRef *bank = NULL;
+    FILE *f;
+
+    if (size > INT_MAX || !(f = av_fopen_utf8(path, "rb")))
+        return NULL;
+
+    write_header(wanted, key, size, 0);
+    while ((record_size = read_header(f, header)) >= 0) {
+        if (memcmp(header, wanted, 40) || record_size != size) {
+            if (fseek(f, record_size, SEEK_CUR) < 0)
+                break;
+            continue;
+        }
+        if (!(bank = av_buffer_alloc(size)))
+            break;
+        if (fread(bank->data, size, 1, f) == 1 &&
+            av_adler32_update(1, bank->data, size) == AV_RL32(header + 44))
+            break;
+        /* a later copy of the filter bank may be intact */
+        av_log(NULL, AV_LOG_WARNING, "Damaged filter bank in %s\n", path);
+        av_buffer_unref(&bank);
+    }
+    fclose(f);
+    return bank;
+}
+
+/**
+ * Copy the intact records of in to out, except those of the filter bank
+ * described by wanted, which is being replaced.
+ */
+static int copy_records(FILE *in, FILE *out, const uint8_t *wanted)
+{
+    uint8_t header[RECORD_HEADER_SIZE], *data = NULL;
+    int64_t record_size;
+    int ret = 0;
+
+    while ((record_size = read_header(in, header)) >= 0) {
+        if (!(data = av_malloc(record_size)) ||
+            fread(data, record_size, 1, in) != 1)
+            break;
+        if (memcmp(header, wanted, 40) &&
+            av_adler32_update(1, data, record_size) == AV_RL32(header + 44) &&
+            (fwrite(header, RECORD_HEADER_SIZE, 1, out) != 1 ||
+             fwrite(data, record_size, 1, out) != 1)) {
+            ret = -1;
+            break;
+        }
+        av_freep(&data);
+    }
+    av_free(data);
+    return ret;
+}
+
+/**
+ * Add a filter bank to the file. The file is rewritten to a temporary file
+ * which replaces it, so that readers never see a partially written record
+ * and damaged records or older copies of the filter bank are dropped.
+ * When processes store concurrently, the filter banks of all but the last
+ * one may be lost, which only means they are computed again.
+ */
+static void store_bank(const FilterBankKey *key, const AVBufferRef *bank, const char *path)
+{
+    uint8_t header[RECORD_HEADER_SIZE];
+    char *tmp_path = av_asprintf("%s.%08x.tmp", path, av_get_random_seed());
+    FILE *in, *out;
+    int ret;
+
+    if (!tmp_path)
+        return;
+    if (!(out = av_fopen_utf8(tmp_path, "wb"))) {
+        av_log(NULL, AV_LOG_WARNING, "Cannot open filter cache file %s\n", tmp_path);
+        av_free(tmp_path);
+        return;
+    }
+    write_header(header, key, bank->size, av_adler32_update(1, bank->data, bank->size));
+    ret = 0;
+    if ((in = av_fopen_utf8(path, "rb"))) {
+        ret = copy_records(in, out, header);
+        fclose(in);
+    }
+    if (ret < 0 ||
+        fwrite(header, RECORD_HEADER_SIZE, 1, out) != 1 ||
+        fwrite(bank->data, bank->size, 1, out) != 1)
+        ret = -1;
+    if (fclose(out))
+        ret = -1;
+    /* rename() does not replace an existing file on Windows */
+    if (!ret && rename(tmp_path, path) && (remove(path) || rename(tmp_path, path)))
+        ret = -1;
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_WARNING, "Error writing filter cache file %s\n", path);
+        remove(tmp_path);
+    }
+    av_free(tmp_path);
+}
+
+static AVBufferRef *add_bank(const FilterBankKey *key, AVBufferRef *bank, int *added)
+{
+    FilterCacheEntry *entry;
+    AVBufferRef *ret;
+
+    *added = 0;
+    lock_cache();
+    for (entry = cache; entry; entry = entry->next)
+        if (key_equal(&entry->key, key))
+            break;
+    if (entry) {
+        /* another context built the same filter bank concurrently */
+        av_buffer_unref(&bank);
+        ret = av_buffer_ref(entry->bank);
+    } else if ((entry = av_mallocz(sizeof(*entry))) && (ret = av_buffer_ref(bank))) {
+        entry->key  = *key;
+        entry->bank = bank;
+        entry->next = cache;
+        cache       = entry;
+        *added      = 1;
+        prune_cache();
+    } else {
+        av_free(entry);
+        ret = bank;
+    }
+    unlock_cache();
+    return ret;
+}
+
+AVBufferRef *swri_filter_cache_get(const FilterBankKey *key, const char *path)
+{
+    FilterCacheEntry **e, *entry;
+    AVBufferRef *bank = NULL;
+    int added;
+
+    lock_cache();
+    for (e = &cache; *e; e = &(*e)->next) {
+        if (key_equal(&(*e)->key, key)) {
+            entry       = *e;
+            *e          = entry->next;
+            entry->next = cache;
+            cache       = entry;
+            bank        = av_buffer_ref(entry->bank);
+            break;
+        }
+    }
+    unlock_cache();
+
+    if (!bank && path && (bank = load_bank(key, path)))
+        bank = add_bank(key, bank, &added);
+    return bank;
+}
+
+AVBufferRef *swri_filter_cache_add(const FilterBankKey *key, AVBufferRef *bank, const char *path)
+{
+    int added;
+
+    bank = add_bank(key, bank, &added);
+    if (added && path)
+        store_bank(key, bank, path);
+    return bank;
+}
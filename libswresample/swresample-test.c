@@ -22,7 +22,10 @@
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
+#include "libavutil/cpu.h"
 #include "libavutil/opt.h"
+#include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 #include "swresample.h"
 
 #undef time
@@ -221,6 +224,71 @@ static void audiogen(void *data, enum AVSampleFormat sample_fmt,
     }
 }
 
+/**
+ * Time 7.1 -> stereo downmixing at 48 kHz with the C and the SIMD code,
+ * for the float and int16 internal sample formats.
+ */
+static int bench_rematrix(int runs)
+{
+    static const enum AVSampleFormat internal_fmts[] = {
+        AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_S16P,
+    };
+    const int cpu_flags = av_get_cpu_flags();
+    const int nb_samples = 1024;
+    uint8_t **in = NULL, **out = NULL;
+    int i, j, k, ret;
+
+    if ((ret = av_samples_alloc_array_and_samples(&in, NULL, 8, nb_samples,
+                                                  AV_SAMPLE_FMT_FLTP, 0)) < 0 ||
+        (ret = av_samples_alloc_array_and_samples(&out, NULL, 2, nb_samples,
+                                                  AV_SAMPLE_FMT_FLT, 0)) < 0)
+        goto end;
+    for (i = 0; i < 8; i++)
+        for (j = 0; j < nb_samples; j++)
+            ((float *)in[i])[j] = sin(j * (i + 1) * 0.01) * 0.5;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(internal_fmts); i++) {
+        int64_t t[2];
+
+        for (k = 0; k < 2; k++) {
+            struct SwrContext *s;
+
+            av_force_cpu_flags(k ? cpu_flags : 0);
+            s = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLT, 48000,
+                                   AV_CH_LAYOUT_7POINT1, AV_SAMPLE_FMT_FLTP, 48000,
+                                   0, NULL);
+            if (!s) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            av_opt_set_sample_fmt(s, "internal_sample_fmt", internal_fmts[i], 0);
+            if ((ret = swr_init(s)) < 0) {
+                swr_free(&s);
+                goto end;
+            }
+            t[k] = av_gettime_relative();
+            for (j = 0; j < runs; j++)
+                swr_convert(s, out, nb_samples, (const uint8_t **)in, nb_samples);
+            t[k] = av_gettime_relative() - t[k];
+            swr_free(&s);
+        }
+        av_force_cpu_flags(-1);
+
+        printf("7.1 -> stereo, %s: c %"PRId64" us, simd %"PRId64" us per %d runs of %d samples\n",
+               av_get_sample_fmt_name(internal_fmts[i]), t[0], t[1], runs, nb_samples);
+    }
+    ret = 0;
+end:
+    av_force_cpu_flags(-1);
+    if (in)
+        av_freep(&in[0]);
+    av_freep(&in);
+    if (out)
+        av_freep(&out[0]);
+    av_freep(&out);
+    return ret < 0;
+}
+
 int main(int argc, char **argv){
     int in_sample_rate, out_sample_rate, ch ,i, flush_count;
     uint64_t in_ch_layout, out_ch_layout;
@@ -247,9 +315,12 @@ int main(int argc, char **argv){
     if (argc > 1) {
         if (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
             av_log(NULL, AV_LOG_INFO, "Usage: swresample-test [<num_tests>[ <test>]]  \n"
+                   "       swresample-test -bench <runs>\n"
                    "num_tests           Default is %d\n", num_tests);
             return 0;
         }
+        if (!strcmp(argv[1], "-bench"))
+            return bench_rematrix(argc > 2 ? strtol(argv[2], NULL, 0) : 1000);
         num_tests = strtol(argv[1], NULL, 0);
         if(num_tests < 0) {
             num_tests = -num_tests;
@@ -23,6 +23,7 @@
 #include "audioconvert.h"
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/cpu.h"
 
 #include <float.h>
 
@@ -138,6 +139,8 @@ av_cold void swr_free(SwrContext **ss){
         clear_context(s);
         if (s->resampler)
             s->resampler->free(&s->resample);
+        swri_thread_pool_free(&s->thread_pool);
+        av_opt_free(s);
     }
 
     av_freep(ss);
@@ -242,7 +245,7 @@ av_cold int swr_init(struct SwrContext *s){
     }
 
     if (s->out_sample_rate!=s->in_sample_rate || (s->flags & SWR_FLAG_RESAMPLE)){
-        s->resample = s->resampler->init(s->resample, s->out_sample_rate, s->in_sample_rate, s->filter_size, s->phase_shift, s->linear_interp, s->cutoff, s->int_sample_fmt, s->filter_type, s->kaiser_beta, s->precision, s->cheby);
+        s->resample = s->resampler->init(s->resample, s->out_sample_rate, s->in_sample_rate, s->filter_size, s->phase_shift, s->linear_interp, s->cutoff, s->int_sample_fmt, s->filter_type, s->kaiser_beta, s->precision, s->cheby, s->filter_cache_file);
     }else
         s->resampler->free(&s->resample);
     if(    s->int_sample_fmt != AV_SAMPLE_FMT_S16P
@@ -323,6 +326,15 @@ av_assert0(s->out.ch_count);
         set_audiodata_fmt(&s->in_buffer, s->int_sample_fmt);
     }
 
+    swri_thread_pool_free(&s->thread_pool);
+    if (s->resample && s->resampler == &swri_resampler) {
+        int threads = s->threads ? s->threads : av_cpu_count();
+        threads = FFMIN(threads, s->in_buffer.ch_count);
+        if ((ret = swri_thread_pool_init(&s->thread_pool, threads)) < 0)
+            return ret;
+        swri_resample_set_threads(s->resample, s->thread_pool, s->thread_min_samples);
+    }
+
     if ((ret = swri_dither_init(s, s->out_sample_fmt, s->int_sample_fmt)) < 0)
         return ret;
 
@@ -42,6 +42,8 @@ typedef void (mix_2_1_func_type)(void *out, const void *in1, const void *in2, vo
 
 typedef void (mix_any_func_type)(uint8_t **out, const uint8_t **in1, void *coeffp, integer len);
 
+typedef void (mix_n_1_func_type)(void *out, const uint8_t **in, void *coeffp, integer n, integer len);
+
 typedef struct AudioData{
     uint8_t *ch[SWR_CH_MAX];    ///< samples buffer per channel
     uint8_t *data;              ///< samples buffer
@@ -100,6 +102,10 @@ struct SwrContext {
     int kaiser_beta;                                /**< swr beta value for Kaiser window (only applicable if filter_type == AV_FILTER_TYPE_KAISER) */
     double precision;                               /**< soxr resampling precision (in bits) */
     int cheby;                                      /**< soxr: if 1 then passband rolloff will be none (Chebyshev) & irrational ratio approximation precision will be higher */
+    int threads;                                    /**< number of threads used to resample the channels in parallel, 0 for automatic */
+    int thread_min_samples;                         /**< minimum number of samples per call for which the channels are resampled in parallel */
+    struct SwrThreadPool *thread_pool;              ///< worker threads used for resampling
+    char *filter_cache_file;                        /**< file the swr filter banks are loaded from and stored to */
 
     float min_compensation;                         ///< swr minimum below which no compensation will happen
     float min_hard_compensation;                    ///< swr minimum below which no silence inject / sample drop will happen
@@ -139,6 +145,7 @@ struct SwrContext {
     uint8_t *native_one;
     uint8_t *native_simd_one;
     uint8_t *native_simd_matrix;
+    uint8_t *native_simd_n_matrix;                  ///< per output channel coefficients of the inputs listed in matrix_ch, for mix_n_1_simd
     int32_t matrix32[SWR_CH_MAX][SWR_CH_MAX];       ///< 17.15 fixed point rematrixing coefficients
     uint8_t matrix_ch[SWR_CH_MAX][SWR_CH_MAX+1];    ///< Lists of input channels per output channel that have non zero rematrixing coefficients
     mix_1_1_func_type *mix_1_1_f;
@@ -149,11 +156,14 @@ struct SwrContext {
 
     mix_any_func_type *mix_any_f;
 
+    mix_n_1_func_type *mix_n_1_simd;
+
     /* TODO: callbacks for ASM optimizations */
 };
 
 typedef struct ResampleContext * (* resample_init_func)(struct ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
-                                    double cutoff, enum AVSampleFormat format, enum SwrFilterType filter_type, int kaiser_beta, double precision, int cheby);
+                                    double cutoff, enum AVSampleFormat format, enum SwrFilterType filter_type, int kaiser_beta, double precision, int cheby,
+                                    const char *filter_cache_file);
 typedef void    (* resample_free_func)(struct ResampleContext **c);
 typedef int     (* multiple_resample_func)(struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
 typedef int     (* resample_flush_func)(struct SwrContext *c);
@@ -175,6 +185,25 @@ extern struct Resampler const swri_resampler;
 
 int swri_realloc_audio(AudioData *a, int count);
 
+typedef struct SwrThreadPool SwrThreadPool;
+
+/**
+ * Start nb_threads - 1 worker threads; the calling thread is the last one.
+ * Sets *pool to NULL if nb_threads is less than 2 or threads are not
+ * supported.
+ */
+int swri_thread_pool_init(SwrThreadPool **pool, int nb_threads);
+void swri_thread_pool_free(SwrThreadPool **pool);
+
+/**
+ * Call func(arg, jobnr) for every jobnr in [0, nb_jobs) on the pool threads
+ * and return once all of them are done.
+ */
+void swri_thread_pool_execute(SwrThreadPool *pool, void (*func)(void *arg, int jobnr),
+                              void *arg, int nb_jobs);
+
+void swri_resample_set_threads(struct ResampleContext *c, SwrThreadPool *pool, int min_samples);
+
 void swri_noise_shaping_int16 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 void swri_noise_shaping_int32 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
@@ -0,0 +1,198 @@
+/*
+ * This file is part of libswresample
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Minimal worker pool used to process channels in parallel.
+ */
+
+#include "config.h"
+
+#if HAVE_THREADS
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#elif HAVE_OS2THREADS
+#include "compat/os2threads.h"
+#endif
+#endif
+
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "swresample_internal.h"
+
+struct SwrThreadPool {
+#if HAVE_THREADS
+    pthread_t *workers;
+    int nb_workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;               ///< signalled when a new job set is posted
+    pthread_cond_t done_cond;               ///< signalled when the last worker finished
+    unsigned generation;                    ///< incremented for every job set
+    int pending;                            ///< workers still busy with the current job set
+    int die;
+
+    void (*func)(void *arg, int jobnr);
+    void *arg;
+    int nb_jobs;
+    int next_job;
+#else
+    int dummy;
+#endif
+};
+
+#if HAVE_THREADS
+static void run_jobs(SwrThreadPool *p)
+{
+    for (;;) {
+        int job;
+
+        pthread_mutex_lock(&p->lock);
+        job = p->next_job < p->nb_jobs ? p->next_job++ : -1;
+        pthread_mutex_unlock(&p->lock);
+        if (job < 0)
+            return;
+        p->func(p->arg, job);
+    }
+}
+
+static void *worker(void *arg)
+{
+    SwrThreadPool *p = arg;
+    unsigned generation = 0;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (p->generation == generation && !p->die)
+            pthread_cond_wait(&p->work_cond, &p->lock);
+        if (p->die)
+            break;
+        generation = p->generation;
+        pthread_mutex_unlock(&p->lock);
+
+        run_jobs(p);
+
+        pthread_mutex_lock(&p->lock);
+        if (!--p->pending)
+            pthread_cond_signal(&p->done_cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+#endif
+
+int swri_thread_pool_init(SwrThreadPool **pool, int nb_threads)
+{
+#if HAVE_THREADS
+    SwrThreadPool *p;
+    int i, ret;
+
+    *pool = NULL;
+    if (nb_threads < 2)
+        return 0;
+    if (!(p = av_mallocz(sizeof(*p))))
+        return AVERROR(ENOMEM);
+    /* the calling thread takes part in the work, too */
+    if (!(p->workers = av_mallocz_array(nb_threads - 1, sizeof(*p->workers)))) {
+        av_free(p);
+        return AVERROR(ENOMEM);
+    }
+    if ((ret = pthread_mutex_init(&p->lock, NULL)))
+        goto mutex_fail;
+    if ((ret = pthread_cond_init(&p->work_cond, NULL)))
+        goto work_cond_fail;
+    if ((ret = pthread_cond_init(&p->done_cond, NULL)))
+        goto done_cond_fail;
+
+    for (i = 0; i < nb_threads - 1; i++) {
+        if ((ret = pthread_create(&p->workers[i], NULL, worker, p))) {
+            *pool = p;
+            swri_thread_pool_free(pool);
+            return AVERROR(ret);
+        }
+        p->nb_workers++;
+    }
+    *pool = p;
+    return 0;
+
+done_cond_fail:
+    pthread_cond_destroy(&p->work_cond);
+work_cond_fail:
+    pthread_mutex_destroy(&p->lock);
+mutex_fail:
+    av_freep(&p->workers);
+    av_free(p);
+    return AVERROR(ret);
+#else
+    *pool = NULL;
+    return 0;
+#endif
+}
+
+void swri_thread_pool_free(SwrThreadPool **pool)
+{
+#if HAVE_THREADS
+    SwrThreadPool *p = *pool;
+    int i;
+
+    if (!p)
+        return;
+    pthread_mutex_lock(&p->lock);
+    p->die = 1;
+    pthread_cond_broadcast(&p->work_cond);
+    pthread_mutex_unlock(&p->lock);
+    for (i = 0; i < p->nb_workers; i++)
+        pthread_join(p->workers[i], NULL);
+
+    pthread_cond_destroy(&p->done_cond);
+    pthread_cond_destroy(&p->work_cond);
+    pthread_mutex_destroy(&p->lock);
+    av_freep(&p->workers);
+#endif
+    av_freep(pool);
+}
+
+void swri_thread_pool_execute(SwrThreadPool *p, void (*func)(void *arg, int jobnr),
+                              void *arg, int nb_jobs)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&p->lock);
+    p->func     = func;
+    p->arg      = arg;
+    p->nb_jobs  = nb_jobs;
+    p->next_job = 0;
+    p->pending  = p->nb_workers;
+    p->generation++;
+    pthread_cond_broadcast(&p->work_cond);
+    pthread_mutex_unlock(&p->lock);
+
+    run_jobs(p);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->pending)
+        pthread_cond_wait(&p->done_cond, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+#else
+    int i;
+
+    for (i = 0; i < nb_jobs; i++)
+        func(arg, i);
+#endif
+}
@@ -25,10 +25,20 @@ flt2pm31: times 8 dd 4.6566129e-10
 flt2p31 : times 8 dd 2147483648.0
 flt2p15 : times 8 dd 32768.0
 
-word_unpack_shuf : db  0, 1, 4, 5, 8, 9,12,13, 2, 3, 6, 7,10,11,14,15
+word_unpack_shuf : times 2 db  0, 1, 4, 5, 8, 9,12,13, 2, 3, 6, 7,10,11,14,15
 
 SECTION .text
 
+; The AVX2 unpack, pack and shuffle instructions work within 128-bit lanes;
+; reorder the qwords (0, 2, 1, 3) to get the samples back in sequence.
+%macro LANE_FIXUP 1-2
+%if cpuflag(avx2)
+    vpermq      m%1, m%1, 0xd8
+%if %0 > 1
+    vpermq      m%2, m%2, 0xd8
+%endif
+%endif
+%endmacro
 
 ;to, from, a/u, log2_outsize, log_intsize, const
 %macro PACK_2CH 5-7
@@ -54,8 +64,9 @@ pack_2ch_%2_to_%1_u_int %+ SUFFIX
 .next:
 %if %4 >= %5
     mov%3     m0, [         srcq +(1<<%5)*lenq]
-    mova      m1, m0
     mov%3     m2, [         src2q+(1<<%5)*lenq]
+    LANE_FIXUP 0, 2
+    mova      m1, m0
 %if %5 == 1
     punpcklwd m0, m2
     punpckhwd m1, m2
@@ -113,12 +124,13 @@ unpack_2ch_%2_to_%1_u_int %+ SUFFIX
     mov%3     m0, [           srcq +(2<<%5)*lenq]
     mov%3     m2, [  mmsize + srcq +(2<<%5)*lenq]
 %if %5 == 1
-%ifidn SUFFIX, _ssse3
+%if cpuflag(ssse3)
     pshufb    m0, m6
     mova      m1, m0
     pshufb    m2, m6
     punpcklqdq m0,m2
     punpckhqdq m1,m2
+    LANE_FIXUP 0, 1
 %else
     mova      m1, m0
     punpcklwd m0,m2
@@ -136,6 +148,7 @@ unpack_2ch_%2_to_%1_u_int %+ SUFFIX
     mova      m1, m0
     shufps    m0, m2, 10001000b
     shufps    m1, m2, 11011101b
+    LANE_FIXUP 0, 1
 %endif
 %if %4 < %5
     mov%3     m2, [2*mmsize + srcq +(2<<%5)*lenq]
@@ -463,3 +476,27 @@ INIT_YMM avx
 CONV float, int32, u, 2, 2, INT32_TO_FLOAT_N, INT32_TO_FLOAT_INIT
 CONV float, int32, a, 2, 2, INT32_TO_FLOAT_N, INT32_TO_FLOAT_INIT
 %endif
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+CONV int32, float, u, 2, 2, FLOAT_TO_INT32_N, FLOAT_TO_INT32_INIT
+CONV int32, float, a, 2, 2, FLOAT_TO_INT32_N, FLOAT_TO_INT32_INIT
+
+PACK_2CH int16, int16, u, 1, 1, NOP_N, NOP_N
+PACK_2CH int16, int16, a, 1, 1, NOP_N, NOP_N
+PACK_2CH int32, int32, u, 2, 2, NOP_N, NOP_N
+PACK_2CH int32, int32, a, 2, 2, NOP_N, NOP_N
+PACK_2CH float, int32, u, 2, 2, INT32_TO_FLOAT_N, INT32_TO_FLOAT_INIT
+PACK_2CH float, int32, a, 2, 2, INT32_TO_FLOAT_N, INT32_TO_FLOAT_INIT
+PACK_2CH int32, float, u, 2, 2, FLOAT_TO_INT32_N, FLOAT_TO_INT32_INIT
+PACK_2CH int32, float, a, 2, 2, FLOAT_TO_INT32_N, FLOAT_TO_INT32_INIT
+
+UNPACK_2CH int16, int16, u, 1, 1, NOP_N, NOP_N
+UNPACK_2CH int16, int16, a, 1, 1, NOP_N, NOP_N
+UNPACK_2CH int32, int32, u, 2, 2, NOP_N, NOP_N
+UNPACK_2CH int32, int32, a, 2, 2, NOP_N, NOP_N
+UNPACK_2CH float, int32, u, 2, 2, INT32_TO_FLOAT_N, INT32_TO_FLOAT_INIT
+UNPACK_2CH float, int32, a, 2, 2, INT32_TO_FLOAT_N, INT32_TO_FLOAT_INIT
+UNPACK_2CH int32, float, u, 2, 2, FLOAT_TO_INT32_N, FLOAT_TO_INT32_INIT
+UNPACK_2CH int32, float, a, 2, 2, FLOAT_TO_INT32_N, FLOAT_TO_INT32_INIT
+%endif
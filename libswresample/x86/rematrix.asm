@@ -24,6 +24,7 @@
 SECTION_RODATA 32
 dw1: times 8  dd 1
 w1 : times 16 dw 1
+dw16384: times 8 dd 16384
 
 SECTION .text
 
@@ -222,6 +223,73 @@ mix_2_1_int16_u_int %+ SUFFIX
 %endif
 %endmacro
 
+;------------------------------------------------------------------------------
+; Mix an arbitrary number of input channels into one output channel:
+; out[i] = sum(coeffp[j] * in[j][i]), j < n.
+; The int16 version takes the coefficients as pairs of words, so in[] must
+; hold an even number of entries (padded with a 0 coefficient if needed),
+; and rounds the 17.15 fixed point sums like the C code does.
+; len must be a multiple of 16.
+;------------------------------------------------------------------------------
+%macro MIXN_FLT 0
+cglobal mix_n_1_float, 5, 8, 3, out, in, coeffp, n, len, i, src, j
+    shl        lenq, 2
+    xor          iq, iq
+.next:
+    xorps        m0, m0
+    xorps        m1, m1
+    xor          jq, jq
+.in:
+    mov        srcq, [inq + gprsize*jq]
+    VBROADCASTSS m2, [coeffpq + 4*jq]
+    fmaddps      m0, m2, [srcq + iq         ], m0
+    fmaddps      m1, m2, [srcq + iq + mmsize], m1
+    inc          jq
+    cmp          jq, nq
+        jl .in
+    movu  [outq + iq         ], m0
+    movu  [outq + iq + mmsize], m1
+    add          iq, mmsize*2
+    cmp          iq, lenq
+        jl .next
+    RET
+%endmacro
+
+%macro MIXN_INT16 0
+cglobal mix_n_1_int16, 5, 8, 6, out, in, coeffp, n, len, i, src, j
+    add        lenq, lenq
+    xor          iq, iq
+.next:
+    mova         m0, [dw16384]
+    mova         m1, m0
+    xor          jq, jq
+.in:
+    mov        srcq, [inq + gprsize*jq]
+    movu         m2, [srcq + iq]
+    mov        srcq, [inq + gprsize*jq + gprsize]
+    movu         m3, [srcq + iq]
+    vpbroadcastd m4, [coeffpq + 2*jq]
+    punpckhwd    m5, m2, m3
+    punpcklwd    m2, m3
+    pmaddwd      m2, m4
+    pmaddwd      m5, m4
+    paddd        m0, m2
+    paddd        m1, m5
+    add          jq, 2
+    cmp          jq, nq
+        jl .in
+    ; both accumulators hold samples of the same 128-bit lanes, so the
+    ; lane-wise pack restores the sample order
+    psrad        m0, 15
+    psrad        m1, 15
+    packssdw     m0, m1
+    movu [outq + iq], m0
+    add          iq, mmsize
+    cmp          iq, lenq
+        jl .next
+    RET
+%endmacro
+
 
 INIT_MMX mmx
 MIX1_INT16 u
@@ -248,3 +316,14 @@ MIX2_FLT a
 MIX1_FLT u
 MIX1_FLT a
 %endif
+
+%if ARCH_X86_64
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+MIXN_FLT
+%endif
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+MIXN_INT16
+%endif
+%endif
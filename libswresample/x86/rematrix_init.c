@@ -30,6 +30,9 @@ D(float, avx)
 D(int16, mmx)
 D(int16, sse2)
 
+mix_n_1_func_type ff_mix_n_1_float_fma3;
+mix_n_1_func_type ff_mix_n_1_int16_avx2;
+
 av_cold void swri_rematrix_init_x86(struct SwrContext *s){
 #if HAVE_YASM
     int mm_flags = av_get_cpu_flags();
@@ -40,6 +43,7 @@ av_cold void swri_rematrix_init_x86(struct SwrContext *s){
 
     s->mix_1_1_simd = NULL;
     s->mix_2_1_simd = NULL;
+    s->mix_n_1_simd = NULL;
 
     if (s->midbuf.fmt == AV_SAMPLE_FMT_S16P){
         if(EXTERNAL_MMX(mm_flags)) {
@@ -65,6 +69,23 @@ av_cold void swri_rematrix_init_x86(struct SwrContext *s){
         }
         ((int16_t*)s->native_simd_one)[1] = 14;
         ((int16_t*)s->native_simd_one)[0] = 16384;
+
+        if (ARCH_X86_64 && EXTERNAL_AVX2(mm_flags)) {
+            int stride = FFALIGN(nb_in, 2);
+            int16_t *m;
+            for (i = 0; i < nb_out; i++)
+                for (j = 0; j < nb_in; j++)
+                    if (s->matrix32[i][j] != (int16_t)s->matrix32[i][j])
+                        return;
+            s->native_simd_n_matrix = av_mallocz(nb_out * stride * sizeof(int16_t));
+            if (!s->native_simd_n_matrix)
+                return;
+            m = (int16_t*)s->native_simd_n_matrix;
+            for (i = 0; i < nb_out; i++)
+                for (j = 0; j < s->matrix_ch[i][0]; j++)
+                    m[i * stride + j] = s->matrix32[i][s->matrix_ch[i][1 + j]];
+            s->mix_n_1_simd = ff_mix_n_1_int16_avx2;
+        }
     } else if(s->midbuf.fmt == AV_SAMPLE_FMT_FLTP){
         if(EXTERNAL_SSE(mm_flags)) {
             s->mix_1_1_simd = ff_mix_1_1_a_float_sse;
@@ -78,6 +99,19 @@ av_cold void swri_rematrix_init_x86(struct SwrContext *s){
         memcpy(s->native_simd_matrix, s->native_matrix, num * sizeof(float));
         s->native_simd_one = av_mallocz(sizeof(float));
         memcpy(s->native_simd_one, s->native_one, sizeof(float));
+
+        if (ARCH_X86_64 && EXTERNAL_FMA3(mm_flags)) {
+            int stride = FFALIGN(nb_in, 2);
+            float *m;
+            s->native_simd_n_matrix = av_mallocz(nb_out * stride * sizeof(float));
+            if (!s->native_simd_n_matrix)
+                return;
+            m = (float*)s->native_simd_n_matrix;
+            for (i = 0; i < nb_out; i++)
+                for (j = 0; j < s->matrix_ch[i][0]; j++)
+                    m[i * stride + j] = s->matrix[i][s->matrix_ch[i][1 + j]];
+            s->mix_n_1_simd = ff_mix_n_1_float_fma3;
+        }
     }
 #endif
 }
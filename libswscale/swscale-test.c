@@ -28,9 +28,11 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 #include "libavutil/avutil.h"
+#include "libavutil/cpu.h"
 #include "libavutil/crc.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/lfg.h"
+#include "libavutil/time.h"
 #include "swscale.h"
 
 /* HACK Duplicated from swscale_internal.h.
@@ -340,6 +342,227 @@ static int fileTest(uint8_t *ref[4], int refStride[4], int w, int h, FILE *fp,
     return 0;
 }
 
+/* Time context creation for some common resizes: the first context
+ * computes the filters, the following ones can reuse them. */
+static int initBench(int runs)
+{
+    static const struct { int srcW, srcH, dstW, dstH; } sizes[] = {
+        { 1920, 1080, 1280,  720 },
+        { 1280,  720, 1920, 1080 },
+        { 3840, 2160, 1920, 1080 },
+        {  720,  576, 1920, 1080 },
+    };
+    int i, j;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        int64_t first = 0, total = 0;
+
+        for (j = 0; j <= runs; j++) {
+            struct SwsContext *sws;
+            int64_t t = av_gettime_relative();
+
+            sws = sws_getContext(sizes[i].srcW, sizes[i].srcH, AV_PIX_FMT_YUV420P,
+                                 sizes[i].dstW, sizes[i].dstH, AV_PIX_FMT_YUV420P,
+                                 SWS_BICUBIC, NULL, NULL, NULL);
+            t = av_gettime_relative() - t;
+            if (!sws) {
+                fprintf(stderr, "Failed to get context\n");
+                return -1;
+            }
+            sws_freeContext(sws);
+            if (j)
+                total += t;
+            else
+                first  = t;
+        }
+        printf("%dx%d -> %dx%d init: first %"PRId64" us, then %"PRId64" us\n",
+               sizes[i].srcW, sizes[i].srcH, sizes[i].dstW, sizes[i].dstH,
+               first, runs ? total / runs : 0);
+    }
+    return 0;
+}
+
+/* Time sws_scale() on the high bit depth planar formats, once with the
+ * C code only and once with all optimizations the cpu supports. */
+static int hbdBench(int runs)
+{
+    static const enum AVPixelFormat formats[] = {
+        AV_PIX_FMT_YUV420P10LE,
+        AV_PIX_FMT_YUV422P10LE,
+        AV_PIX_FMT_YUV444P12LE,
+    };
+    static const struct { int srcW, srcH, dstW, dstH; } sizes[] = {
+        { 1920, 1080, 1280,  720 },
+        { 1280,  720, 1920, 1080 },
+    };
+    const int cpu_flags = av_get_cpu_flags();
+    uint8_t *src[4] = { NULL }, *dst[4] = { NULL };
+    AVLFG rand;
+    int i, j, k, p, res = -1;
+
+    av_lfg_init(&rand, 1);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(formats[i]);
+
+        for (j = 0; j < FF_ARRAY_ELEMS(sizes); j++) {
+            int srcStride[4], dstStride[4];
+            int64_t t[2];
+
+            if (av_image_alloc(src, srcStride, sizes[j].srcW, sizes[j].srcH,
+                               formats[i], 32) < 0 ||
+                av_image_alloc(dst, dstStride, sizes[j].dstW, sizes[j].dstH,
+                               formats[i], 32) < 0) {
+                fprintf(stderr, "Failed to allocate images\n");
+                goto end;
+            }
+            for (p = 0; p < 3; p++) {
+                int h = p ? -((-sizes[j].srcH) >> desc->log2_chroma_h) : sizes[j].srcH;
+                uint16_t *line = (uint16_t *)src[p];
+
+                for (k = 0; k < srcStride[p] / 2 * h; k++)
+                    line[k] = av_lfg_get(&rand) >> (31 - desc->comp[0].depth_minus1);
+            }
+
+            for (p = 0; p < 2; p++) {
+                struct SwsContext *sws;
+
+                av_force_cpu_flags(p ? cpu_flags : 0);
+                sws = sws_getContext(sizes[j].srcW, sizes[j].srcH, formats[i],
+                                     sizes[j].dstW, sizes[j].dstH, formats[i],
+                                     SWS_BICUBIC, NULL, NULL, NULL);
+                if (!sws) {
+                    fprintf(stderr, "Failed to get context\n");
+                    av_force_cpu_flags(-1);
+                    goto end;
+                }
+                t[p] = av_gettime_relative();
+                for (k = 0; k < runs; k++)
+                    sws_scale(sws, (const uint8_t * const *)src, srcStride,
+                              0, sizes[j].srcH, dst, dstStride);
+                t[p] = av_gettime_relative() - t[p];
+                sws_freeContext(sws);
+            }
+            av_force_cpu_flags(-1);
+
+            printf("%s %dx%d -> %dx%d: c %"PRId64" us, simd %"PRId64" us per frame\n",
+                   desc->name, sizes[j].srcW, sizes[j].srcH,
+                   sizes[j].dstW, sizes[j].dstH,
+                   runs ? t[0] / runs : 0, runs ? t[1] / runs : 0);
+            av_freep(&src[0]);
+            av_freep(&dst[0]);
+        }
+    }
+    res = 0;
+end:
+    av_freep(&src[0]);
+    av_freep(&dst[0]);
+    return res;
+}
+
+typedef struct SliceConsumer {
+    int chr_shift;
+    int chr_w;
+    int w;
+    uint32_t sum;
+} SliceConsumer;
+
+/* Stand-in for a slice-aware consumer such as an encoder: read every
+ * pixel of the given rows once. */
+static void consume_rows(SliceConsumer *s, uint8_t *const dst[],
+                         const int dstStride[], int y, int h)
+{
+    int chr_y = y >> s->chr_shift;
+    int chr_h = -((-(y + h)) >> s->chr_shift) - chr_y;
+    int x, i, p;
+
+    for (i = 0; i < h; i++) {
+        const uint8_t *line = dst[0] + (y + i) * dstStride[0];
+        for (x = 0; x < s->w; x++)
+            s->sum += line[x];
+    }
+    for (p = 1; p < 3; p++) {
+        for (i = 0; i < chr_h; i++) {
+            const uint8_t *line = dst[p] + (chr_y + i) * dstStride[p];
+            for (x = 0; x < s->chr_w; x++)
+                s->sum += line[x];
+        }
+    }
+}
+
+static void slice_cb(void *opaque, uint8_t *const dst[], const int dstStride[],
+                     int y, int h)
+{
+    consume_rows(opaque, dst, dstStride, y, h);
+}
+
+static int sliceBench(int runs)
+{
+    static const int band_heights[] = { 0, 16, 64 };
+    const int srcW = 3840, srcH = 2160, dstW = 1920, dstH = 1080;
+    const enum AVPixelFormat format = AV_PIX_FMT_YUV420P;
+    uint8_t *src[4] = { NULL }, *dst[4] = { NULL };
+    int srcStride[4], dstStride[4];
+    SliceConsumer cons = { 1, dstW / 2, dstW };
+    uint32_t ref_sum = 0;
+    AVLFG rand;
+    int i, k, p, res = -1;
+
+    if (av_image_alloc(src, srcStride, srcW, srcH, format, 32) < 0 ||
+        av_image_alloc(dst, dstStride, dstW, dstH, format, 32) < 0) {
+        fprintf(stderr, "Failed to allocate images\n");
+        goto end;
+    }
+    av_lfg_init(&rand, 1);
+    for (p = 0; p < 3; p++)
+        for (k = 0; k < srcStride[p] * (p ? srcH / 2 : srcH); k++)
+            src[p][k] = av_lfg_get(&rand);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(band_heights); i++) {
+        struct SwsContext *sws = sws_getContext(srcW, srcH, format,
+                                                dstW, dstH, format,
+                                                SWS_BICUBIC, NULL, NULL, NULL);
+        int64_t t;
+
+        if (!sws) {
+            fprintf(stderr, "Failed to get context\n");
+            goto end;
+        }
+        if (band_heights[i])
+            sws_set_slice_callback(sws, slice_cb, &cons, band_heights[i]);
+
+        t = av_gettime_relative();
+        for (k = 0; k < runs; k++) {
+            cons.sum = 0;
+            sws_scale(sws, (const uint8_t * const *)src, srcStride,
+                      0, srcH, dst, dstStride);
+            if (!band_heights[i])
+                consume_rows(&cons, dst, dstStride, 0, dstH);
+        }
+        t = av_gettime_relative() - t;
+        sws_freeContext(sws);
+
+        if (!band_heights[i])
+            ref_sum = cons.sum;
+        else if (cons.sum != ref_sum) {
+            fprintf(stderr, "Band consumer mismatch (band height %d)\n",
+                    band_heights[i]);
+            goto end;
+        }
+        if (band_heights[i])
+            printf("%dx%d -> %dx%d, bands of %d rows: %"PRId64" us per frame\n",
+                   srcW, srcH, dstW, dstH, band_heights[i], runs ? t / runs : 0);
+        else
+            printf("%dx%d -> %dx%d, whole frame: %"PRId64" us per frame\n",
+                   srcW, srcH, dstW, dstH, runs ? t / runs : 0);
+    }
+    res = 0;
+end:
+    av_freep(&src[0]);
+    av_freep(&dst[0]);
+    return res;
+}
+
 #define W 96
 #define H 96
 
@@ -378,6 +601,15 @@ int main(int argc, char **argv)
                 fprintf(stderr, "invalid pixel format %s\n", argv[i + 1]);
                 return -1;
             }
+        } else if (!strcmp(argv[i], "-bench_init")) {
+            res = initBench(atoi(argv[i + 1]));
+            goto error;
+        } else if (!strcmp(argv[i], "-bench_hbd")) {
+            res = hbdBench(atoi(argv[i + 1]));
+            goto error;
+        } else if (!strcmp(argv[i], "-bench_slices")) {
+            res = sliceBench(atoi(argv[i + 1]));
+            goto error;
         } else if (!strcmp(argv[i], "-dst")) {
             dstFormat = av_get_pix_fmt(argv[i + 1]);
             if (dstFormat == AV_PIX_FMT_NONE) {
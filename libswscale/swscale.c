@@ -63,6 +63,45 @@ static av_always_inline void fillPlane(uint8_t *plane, int stride, int width,
     }
 }
 
+static void fill_missing_alpha(SwsContext *c, uint8_t *dst[],
+                               const int dstStride[], int y, int height)
+{
+    enum AVPixelFormat dstFormat = c->dstFormat;
+
+    if (is16BPS(dstFormat) || isNBPS(dstFormat)) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(dstFormat);
+        fillPlane16(dst[3], dstStride[3], c->dstW, height, y,
+                1, desc->comp[3].depth_minus1,
+                isBE(dstFormat));
+    } else
+        fillPlane(dst[3], dstStride[3], c->dstW, height, y, 255);
+}
+
+static void finish_output(void)
+{
+#if HAVE_MMXEXT_INLINE
+    if (av_get_cpu_flags() & AV_CPU_FLAG_MMXEXT)
+        __asm__ volatile ("sfence" ::: "memory");
+#endif
+    emms_c();
+}
+
+/**
+ * Report the rows of the current frame up to end (in scaling order) to
+ * the slice callback, split into bands of at most slice_cb_height rows.
+ */
+static void report_slices(SwsContext *c, int end)
+{
+    while (c->slice_cb_y < end) {
+        int y = c->slice_cb_y;
+        int h = FFMIN(c->slice_cb_height, end - y);
+
+        c->slice_cb_y += h;
+        c->slice_cb(c->slice_cb_opaque, c->slice_cb_dst, c->slice_cb_dstStride,
+                    c->slice_cb_flip ? c->dstH - y - h : y, h);
+    }
+}
+
 static void hScale16To19_c(SwsContext *c, int16_t *_dst, int dstW,
                            const uint8_t *_src, const int16_t *filter,
                            const int32_t *filterPos, int filterSize)
@@ -345,7 +384,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     const int chrSrcSliceH           = FF_CEIL_RSHIFT(srcSliceH,   c->chrSrcVSubSample);
     int should_dither                = is9_OR_10BPS(c->srcFormat) ||
                                        is16BPS(c->srcFormat);
-    int lastDstY;
+    int lastDstY, filledY;
 
     /* vars which will change and which we need to store back in the context */
     int dstY         = c->dstY;
@@ -420,6 +459,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         c->chrDither8 = c->lumDither8 = sws_pb_64;
     }
     lastDstY = dstY;
+    filledY  = dstY;
 
     for (; dstY < dstH; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
@@ -642,25 +682,22 @@ static int swscale(SwsContext *c, const uint8_t *src[],
                          alpSrcPtr, dest, dstW, dstY);
             }
         }
+
+        /* hand the finished band to the caller while it is still hot */
+        if (c->slice_cb_inloop &&
+            ((dstY + 1) % c->slice_cb_height == 0 || dstY + 1 == dstH)) {
+            if (isPlanar(dstFormat) && isALPHA(dstFormat) && !alpPixBuf) {
+                fill_missing_alpha(c, dst, dstStride, filledY, dstY + 1 - filledY);
+                filledY = dstY + 1;
+            }
+            finish_output();
+            report_slices(c, dstY + 1);
+        }
     }
-    if (isPlanar(dstFormat) && isALPHA(dstFormat) && !alpPixBuf) {
-        int length = dstW;
-        int height = dstY - lastDstY;
-
-        if (is16BPS(dstFormat) || isNBPS(dstFormat)) {
-            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(dstFormat);
-            fillPlane16(dst[3], dstStride[3], length, height, lastDstY,
-                    1, desc->comp[3].depth_minus1,
-                    isBE(dstFormat));
-        } else
-            fillPlane(dst[3], dstStride[3], length, height, lastDstY, 255);
-    }
+    if (isPlanar(dstFormat) && isALPHA(dstFormat) && !alpPixBuf)
+        fill_missing_alpha(c, dst, dstStride, filledY, dstY - filledY);
 
-#if HAVE_MMXEXT_INLINE
-    if (av_get_cpu_flags() & AV_CPU_FLAG_MMXEXT)
-        __asm__ volatile ("sfence" ::: "memory");
-#endif
-    emms_c();
+    finish_output();
 
     /* store changed local vars back in the context */
     c->dstY         = dstY;
@@ -891,7 +928,7 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
                                   int srcSliceH, uint8_t *const dst[],
                                   const int dstStride[])
 {
-    int i, ret;
+    int i, ret, sliceY;
     const uint8_t *src2[4];
     uint8_t *dst2[4];
     uint8_t *rgb0_tmp = NULL;
@@ -1044,6 +1081,19 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
             memset(c->dither_error[i], 0, sizeof(c->dither_error[0][0]) * (c->dstW+2));
 
 
+    /* XYZ output is converted in place after scaling, so its rows can only
+     * be reported once the whole slice has been processed */
+    c->slice_cb_inloop = c->slice_cb &&
+                         !(c->dstXYZ && !(c->srcXYZ && c->srcW==c->dstW && c->srcH==c->dstH));
+    sliceY = c->sliceDir == 1 ? srcSliceY : c->srcH - srcSliceY - srcSliceH;
+    if (c->slice_cb) {
+        if (!sliceY)
+            c->slice_cb_y = 0;
+        c->slice_cb_flip = c->sliceDir == -1;
+        memcpy(c->slice_cb_dst,       dst,       sizeof(c->slice_cb_dst));
+        memcpy(c->slice_cb_dstStride, dstStride, sizeof(c->slice_cb_dstStride));
+    }
+
     // copy strides, so they can safely be modified
     if (c->sliceDir == 1) {
         // slices go from top to bottom
@@ -1095,7 +1145,37 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         rgb48Toxyz12(c, (uint16_t*)dst2[0], (const uint16_t*)dst2[0], dstStride[0]/2, ret);
     }
 
+    if (c->slice_cb && ret > 0) {
+        /* report whatever the scaler did not report itself; the unscaled
+         * converters write exactly the rows of the input slice */
+        int done = c->swscale == swscale ? c->dstY : sliceY + ret;
+        if (done < c->dstH)
+            done &= ~((1 << c->chrDstVSubSample) - 1);
+        report_slices(c, done);
+    }
+
     av_free(rgb0_tmp);
     return ret;
 }
 
+int sws_set_slice_callback(struct SwsContext *c, SwsSliceCallback cb,
+                           void *opaque, int band_height)
+{
+    int align = 1 << c->chrDstVSubSample;
+
+    if (band_height < 0)
+        return AVERROR(EINVAL);
+    if (!band_height)
+        band_height = 16;
+
+    c->slice_cb        = cb;
+    c->slice_cb_opaque = opaque;
+    c->slice_cb_height = FFALIGN(band_height, align);
+    c->slice_cb_inloop = 0;
+
+    /* cascaded scalers write the final output from the last context */
+    if (c->cascaded_context[1])
+        return sws_set_slice_callback(c->cascaded_context[1], cb, opaque,
+                                      band_height);
+    return 0;
+}
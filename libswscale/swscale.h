@@ -224,6 +224,39 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Callback invoked by sws_scale() for every finished band of output rows.
+ *
+ * @param opaque    the opaque pointer passed to sws_set_slice_callback()
+ * @param dst       the destination planes passed to sws_scale()
+ * @param dstStride the destination strides passed to sws_scale()
+ * @param y         the first row of the band, in destination coordinates
+ * @param h         the number of rows in the band
+ */
+typedef void (*SwsSliceCallback)(void *opaque, uint8_t *const dst[],
+                                 const int dstStride[], int y, int h);
+
+/**
+ * Install a callback that is notified about finished output rows while
+ * sws_scale() is still working on the rest of the picture, so that the
+ * caller can consume each band while it is still in the cache.
+ *
+ * Every output row is reported exactly once per frame. Bands are reported
+ * in the order they are produced, i.e. bottom to top if the slices are
+ * fed bottom to top. All bands of a frame have been reported once the
+ * sws_scale() call completing the frame returns.
+ *
+ * @param c           the scaling context, after sws_init_context()
+ * @param cb          the callback, NULL to disable it
+ * @param opaque      the opaque pointer passed to cb
+ * @param band_height the preferred number of rows per band, 0 for the
+ *                    default; it is rounded up to a multiple of the
+ *                    vertical chroma subsampling of the output
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_set_slice_callback(struct SwsContext *c, SwsSliceCallback cb,
+                           void *opaque, int band_height);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
@@ -36,6 +36,7 @@
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
+#include "swscale.h"
 
 #define STR(s) AV_TOSTRING(s) // AV_STRINGIFY is too long
 
@@ -311,6 +312,16 @@ typedef struct SwsContext {
     int cascaded_tmpStride[4];
     uint8_t *cascaded_tmp[4];
 
+    /* Band notification, see sws_set_slice_callback(). */
+    SwsSliceCallback slice_cb;
+    void *slice_cb_opaque;
+    int slice_cb_height;          ///< Number of rows per reported band, multiple of the vertical chroma subsampling.
+    int slice_cb_y;               ///< Number of rows of the current frame already reported, in scaling order.
+    int slice_cb_inloop;          ///< Whether swscale() reports bands itself during the current call.
+    int slice_cb_flip;            ///< Whether the current frame is scaled bottom to top.
+    uint8_t *slice_cb_dst[4];     ///< Destination planes passed to the current sws_scale() call.
+    int slice_cb_dstStride[4];    ///< Destination strides passed to the current sws_scale() call.
+
     uint32_t pal_yuv[256];
     uint32_t pal_rgb[256];
 
@@ -364,6 +375,11 @@ typedef struct SwsContext {
     int hChrFilterSize;           ///< Horizontal filter size for chroma     pixels.
     int vLumFilterSize;           ///< Vertical   filter size for luma/alpha pixels.
     int vChrFilterSize;           ///< Vertical   filter size for chroma     pixels.
+    /**
+     * Shared filter cache entries backing the hLum, hChr, vLum and vChr
+     * filter and position arrays above, or NULL if the context owns them.
+     */
+    struct SwsFilterCacheEntry *filter_cache[4];
     //@}
 
     int lumMmxextFilterCodeSize;  ///< Runtime-generated MMXEXT horizontal fast bilinear scaler code size for luma/alpha planes.
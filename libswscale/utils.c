@@ -26,6 +26,9 @@
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #if HAVE_SYS_MMAN_H
 #include <sys/mman.h>
 #if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
@@ -221,6 +224,8 @@ static const FormatEntry format_entries[AV_PIX_FMT_NB] = {
     [AV_PIX_FMT_BAYER_GBRG16BE] = { 1, 0 },
     [AV_PIX_FMT_BAYER_GRBG16LE] = { 1, 0 },
     [AV_PIX_FMT_BAYER_GRBG16BE] = { 1, 0 },
+    [AV_PIX_FMT_P010LE]      = { 1, 1 },
+    [AV_PIX_FMT_P010BE]      = { 1, 1 },
 };
 
 int sws_isSupportedInput(enum AVPixelFormat pix_fmt)
@@ -301,8 +306,8 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
 
     emms_c(); // FIXME should not be required but IS (even for non-MMX versions)
 
-    // NOTE: the +3 is for the MMX(+1) / SSE(+3) scaler which reads over the end
-    FF_ALLOC_ARRAY_OR_GOTO(NULL, *filterPos, (dstW + 3), sizeof(**filterPos), fail);
+    // NOTE: the +7 is for the MMX(+1) / SSE(+3) / AVX2(+7) scaler which reads over the end
+    FF_ALLOC_ARRAY_OR_GOTO(NULL, *filterPos, (dstW + 7), sizeof(**filterPos), fail);
 
     if (FFABS(xInc - 0x10000) < 10 && srcPos == dstPos) { // unscaled
         int i;
@@ -625,7 +630,7 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
     // Note the +1 is for the MMX scaler which reads over the end
     /* align at 16 for AltiVec (needed by hScale_altivec_real) */
     FF_ALLOCZ_ARRAY_OR_GOTO(NULL, *outFilter,
-                            (dstW + 3), *outFilterSize * sizeof(int16_t), fail);
+                            (dstW + 7), *outFilterSize * sizeof(int16_t), fail);
 
     /* normalize & store in outFilter */
     for (i = 0; i < dstW; i++) {
@@ -649,15 +654,13 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
         }
     }
 
-    (*filterPos)[dstW + 0] =
-    (*filterPos)[dstW + 1] =
-    (*filterPos)[dstW + 2] = (*filterPos)[dstW - 1]; /* the MMX/SSE scaler will
-                                                      * read over the end */
+    /* the MMX/SSE/AVX2 scaler will read over the end */
+    for (i = dstW; i < dstW + 7; i++)
+        (*filterPos)[i] = (*filterPos)[dstW - 1];
     for (i = 0; i < *outFilterSize; i++) {
-        int k = (dstW - 1) * (*outFilterSize) + i;
-        (*outFilter)[k + 1 * (*outFilterSize)] =
-        (*outFilter)[k + 2 * (*outFilterSize)] =
-        (*outFilter)[k + 3 * (*outFilterSize)] = (*outFilter)[k];
+        int j, k = (dstW - 1) * (*outFilterSize) + i;
+        for (j = 1; j <= 7; j++)
+            (*outFilter)[k + j * (*outFilterSize)] = (*outFilter)[k];
     }
 
     ret = 0;
@@ -670,6 +673,180 @@ fail:
     return ret;
 }
 
+/*
+ * Process-wide cache of initFilter() results. The coefficient and position
+ * arrays are never written after initFilter() returns, so contexts created
+ * with the same parameters share one refcounted copy. Entries that are no
+ * longer referenced are kept around, least recently used first out, so
+ * that contexts which are repeatedly freed and recreated still hit.
+ */
+#define FILTER_CACHE_MAX_UNUSED 32
+
+typedef struct SwsFilterCacheEntry {
+    struct SwsFilterCacheEntry *prev, *next;
+    int refcount;
+
+    int xInc, srcW, dstW, filterAlign, one, flags, cpu_flags;
+    int srcPos, dstPos;
+    double param[2];
+
+    int16_t *filter;
+    int32_t *filterPos;
+    int filterSize;
+} SwsFilterCacheEntry;
+
+static SwsFilterCacheEntry *filter_cache; ///< most recently used first
+static int filter_cache_unused;
+static unsigned filter_cache_hits, filter_cache_misses;
+
+#if HAVE_PTHREADS
+static pthread_mutex_t filter_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define FILTER_CACHE_LOCK()   pthread_mutex_lock(&filter_cache_lock)
+#define FILTER_CACHE_UNLOCK() pthread_mutex_unlock(&filter_cache_lock)
+#else
+#define FILTER_CACHE_LOCK()
+#define FILTER_CACHE_UNLOCK()
+#endif
+
+static void filter_cache_unlink(SwsFilterCacheEntry *e)
+{
+    if (e->prev)
+        e->prev->next = e->next;
+    else
+        filter_cache = e->next;
+    if (e->next)
+        e->next->prev = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void filter_cache_push(SwsFilterCacheEntry *e)
+{
+    e->next = filter_cache;
+    if (filter_cache)
+        filter_cache->prev = e;
+    filter_cache = e;
+}
+
+static void filter_cache_evict(void)
+{
+    SwsFilterCacheEntry *e = filter_cache, *last = NULL;
+
+    while (e) {
+        last = e;
+        e    = e->next;
+    }
+    for (e = last; e && filter_cache_unused > FILTER_CACHE_MAX_UNUSED; e = last) {
+        last = e->prev;
+        if (e->refcount)
+            continue;
+        filter_cache_unlink(e);
+        filter_cache_unused--;
+        av_free(e->filter);
+        av_free(e->filterPos);
+        av_free(e);
+    }
+}
+
+/**
+ * initFilter() through the filter cache. User supplied filter vectors are
+ * not part of the key, so filters using them are never cached.
+ */
+static av_cold int initFilterCached(SwsFilterCacheEntry **entry,
+                                    int16_t **outFilter, int32_t **filterPos,
+                                    int *outFilterSize, int xInc, int srcW,
+                                    int dstW, int filterAlign, int one,
+                                    int flags, int cpu_flags,
+                                    SwsVector *srcFilter, SwsVector *dstFilter,
+                                    double param[2], int srcPos, int dstPos)
+{
+    SwsFilterCacheEntry *e;
+    int ret;
+
+    if (srcFilter || dstFilter)
+        return initFilter(outFilter, filterPos, outFilterSize, xInc, srcW,
+                          dstW, filterAlign, one, flags, cpu_flags,
+                          srcFilter, dstFilter, param, srcPos, dstPos);
+
+    FILTER_CACHE_LOCK();
+    for (e = filter_cache; e; e = e->next) {
+        if (e->xInc        == xInc        && e->srcW      == srcW      &&
+            e->dstW        == dstW        && e->one       == one       &&
+            e->filterAlign == filterAlign && e->flags     == flags     &&
+            e->cpu_flags   == cpu_flags   && e->srcPos    == srcPos    &&
+            e->dstPos      == dstPos      &&
+            e->param[0]    == param[0]    && e->param[1]  == param[1])
+            break;
+    }
+    if (e) {
+        if (!e->refcount++)
+            filter_cache_unused--;
+        filter_cache_unlink(e);
+        filter_cache_push(e);
+        filter_cache_hits++;
+        FILTER_CACHE_UNLOCK();
+
+        *outFilter     = e->filter;
+        *filterPos     = e->filterPos;
+        *outFilterSize = e->filterSize;
+        *entry         = e;
+        return 0;
+    }
+    filter_cache_misses++;
+    FILTER_CACHE_UNLOCK();
+
+    ret = initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                     filterAlign, one, flags, cpu_flags, NULL, NULL,
+                     param, srcPos, dstPos);
+    if (ret < 0)
+        return ret;
+
+    /* If the entry cannot be allocated the context simply owns the arrays. */
+    if (!(e = av_mallocz(sizeof(*e))))
+        return 0;
+    e->refcount    = 1;
+    e->xInc        = xInc;
+    e->srcW        = srcW;
+    e->dstW        = dstW;
+    e->filterAlign = filterAlign;
+    e->one         = one;
+    e->flags       = flags;
+    e->cpu_flags   = cpu_flags;
+    e->srcPos      = srcPos;
+    e->dstPos      = dstPos;
+    e->param[0]    = param[0];
+    e->param[1]    = param[1];
+    e->filter      = *outFilter;
+    e->filterPos   = *filterPos;
+    e->filterSize  = *outFilterSize;
+
+    /* Another thread may have added the same filter meanwhile; the
+     * duplicate is harmless and ages out of the cache on its own. */
+    FILTER_CACHE_LOCK();
+    filter_cache_push(e);
+    FILTER_CACHE_UNLOCK();
+
+    *entry = e;
+    return 0;
+}
+
+static void releaseFilterCached(SwsFilterCacheEntry **entry,
+                                int16_t **filter, int32_t **filterPos)
+{
+    SwsFilterCacheEntry *e = *entry;
+
+    if (!e)
+        return;
+    FILTER_CACHE_LOCK();
+    if (!--e->refcount) {
+        filter_cache_unused++;
+        filter_cache_evict();
+    }
+    FILTER_CACHE_UNLOCK();
+    *entry     = NULL;
+    *filter    = NULL;
+    *filterPos = NULL;
+}
+
 static void fill_rgb2yuv_table(SwsContext *c, const int table[4], int dstRange)
 {
     int64_t W, V, Z, Cy, Cu, Cv;
@@ -1285,7 +1462,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
             const int filterAlign = X86_MMX(cpu_flags)     ? 4 :
                                     PPC_ALTIVEC(cpu_flags) ? 8 : 1;
 
-            if ((ret = initFilter(&c->hLumFilter, &c->hLumFilterPos,
+            if ((ret = initFilterCached(&c->filter_cache[0],
+                           &c->hLumFilter, &c->hLumFilterPos,
                            &c->hLumFilterSize, c->lumXInc,
                            srcW, dstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
@@ -1294,7 +1472,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                            get_local_pos(c, 0, 0, 0),
                            get_local_pos(c, 0, 0, 0))) < 0)
                 goto fail;
-            if ((ret = initFilter(&c->hChrFilter, &c->hChrFilterPos,
+            if ((ret = initFilterCached(&c->filter_cache[1],
+                           &c->hChrFilter, &c->hChrFilterPos,
                            &c->hChrFilterSize, c->chrXInc,
                            c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1311,7 +1490,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
         const int filterAlign = X86_MMX(cpu_flags)     ? 2 :
                                 PPC_ALTIVEC(cpu_flags) ? 8 : 1;
 
-        if ((ret = initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+        if ((ret = initFilterCached(&c->filter_cache[2],
+                       &c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
                        c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                        cpu_flags, srcFilter->lumV, dstFilter->lumV,
@@ -1319,7 +1499,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                        get_local_pos(c, 0, 0, 1),
                        get_local_pos(c, 0, 0, 1))) < 0)
             goto fail;
-        if ((ret = initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+        if ((ret = initFilterCached(&c->filter_cache[3],
+                       &c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
                        c->chrYInc, c->chrSrcH, c->chrDstH,
                        filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1461,6 +1642,15 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                "chr srcW=%d srcH=%d dstW=%d dstH=%d xInc=%d yInc=%d\n",
                c->chrSrcW, c->chrSrcH, c->chrDstW, c->chrDstH,
                c->chrXInc, c->chrYInc);
+        {
+            unsigned hits, misses;
+            FILTER_CACHE_LOCK();
+            hits   = filter_cache_hits;
+            misses = filter_cache_misses;
+            FILTER_CACHE_UNLOCK();
+            av_log(c, AV_LOG_DEBUG, "filter cache: %u hits, %u misses\n",
+                   hits, misses);
+        }
     }
 
     /* unscaled special cases */
@@ -1881,6 +2071,10 @@ void sws_freeContext(SwsContext *c)
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
 
+    releaseFilterCached(&c->filter_cache[0], &c->hLumFilter, &c->hLumFilterPos);
+    releaseFilterCached(&c->filter_cache[1], &c->hChrFilter, &c->hChrFilterPos);
+    releaseFilterCached(&c->filter_cache[2], &c->vLumFilter, &c->vLumFilterPos);
+    releaseFilterCached(&c->filter_cache[3], &c->vChrFilter, &c->vChrFilterPos);
     av_freep(&c->vLumFilter);
     av_freep(&c->vChrFilter);
     av_freep(&c->hLumFilter);
@@ -738,3 +738,124 @@ YUYV_TO_UV_FN 3, uyvy, 1
 NVXX_TO_UV_FN 5, nv12
 NVXX_TO_UV_FN 5, nv21
 %endif
+
+;-----------------------------------------------------------------------------
+; High bit depth planar and semi-planar input: byteswapping of the big-endian
+; planar formats and unpacking of P010.
+;
+; void <fmt>ToY_<opt>(uint8_t *dst, const uint8_t *src, const uint8_t *unused1,
+;                     const uint8_t *unused2, int w, uint32_t *unused);
+; and
+; void <fmt>ToUV_<opt>(uint8_t *dstU, uint8_t *dstV, const uint8_t *unused,
+;                      const uint8_t *src1, const uint8_t *src2, int w,
+;                      uint32_t *unused);
+;-----------------------------------------------------------------------------
+
+; swap the bytes of every word in %1, %2 is a temporary
+%macro BSWAP16_WORDS 2
+    psllw          %2, %1, 8
+    psrlw          %1, 8
+    por            %1, %2
+%endmacro
+
+; %1 = nr. of XMM registers
+; %2 = bswap16, p010LE or p010BE
+%macro HIGHBD_TO_Y_FN 2
+cglobal %2ToY, 5, 5, %1, dst, src, unused1, unused2, w
+    movsxdifnidn   wq, wd
+    lea          dstq, [dstq+wq*2]
+    lea          srcq, [srcq+wq*2]
+    neg            wq
+.loop:
+    movu           m0, [srcq+wq*2]        ; (word) { Y0, ..., Y7 }
+%ifnidn %2, p010LE
+    BSWAP16_WORDS  m0, m1
+%endif
+%ifnidn %2, bswap16
+    psrlw          m0, 6
+%endif
+    movu [dstq+wq*2], m0
+    add            wq, mmsize / 2
+    jl .loop
+    REP_RET
+%endmacro
+
+; %1 = nr. of XMM registers
+%macro BSWAP16_TO_UV_FN 1
+cglobal bswap16ToUV, 6, 6, %1, dstU, dstV, unused, src1, src2, w
+    movsxdifnidn   wq, wd
+    lea         dstUq, [dstUq+wq*2]
+    lea         dstVq, [dstVq+wq*2]
+    lea         src1q, [src1q+wq*2]
+    lea         src2q, [src2q+wq*2]
+    neg            wq
+.loop:
+    movu           m0, [src1q+wq*2]       ; (word) { U0, ..., U7 }
+    movu           m1, [src2q+wq*2]       ; (word) { V0, ..., V7 }
+    BSWAP16_WORDS  m0, m2
+    BSWAP16_WORDS  m1, m2
+    movu [dstUq+wq*2], m0
+    movu [dstVq+wq*2], m1
+    add            wq, mmsize / 2
+    jl .loop
+    REP_RET
+%endmacro
+
+; %1 = nr. of XMM registers
+; %2 = p010LE or p010BE
+%macro P010_TO_UV_FN 2
+cglobal %2ToUV, 4, 5, %1, dstU, dstV, unused, src, w
+%if ARCH_X86_64
+    movsxd         wq, dword r5m
+%else ; x86-32
+    mov            wq, r5m
+%endif
+    lea         dstUq, [dstUq+wq*2]
+    lea         dstVq, [dstVq+wq*2]
+    lea          srcq, [srcq+wq*4]
+    neg            wq
+    pcmpeqb        m4, m4                 ; (byte) { 0xff } x 16
+    psrld          m4, 16                 ; (dword) { 0x0000ffff } x 4
+.loop:
+    movu           m0, [srcq+wq*4]        ; (word) { U0, V0, ..., U3, V3 }
+    movu           m1, [srcq+wq*4+mmsize] ; (word) { U4, V4, ..., U7, V7 }
+%ifidn %2, p010BE
+    BSWAP16_WORDS  m0, m2
+    BSWAP16_WORDS  m1, m3
+%endif
+    psrlw          m0, 6
+    psrlw          m1, 6
+    pand           m2, m0, m4             ; (dword) { U0, ..., U3 }
+    pand           m3, m1, m4             ; (dword) { U4, ..., U7 }
+    psrld          m0, 16                 ; (dword) { V0, ..., V3 }
+    psrld          m1, 16                 ; (dword) { V4, ..., V7 }
+    packssdw       m2, m3                 ; (word) { U0, ..., U7 }
+    packssdw       m0, m1                 ; (word) { V0, ..., V7 }
+%if mmsize == 32
+    vpermq         m2, m2, 0xd8
+    vpermq         m0, m0, 0xd8
+%endif
+    movu [dstUq+wq*2], m2
+    movu [dstVq+wq*2], m0
+    add            wq, mmsize / 2
+    jl .loop
+    REP_RET
+%endmacro
+
+INIT_XMM sse2
+HIGHBD_TO_Y_FN   2, bswap16
+HIGHBD_TO_Y_FN   2, p010LE
+HIGHBD_TO_Y_FN   2, p010BE
+BSWAP16_TO_UV_FN 3
+P010_TO_UV_FN    5, p010LE
+P010_TO_UV_FN    5, p010BE
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+HIGHBD_TO_Y_FN   2, bswap16
+HIGHBD_TO_Y_FN   2, p010LE
+HIGHBD_TO_Y_FN   2, p010BE
+BSWAP16_TO_UV_FN 3
+P010_TO_UV_FN    5, p010LE
+P010_TO_UV_FN    5, p010BE
+%endif
@@ -22,20 +22,28 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA
-
-minshort:      times 8 dw 0x8000
-yuv2yuvX_16_start:  times 4 dd 0x4000 - 0x40000000
-yuv2yuvX_10_start:  times 4 dd 0x10000
-yuv2yuvX_9_start:   times 4 dd 0x20000
-yuv2yuvX_10_upper:  times 8 dw 0x3ff
-yuv2yuvX_9_upper:   times 8 dw 0x1ff
-pd_4:          times 4 dd 4
-pd_4min0x40000:times 4 dd 4 - (0x40000)
-pw_16:         times 8 dw 16
-pw_32:         times 8 dw 32
-pw_512:        times 8 dw 512
-pw_1024:       times 8 dw 1024
+SECTION_RODATA 32
+
+minshort:      times 16 dw 0x8000
+yuv2yuvX_16_start:  times 8 dd 0x4000 - 0x40000000
+yuv2yuvX_14_start:  times 8 dd 0x1000
+yuv2yuvX_12_start:  times 8 dd 0x4000
+yuv2yuvX_10_start:  times 8 dd 0x10000
+yuv2yuvX_9_start:   times 8 dd 0x20000
+yuv2yuvX_14_upper:  times 16 dw 0x3fff
+yuv2yuvX_12_upper:  times 16 dw 0xfff
+yuv2yuvX_10_upper:  times 16 dw 0x3ff
+yuv2yuvX_9_upper:   times 16 dw 0x1ff
+pd_4:          times 8 dd 4
+pd_4min0x40000:times 8 dd 4 - (0x40000)
+pw_1:          times 16 dw 1
+pw_4:          times 16 dw 4
+pw_16:         times 16 dw 16
+pw_32:         times 16 dw 32
+pw_512:        times 16 dw 512
+pw_1024:       times 16 dw 1024
+pw_4096:       times 16 dw 4096
+pw_16384:      times 16 dw 16384
 
 SECTION .text
 
@@ -50,9 +58,12 @@ SECTION .text
 ;                                     const uint8_t *dither, int offset)
 ;
 ; Scale one or $filterSize lines of source data to generate one line of output
-; data. The input is 15-bit in int16_t if $output_size is [8,10] and 19-bit in
+; data. The input is 15-bit in int16_t if $output_size is [8,14] and 19-bit in
 ; int32_t if $output_size is 16. $filter is 12-bits. $filterSize is a multiple
 ; of 2. $offset is either 0 or 3. $dither holds 8 values.
+;
+; The AVX2 versions load the source lines unaligned, since the chroma lines of
+; the intermediate buffer are only 16-byte aligned, and store unaligned.
 ;-----------------------------------------------------------------------------
 
 %macro yuv2planeX_fn 3
@@ -65,10 +76,18 @@ SECTION .text
 %define movsx movsxd
 %endif
 
+%if mmsize == 32
+%define movsrc movu
+%define movdst movu
+%else
+%define movsrc mova
+%define movdst mova
+%endif
+
 cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
-%if %1 == 8 || %1 == 9 || %1 == 10
+%if %1 != 16
     pxor            m6,  m6
-%endif ; %1 == 8/9/10
+%endif ; %1 == 8/9/10/12/14
 
 %if %1 == 8
 %if ARCH_X86_32
@@ -145,35 +164,45 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
     mova            m2,  m8
     mova            m1,  m_dith
 %endif ; x86-32/64
-%else ; %1 == 9/10/16
+%else ; %1 == 9/10/12/14/16
     mova            m1, [yuv2yuvX_%1_start]
     mova            m2,  m1
-%endif ; %1 == 8/9/10/16
+%endif ; %1 == 8/9/10/12/14/16
     movsx     cntr_reg,  fltsizem
 .filterloop_ %+ %%i:
     ; input pixels
     mov             r6, [srcq+gprsize*cntr_reg-2*gprsize]
 %if %1 == 16
-    mova            m3, [r6+r5*4]
-    mova            m5, [r6+r5*4+mmsize]
-%else ; %1 == 8/9/10
-    mova            m3, [r6+r5*2]
-%endif ; %1 == 8/9/10/16
+    movsrc          m3, [r6+r5*4]
+    movsrc          m5, [r6+r5*4+mmsize]
+%else ; %1 == 8/9/10/12/14
+    movsrc          m3, [r6+r5*2]
+%endif ; %1 == 8/9/10/12/14/16
     mov             r6, [srcq+gprsize*cntr_reg-gprsize]
 %if %1 == 16
-    mova            m4, [r6+r5*4]
-    mova            m6, [r6+r5*4+mmsize]
-%else ; %1 == 8/9/10
-    mova            m4, [r6+r5*2]
-%endif ; %1 == 8/9/10/16
+    movsrc          m4, [r6+r5*4]
+    movsrc          m6, [r6+r5*4+mmsize]
+%else ; %1 == 8/9/10/12/14
+    movsrc          m4, [r6+r5*2]
+%endif ; %1 == 8/9/10/12/14/16
 
     ; coefficients
+%if mmsize == 32
+    vpbroadcastd    m0, [filterq+2*cntr_reg-4] ; coeff[0], coeff[1]
+%else
     movd            m0, [filterq+2*cntr_reg-4] ; coeff[0], coeff[1]
+%endif
 %if %1 == 16
+%if mmsize == 32
+    pslld           m7,  m0,  16
+    psrad           m7,  16              ; coeff[0]
+    psrad           m0,  16              ; coeff[1]
+%else
     pshuflw         m7,  m0,  0          ; coeff[0]
     pshuflw         m0,  m0,  0x55       ; coeff[1]
     pmovsxwd        m7,  m7              ; word -> dword
     pmovsxwd        m0,  m0              ; word -> dword
+%endif ; mmsize == 32
 
     pmulld          m3,  m7
     pmulld          m5,  m7
@@ -184,10 +213,12 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
     paddd           m1,  m5
     paddd           m2,  m4
     paddd           m1,  m6
-%else ; %1 == 10/9/8
+%else ; %1 == 14/12/10/9/8
     punpcklwd       m5,  m3,  m4
     punpckhwd       m3,  m4
+%if mmsize != 32
     SPLATD          m0
+%endif
 
     pmaddwd         m5,  m0
     pmaddwd         m3,  m0
@@ -202,30 +233,33 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
 %if %1 == 16
     psrad           m2,  31 - %1
     psrad           m1,  31 - %1
-%else ; %1 == 10/9/8
+%else ; %1 == 14/12/10/9/8
     psrad           m2,  27 - %1
     psrad           m1,  27 - %1
-%endif ; %1 == 8/9/10/16
+%endif ; %1 == 8/9/10/12/14/16
 
 %if %1 == 8
     packssdw        m2,  m1
     packuswb        m2,  m2
     movh   [dstq+r5*1],  m2
-%else ; %1 == 9/10/16
+%else ; %1 == 9/10/12/14/16
 %if %1 == 16
     packssdw        m2,  m1
+%if mmsize == 32
+    vpermq          m2,  m2,  0xd8
+%endif
     paddw           m2, [minshort]
-%else ; %1 == 9/10
+%else ; %1 == 9/10/12/14
 %if cpuflag(sse4)
     packusdw        m2,  m1
 %else ; mmxext/sse2
     packssdw        m2,  m1
     pmaxsw          m2,  m6
-%endif ; mmxext/sse2/sse4/avx
+%endif ; mmxext/sse2/sse4/avx/avx2
     pminsw          m2, [yuv2yuvX_%1_upper]
-%endif ; %1 == 9/10/16
-    mova   [dstq+r5*2],  m2
-%endif ; %1 == 8/9/10/16
+%endif ; %1 == 9/10/12/14/16
+    movdst [dstq+r5*2],  m2
+%endif ; %1 == 8/9/10/12/14/16
 
     add             r5,  mmsize/2
     sub             wd,  mmsize/2
@@ -241,9 +275,9 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
 %else ; x86-64
     REP_RET
 %endif ; x86-32/64
-%else ; %1 == 9/10/16
+%else ; %1 == 9/10/12/14/16
     REP_RET
-%endif ; %1 == 8/9/10/16
+%endif ; %1 == 8/9/10/12/14/16
 %endmacro
 
 %if ARCH_X86_32
@@ -251,17 +285,23 @@ INIT_MMX mmxext
 yuv2planeX_fn  8,  0, 7
 yuv2planeX_fn  9,  0, 5
 yuv2planeX_fn 10,  0, 5
+yuv2planeX_fn 12,  0, 5
+yuv2planeX_fn 14,  0, 5
 %endif
 
 INIT_XMM sse2
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 12,  7, 5
+yuv2planeX_fn 14,  7, 5
 
 INIT_XMM sse4
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 12,  7, 5
+yuv2planeX_fn 14,  7, 5
 yuv2planeX_fn 16,  8, 5
 
 %if HAVE_AVX_EXTERNAL
@@ -269,6 +309,17 @@ INIT_XMM avx
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 12,  7, 5
+yuv2planeX_fn 14,  7, 5
+%endif
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+yuv2planeX_fn  9,  7, 5
+yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 12,  7, 5
+yuv2planeX_fn 14,  7, 5
+yuv2planeX_fn 16,  8, 5
 %endif
 
 ; %1=outout-bpc, %2=alignment (u/a)
@@ -290,7 +341,7 @@ yuv2planeX_fn 10,  7, 5
     psrad           m1, 3
     psrad           m2, 3
     psrad           m3, 3
-%if cpuflag(sse4) ; avx/sse4
+%if cpuflag(sse4) ; avx2/avx/sse4
     packusdw        m0, m1
     packusdw        m2, m3
 %else ; mmx/sse2
@@ -298,10 +349,14 @@ yuv2planeX_fn 10,  7, 5
     packssdw        m2, m3
     paddw           m0, m5
     paddw           m2, m5
-%endif ; mmx/sse2/sse4/avx
+%endif ; mmx/sse2/sse4/avx/avx2
+%if mmsize == 32
+    vpermq          m0, m0, 0xd8
+    vpermq          m2, m2, 0xd8
+%endif
     mov%2    [dstq+wq*2+mmsize*0], m0
     mov%2    [dstq+wq*2+mmsize*1], m2
-%else ; %1 == 9/10
+%else ; %1 == 9/10/12/14
     paddsw          m0, m2, [srcq+wq*2+mmsize*0]
     paddsw          m1, m2, [srcq+wq*2+mmsize*1]
     psraw           m0, 15 - %1
@@ -362,8 +417,16 @@ cglobal yuv2plane1_%1, %3, %3, %2, src, dst, w, dither, offset
     pxor            m4, m4
     mova            m3, [pw_1024]
     mova            m2, [pw_16]
+%elif %1 == 12
+    pxor            m4, m4
+    mova            m3, [pw_4096]
+    mova            m2, [pw_4]
+%elif %1 == 14
+    pxor            m4, m4
+    mova            m3, [pw_16384]
+    mova            m2, [pw_1]
 %else ; %1 == 16
-%if cpuflag(sse4) ; sse4/avx
+%if cpuflag(sse4) ; sse4/avx/avx2
     mova            m4, [pd_4]
 %else ; mmx/sse2
     mova            m4, [pd_4min0x40000]
@@ -374,14 +437,14 @@ cglobal yuv2plane1_%1, %3, %3, %2, src, dst, w, dither, offset
     ; actual pixel scaling
 %if mmsize == 8
     yuv2plane1_mainloop %1, a
-%else ; mmsize == 16
-    test          dstq, 15
+%else ; mmsize == 16/32
+    test          dstq, mmsize - 1
     jnz .unaligned
     yuv2plane1_mainloop %1, a
     REP_RET
 .unaligned:
     yuv2plane1_mainloop %1, u
-%endif ; mmsize == 8/16
+%endif ; mmsize == 8/16/32
     REP_RET
 %endmacro
 
@@ -393,12 +456,16 @@ yuv2plane1_fn 16, 0, 3
 INIT_MMX mmxext
 yuv2plane1_fn  9, 0, 3
 yuv2plane1_fn 10, 0, 3
+yuv2plane1_fn 12, 0, 3
+yuv2plane1_fn 14, 0, 3
 %endif
 
 INIT_XMM sse2
 yuv2plane1_fn  8, 5, 5
 yuv2plane1_fn  9, 5, 3
 yuv2plane1_fn 10, 5, 3
+yuv2plane1_fn 12, 5, 3
+yuv2plane1_fn 14, 5, 3
 yuv2plane1_fn 16, 6, 3
 
 INIT_XMM sse4
@@ -409,5 +476,16 @@ INIT_XMM avx
 yuv2plane1_fn  8, 5, 5
 yuv2plane1_fn  9, 5, 3
 yuv2plane1_fn 10, 5, 3
+yuv2plane1_fn 12, 5, 3
+yuv2plane1_fn 14, 5, 3
+yuv2plane1_fn 16, 5, 3
+%endif
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+yuv2plane1_fn  9, 5, 3
+yuv2plane1_fn 10, 5, 3
+yuv2plane1_fn 12, 5, 3
+yuv2plane1_fn 14, 5, 3
 yuv2plane1_fn 16, 5, 3
 %endif
@@ -145,11 +145,140 @@ DECLARE_ALIGNED(8, extern const uint64_t, ff_bgr2UVOffset);
 
 #endif /* HAVE_INLINE_ASM */
 
+#if HAVE_YASM
+void ff_interleave_bytes_avx2(uint8_t *dst, const uint8_t *src1,
+                              const uint8_t *src2, int w);
+void ff_deinterleave_bytes_avx2(uint8_t *dst1, uint8_t *dst2,
+                                const uint8_t *src, int w);
+
+static void interleaveBytes_avx2(const uint8_t *src1, const uint8_t *src2,
+                                 uint8_t *dst, int width, int height,
+                                 int src1Stride, int src2Stride, int dstStride)
+{
+    int simd_width = width & ~31;
+    int h, w;
+
+    for (h = 0; h < height; h++) {
+        if (simd_width)
+            ff_interleave_bytes_avx2(dst, src1, src2, simd_width);
+        for (w = simd_width; w < width; w++) {
+            dst[2 * w + 0] = src1[w];
+            dst[2 * w + 1] = src2[w];
+        }
+        dst  += dstStride;
+        src1 += src1Stride;
+        src2 += src2Stride;
+    }
+}
+
+static void deinterleaveBytes_avx2(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                                   int width, int height, int srcStride,
+                                   int dst1Stride, int dst2Stride)
+{
+    int simd_width = width & ~31;
+    int h, w;
+
+    for (h = 0; h < height; h++) {
+        if (simd_width)
+            ff_deinterleave_bytes_avx2(dst1, dst2, src, simd_width);
+        for (w = simd_width; w < width; w++) {
+            dst1[w] = src[2 * w + 0];
+            dst2[w] = src[2 * w + 1];
+        }
+        src  += srcStride;
+        dst1 += dst1Stride;
+        dst2 += dst2Stride;
+    }
+}
+
+#define WORDS_FUNCS(opt, step)                                                  \
+void ff_interleave_words_ ## opt(uint16_t *dst, const uint16_t *src1,          \
+                                 const uint16_t *src2, int w, int shift);      \
+void ff_deinterleave_words_ ## opt(uint16_t *dst1, uint16_t *dst2,             \
+                                   const uint16_t *src, int w, int shift);     \
+void ff_shift_words_ ## opt(uint16_t *dst, const uint16_t *src, int w,         \
+                            int lshift, int rshift);                           \
+                                                                               \
+static void interleaveWords_ ## opt(const uint8_t *src1, const uint8_t *src2,  \
+                                    uint8_t *dest, int width, int height,      \
+                                    int src1Stride, int src2Stride,            \
+                                    int dstStride, int shift)                  \
+{                                                                              \
+    int simd_width = width & ~(step - 1);                                      \
+    int h, w;                                                                  \
+                                                                               \
+    for (h = 0; h < height; h++) {                                             \
+        const uint16_t *s1 = (const uint16_t *)src1;                           \
+        const uint16_t *s2 = (const uint16_t *)src2;                           \
+        uint16_t *d        = (uint16_t *)dest;                                 \
+        if (simd_width)                                                        \
+            ff_interleave_words_ ## opt(d, s1, s2, simd_width, shift);         \
+        for (w = simd_width; w < width; w++) {                                 \
+            d[2 * w + 0] = s1[w] << shift;                                     \
+            d[2 * w + 1] = s2[w] << shift;                                     \
+        }                                                                      \
+        dest += dstStride;                                                     \
+        src1 += src1Stride;                                                    \
+        src2 += src2Stride;                                                    \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static void deinterleaveWords_ ## opt(const uint8_t *src, uint8_t *dst1,       \
+                                      uint8_t *dst2, int width, int height,    \
+                                      int srcStride, int dst1Stride,           \
+                                      int dst2Stride, int shift)               \
+{                                                                              \
+    int simd_width = width & ~(step - 1);                                      \
+    int h, w;                                                                  \
+                                                                               \
+    for (h = 0; h < height; h++) {                                             \
+        const uint16_t *s = (const uint16_t *)src;                             \
+        uint16_t *d1      = (uint16_t *)dst1;                                  \
+        uint16_t *d2      = (uint16_t *)dst2;                                  \
+        if (simd_width)                                                        \
+            ff_deinterleave_words_ ## opt(d1, d2, s, simd_width, shift);       \
+        for (w = simd_width; w < width; w++) {                                 \
+            d1[w] = s[2 * w + 0] >> shift;                                     \
+            d2[w] = s[2 * w + 1] >> shift;                                     \
+        }                                                                      \
+        src  += srcStride;                                                     \
+        dst1 += dst1Stride;                                                    \
+        dst2 += dst2Stride;                                                    \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static void shiftWords_ ## opt(const uint8_t *src, uint8_t *dst,               \
+                               int width, int height,                          \
+                               int srcStride, int dstStride, int shift)        \
+{                                                                              \
+    int simd_width = width & ~(2 * step - 1);                                  \
+    int lshift     = FFMAX(shift, 0);                                          \
+    int rshift     = FFMAX(-shift, 0);                                         \
+    int h, w;                                                                  \
+                                                                               \
+    for (h = 0; h < height; h++) {                                             \
+        const uint16_t *s = (const uint16_t *)src;                             \
+        uint16_t *d       = (uint16_t *)dst;                                   \
+        if (simd_width)                                                        \
+            ff_shift_words_ ## opt(d, s, simd_width, lshift, rshift);          \
+        for (w = simd_width; w < width; w++)                                   \
+            d[w] = (uint16_t)(s[w] << lshift) >> rshift;                       \
+        src += srcStride;                                                      \
+        dst += dstStride;                                                      \
+    }                                                                          \
+}
+
+WORDS_FUNCS(sse2, 8)
+WORDS_FUNCS(avx2, 16)
+#endif /* HAVE_YASM */
+
 av_cold void rgb2rgb_init_x86(void)
 {
-#if HAVE_INLINE_ASM
+#if HAVE_INLINE_ASM || HAVE_YASM
     int cpu_flags = av_get_cpu_flags();
+#endif
 
+#if HAVE_INLINE_ASM
     if (INLINE_MMX(cpu_flags))
         rgb2rgb_init_mmx();
     if (INLINE_AMD3DNOW(cpu_flags))
@@ -161,4 +290,19 @@ av_cold void rgb2rgb_init_x86(void)
     if (INLINE_AVX(cpu_flags))
         rgb2rgb_init_avx();
 #endif /* HAVE_INLINE_ASM */
+
+#if HAVE_YASM
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        interleaveWords   = interleaveWords_sse2;
+        deinterleaveWords = deinterleaveWords_sse2;
+        shiftWords        = shiftWords_sse2;
+    }
+    if (EXTERNAL_AVX2(cpu_flags)) {
+        interleaveBytes   = interleaveBytes_avx2;
+        deinterleaveBytes = deinterleaveBytes_avx2;
+        interleaveWords   = interleaveWords_avx2;
+        deinterleaveWords = deinterleaveWords_avx2;
+        shiftWords        = shiftWords_avx2;
+    }
+#endif /* HAVE_YASM */
 }
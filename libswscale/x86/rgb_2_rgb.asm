@@ -0,0 +1,192 @@
+;******************************************************************************
+;* x86-optimized plane (de)interleaving for semi-planar YUV formats
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+; All functions below work on a single line; w is in samples per plane
+; and must be a multiple of mmsize (bytes) or mmsize / 2 (words), the
+; caller takes care of the remainder.
+
+; The AVX2 unpack and pack instructions operate on 128-bit lanes, so the
+; qwords are reordered (0, 2, 1, 3) before unpacking and after packing.
+%macro LANE_FIXUP 1-2
+%if cpuflag(avx2)
+    vpermq      m%1, m%1, 0xd8
+%if %0 > 1
+    vpermq      m%2, m%2, 0xd8
+%endif
+%endif
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_interleave_bytes(uint8_t *dst, const uint8_t *src1,
+;                          const uint8_t *src2, int w);
+;------------------------------------------------------------------------------
+%macro INTERLEAVE_BYTES 0
+cglobal interleave_bytes, 4, 4, 3, dst, src1, src2, w
+    movsxdifnidn wq, wd
+    add      src1q, wq
+    add      src2q, wq
+    lea       dstq, [dstq+wq*2]
+    neg         wq
+.loop:
+    movu         m0, [src1q+wq]
+    movu         m1, [src2q+wq]
+    LANE_FIXUP    0, 1
+    SBUTTERFLY   bw, 0, 1, 2
+    movu   [dstq+wq*2], m0
+    movu   [dstq+wq*2+mmsize], m1
+    add          wq, mmsize
+    jl .loop
+    RET
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_deinterleave_bytes(uint8_t *dst1, uint8_t *dst2,
+;                            const uint8_t *src, int w);
+;------------------------------------------------------------------------------
+%macro DEINTERLEAVE_BYTES 0
+cglobal deinterleave_bytes, 4, 4, 5, dst1, dst2, src, w
+    movsxdifnidn wq, wd
+    add      dst1q, wq
+    add      dst2q, wq
+    lea       srcq, [srcq+wq*2]
+    neg         wq
+    pcmpeqw      m4, m4
+    psrlw        m4, 8
+.loop:
+    movu         m0, [srcq+wq*2]
+    movu         m1, [srcq+wq*2+mmsize]
+    psrlw        m2, m0, 8
+    psrlw        m3, m1, 8
+    pand         m0, m4
+    pand         m1, m4
+    packuswb     m0, m1
+    packuswb     m2, m3
+    LANE_FIXUP    0, 2
+    movu  [dst1q+wq], m0
+    movu  [dst2q+wq], m2
+    add          wq, mmsize
+    jl .loop
+    RET
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_interleave_words(uint16_t *dst, const uint16_t *src1,
+;                          const uint16_t *src2, int w, int shift);
+;------------------------------------------------------------------------------
+%macro INTERLEAVE_WORDS 0
+cglobal interleave_words, 5, 5, 4, dst, src1, src2, w, shift
+    movd        xm3, shiftd
+    movsxdifnidn wq, wd
+    lea      src1q, [src1q+wq*2]
+    lea      src2q, [src2q+wq*2]
+    lea       dstq, [dstq+wq*4]
+    neg         wq
+.loop:
+    movu         m0, [src1q+wq*2]
+    movu         m1, [src2q+wq*2]
+    psllw        m0, xm3
+    psllw        m1, xm3
+    LANE_FIXUP    0, 1
+    SBUTTERFLY   wd, 0, 1, 2
+    movu   [dstq+wq*4], m0
+    movu   [dstq+wq*4+mmsize], m1
+    add          wq, mmsize / 2
+    jl .loop
+    RET
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_deinterleave_words(uint16_t *dst1, uint16_t *dst2,
+;                            const uint16_t *src, int w, int shift);
+;------------------------------------------------------------------------------
+%macro DEINTERLEAVE_WORDS 0
+cglobal deinterleave_words, 5, 5, 5, dst1, dst2, src, w, shift
+    movd        xm4, shiftd
+    movsxdifnidn wq, wd
+    lea      dst1q, [dst1q+wq*2]
+    lea      dst2q, [dst2q+wq*2]
+    lea       srcq, [srcq+wq*4]
+    neg         wq
+.loop:
+    movu         m0, [srcq+wq*4]
+    movu         m1, [srcq+wq*4+mmsize]
+    ; sign-extend both halves of every dword so that the signed pack
+    ; reproduces the original 16-bit values exactly
+    pslld        m2, m0, 16
+    pslld        m3, m1, 16
+    psrad        m0, 16
+    psrad        m1, 16
+    psrad        m2, 16
+    psrad        m3, 16
+    packssdw     m2, m3
+    packssdw     m0, m1
+    LANE_FIXUP    2, 0
+    psrlw        m2, xm4
+    psrlw        m0, xm4
+    movu  [dst1q+wq*2], m2
+    movu  [dst2q+wq*2], m0
+    add          wq, mmsize / 2
+    jl .loop
+    RET
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_shift_words(uint16_t *dst, const uint16_t *src, int w,
+;                     int lshift, int rshift);
+;------------------------------------------------------------------------------
+%macro SHIFT_WORDS 0
+cglobal shift_words, 5, 5, 4, dst, src, w, lshift, rshift
+    movd        xm2, lshiftd
+    movd        xm3, rshiftd
+    movsxdifnidn wq, wd
+    lea       srcq, [srcq+wq*2]
+    lea       dstq, [dstq+wq*2]
+    neg         wq
+.loop:
+    movu         m0, [srcq+wq*2]
+    movu         m1, [srcq+wq*2+mmsize]
+    psllw        m0, xm2
+    psllw        m1, xm2
+    psrlw        m0, xm3
+    psrlw        m1, xm3
+    movu   [dstq+wq*2], m0
+    movu   [dstq+wq*2+mmsize], m1
+    add          wq, mmsize
+    jl .loop
+    RET
+%endmacro
+
+INIT_XMM sse2
+INTERLEAVE_WORDS
+DEINTERLEAVE_WORDS
+SHIFT_WORDS
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+INTERLEAVE_BYTES
+DEINTERLEAVE_BYTES
+INTERLEAVE_WORDS
+DEINTERLEAVE_WORDS
+SHIFT_WORDS
+%endif
@@ -27,6 +27,7 @@ max_19bit_int: times 4 dd 0x7ffff
 max_19bit_flt: times 4 dd 524287.0
 minshort:      times 8 dw 0x8000
 unicoeff:      times 4 dd 0x20000000
+hscale_perm:   dd 0, 4, 1, 5, 2, 6, 3, 7
 
 SECTION .text
 
@@ -419,6 +420,142 @@ SCALE_FUNCS 14, 19, %2
 SCALE_FUNCS 16, 19, %3
 %endmacro
 
+;-----------------------------------------------------------------------------
+; AVX2 horizontal line scaling of 9-16 bit sources with 4 or 8 taps.
+;
+; 8 output pixels are generated per iteration. The source pixels of two
+; consecutive output pixels share a 128-bit lane, which keeps the filter
+; coefficients in their natural order, and the dword sums are put back in
+; pixel order with a single permute. The caller pads filter and filterPos
+; up to a multiple of 8 output pixels.
+;-----------------------------------------------------------------------------
+
+; SCALE_FUNC_AVX2 source_width, intermediate_nbits, filtersize
+%macro SCALE_FUNC_AVX2 3
+cglobal hscale%1to%2_%3, 6, 7, 8, pos0, dst, w, src, filter, fltpos, pos1
+%if ARCH_X86_64
+    movsxd        wq, wd
+%define mov32 movsxd
+%else ; x86-32
+%define mov32 mov
+%endif ; x86-64
+%if %2 == 19
+    vpbroadcastd  m2, [max_19bit_int]
+%endif ; %2 == 19
+%if %3 == 8
+    movu          m3, [hscale_perm]
+%endif ; %3 == 8
+%if %1 == 16
+    vpbroadcastd  m6, [minshort]
+    vpbroadcastd  m7, [unicoeff]
+%endif ; %1 == 16
+
+    ; setup loop
+%if %3 == 8
+    shl           wq, 1                         ; see SCALE_FUNC
+%define wshr 1
+%else ; %3 == 4
+%define wshr 0
+%endif ; %3 == 8
+    lea      filterq, [filterq+wq*8]
+%if %2 == 15
+    lea         dstq, [dstq+wq*(2>>wshr)]
+%else ; %2 == 19
+    lea         dstq, [dstq+wq*(4>>wshr)]
+%endif ; %2 == 15/19
+    lea      fltposq, [fltposq+wq*(4>>wshr)]
+    neg           wq
+
+.loop:
+%if %3 == 4
+    ; load 8x4 source pixels, two output pixels per lane
+    mov32      pos0q, dword [fltposq+wq*4+ 0]
+    mov32      pos1q, dword [fltposq+wq*4+ 4]
+    movq         xm0, [srcq+pos0q*2]
+    movhps       xm0, [srcq+pos1q*2]
+    mov32      pos0q, dword [fltposq+wq*4+ 8]
+    mov32      pos1q, dword [fltposq+wq*4+12]
+    movq         xm4, [srcq+pos0q*2]
+    movhps       xm4, [srcq+pos1q*2]
+    mov32      pos0q, dword [fltposq+wq*4+16]
+    mov32      pos1q, dword [fltposq+wq*4+20]
+    movq         xm1, [srcq+pos0q*2]
+    movhps       xm1, [srcq+pos1q*2]
+    mov32      pos0q, dword [fltposq+wq*4+24]
+    mov32      pos1q, dword [fltposq+wq*4+28]
+    movq         xm5, [srcq+pos0q*2]
+    movhps       xm5, [srcq+pos1q*2]
+    vinserti128   m0, m0, xm4, 1                ; src for dstpix {0,1 | 2,3}
+    vinserti128   m1, m1, xm5, 1                ; src for dstpix {4,5 | 6,7}
+%if %1 == 16
+    psubw         m0, m6
+    psubw         m1, m6
+%endif ; %1 == 16
+    pmaddwd       m0, [filterq+wq*8+mmsize*0]
+    pmaddwd       m1, [filterq+wq*8+mmsize*1]
+    phaddd        m0, m1                        ; dstpix {0,1,4,5 | 2,3,6,7}
+    vpermq        m0, m0, 0xd8
+%else ; %3 == 8
+    ; load 8x8 source pixels, two output pixels per lane
+    mov32      pos0q, dword [fltposq+wq*2+ 0]
+    mov32      pos1q, dword [fltposq+wq*2+ 4]
+    movu         xm0, [srcq+pos0q*2]
+    vinserti128   m0, m0, [srcq+pos1q*2], 1
+    mov32      pos0q, dword [fltposq+wq*2+ 8]
+    mov32      pos1q, dword [fltposq+wq*2+12]
+    movu         xm1, [srcq+pos0q*2]
+    vinserti128   m1, m1, [srcq+pos1q*2], 1
+    mov32      pos0q, dword [fltposq+wq*2+16]
+    mov32      pos1q, dword [fltposq+wq*2+20]
+    movu         xm4, [srcq+pos0q*2]
+    vinserti128   m4, m4, [srcq+pos1q*2], 1
+    mov32      pos0q, dword [fltposq+wq*2+24]
+    mov32      pos1q, dword [fltposq+wq*2+28]
+    movu         xm5, [srcq+pos0q*2]
+    vinserti128   m5, m5, [srcq+pos1q*2], 1
+%if %1 == 16
+    psubw         m0, m6
+    psubw         m1, m6
+    psubw         m4, m6
+    psubw         m5, m6
+%endif ; %1 == 16
+    pmaddwd       m0, [filterq+wq*8+mmsize*0]
+    pmaddwd       m1, [filterq+wq*8+mmsize*1]
+    pmaddwd       m4, [filterq+wq*8+mmsize*2]
+    pmaddwd       m5, [filterq+wq*8+mmsize*3]
+    phaddd        m0, m1
+    phaddd        m4, m5
+    phaddd        m0, m4                        ; dstpix {0,2,4,6 | 1,3,5,7}
+    vpermd        m0, m3, m0
+%endif ; %3 == 4/8
+
+%if %1 == 16 ; add 0x8000 * sum(coeffs), i.e. back from signed -> unsigned
+    paddd         m0, m7
+%endif ; %1 == 16
+
+    ; clip, store
+    psrad         m0, 14 + %1 - %2
+%if %2 == 15
+    packssdw      m0, m0
+    vpermq        m0, m0, 0x08
+    movu [dstq+wq*(2>>wshr)], xm0
+%else ; %2 == 19
+    pminsd        m0, m2
+    movu [dstq+wq*(4>>wshr)], m0
+%endif ; %2 == 15/19
+    add           wq, 8<<wshr
+    jl .loop
+    REP_RET
+%endmacro
+
+; SCALE_FUNCS_AVX2 source_width
+%macro SCALE_FUNCS_AVX2 1
+SCALE_FUNC_AVX2 %1, 15, 4
+SCALE_FUNC_AVX2 %1, 15, 8
+SCALE_FUNC_AVX2 %1, 19, 4
+SCALE_FUNC_AVX2 %1, 19, 8
+%endmacro
+
 %if ARCH_X86_32
 INIT_MMX mmx
 SCALE_FUNCS2 0, 0, 0
@@ -429,3 +566,12 @@ INIT_XMM ssse3
 SCALE_FUNCS2 6, 6, 8
 INIT_XMM sse4
 SCALE_FUNCS2 6, 6, 8
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+SCALE_FUNCS_AVX2  9
+SCALE_FUNCS_AVX2 10
+SCALE_FUNCS_AVX2 12
+SCALE_FUNCS_AVX2 14
+SCALE_FUNCS_AVX2 16
+%endif
@@ -315,6 +315,21 @@ SCALE_FUNCS_SSE(sse2);
 SCALE_FUNCS_SSE(ssse3);
 SCALE_FUNCS_SSE(sse4);
 
+#define SCALE_FUNCS_HIGHBD(filter_n, opt) \
+    SCALE_FUNC(filter_n,  9, 15, opt); \
+    SCALE_FUNC(filter_n, 10, 15, opt); \
+    SCALE_FUNC(filter_n, 12, 15, opt); \
+    SCALE_FUNC(filter_n, 14, 15, opt); \
+    SCALE_FUNC(filter_n, 16, 15, opt); \
+    SCALE_FUNC(filter_n,  9, 19, opt); \
+    SCALE_FUNC(filter_n, 10, 19, opt); \
+    SCALE_FUNC(filter_n, 12, 19, opt); \
+    SCALE_FUNC(filter_n, 14, 19, opt); \
+    SCALE_FUNC(filter_n, 16, 19, opt)
+
+SCALE_FUNCS_HIGHBD(4, avx2);
+SCALE_FUNCS_HIGHBD(8, avx2);
+
 #define VSCALEX_FUNC(size, opt) \
 void ff_yuv2planeX_ ## size ## _ ## opt(const int16_t *filter, int filterSize, \
                                         const int16_t **src, uint8_t *dest, int dstW, \
@@ -322,7 +337,9 @@ void ff_yuv2planeX_ ## size ## _ ## opt(const int16_t *filter, int filterSize, \
 #define VSCALEX_FUNCS(opt) \
     VSCALEX_FUNC(8,  opt); \
     VSCALEX_FUNC(9,  opt); \
-    VSCALEX_FUNC(10, opt)
+    VSCALEX_FUNC(10, opt); \
+    VSCALEX_FUNC(12, opt); \
+    VSCALEX_FUNC(14, opt)
 
 #if ARCH_X86_32
 VSCALEX_FUNCS(mmxext);
@@ -331,6 +348,11 @@ VSCALEX_FUNCS(sse2);
 VSCALEX_FUNCS(sse4);
 VSCALEX_FUNC(16, sse4);
 VSCALEX_FUNCS(avx);
+VSCALEX_FUNC(9,  avx2);
+VSCALEX_FUNC(10, avx2);
+VSCALEX_FUNC(12, avx2);
+VSCALEX_FUNC(14, avx2);
+VSCALEX_FUNC(16, avx2);
 
 #define VSCALE_FUNC(size, opt) \
 void ff_yuv2plane1_ ## size ## _ ## opt(const int16_t *src, uint8_t *dst, int dstW, \
@@ -339,6 +361,8 @@ void ff_yuv2plane1_ ## size ## _ ## opt(const int16_t *src, uint8_t *dst, int ds
     VSCALE_FUNC(8,  opt1); \
     VSCALE_FUNC(9,  opt2); \
     VSCALE_FUNC(10, opt2); \
+    VSCALE_FUNC(12, opt2); \
+    VSCALE_FUNC(14, opt2); \
     VSCALE_FUNC(16, opt1)
 
 #if ARCH_X86_32
@@ -347,6 +371,11 @@ VSCALE_FUNCS(mmx, mmxext);
 VSCALE_FUNCS(sse2, sse2);
 VSCALE_FUNC(16, sse4);
 VSCALE_FUNCS(avx, avx);
+VSCALE_FUNC(9,  avx2);
+VSCALE_FUNC(10, avx2);
+VSCALE_FUNC(12, avx2);
+VSCALE_FUNC(14, avx2);
+VSCALE_FUNC(16, avx2);
 
 #define INPUT_Y_FUNC(fmt, opt) \
 void ff_ ## fmt ## ToY_  ## opt(uint8_t *dst, const uint8_t *src, \
@@ -380,6 +409,14 @@ INPUT_FUNCS(sse2);
 INPUT_FUNCS(ssse3);
 INPUT_FUNCS(avx);
 
+#define INPUT_FUNCS_HIGHBD(opt) \
+    INPUT_FUNC(bswap16, opt); \
+    INPUT_FUNC(p010LE, opt); \
+    INPUT_FUNC(p010BE, opt)
+
+INPUT_FUNCS_HIGHBD(sse2);
+INPUT_FUNCS_HIGHBD(avx2);
+
 av_cold void ff_sws_init_swscale_x86(SwsContext *c)
 {
     int cpu_flags = av_get_cpu_flags();
@@ -401,7 +438,11 @@ av_cold void ff_sws_init_swscale_x86(SwsContext *c)
     if (c->srcBpc == 8) { \
         hscalefn = c->dstBpc <= 14 ? ff_hscale8to15_ ## filtersize ## _ ## opt2 : \
                                      ff_hscale8to19_ ## filtersize ## _ ## opt1; \
-    } else if (c->srcBpc == 9) { \
+    } else \
+        ASSIGN_SCALE_FUNC_HIGHBD(hscalefn, filtersize, opt1, opt2); \
+} while (0)
+#define ASSIGN_SCALE_FUNC_HIGHBD(hscalefn, filtersize, opt1, opt2) do { \
+    if (c->srcBpc == 9) { \
         hscalefn = c->dstBpc <= 14 ? ff_hscale9to15_ ## filtersize ## _ ## opt2 : \
                                      ff_hscale9to19_ ## filtersize ## _ ## opt1; \
     } else if (c->srcBpc == 10) { \
@@ -428,18 +469,64 @@ av_cold void ff_sws_init_swscale_x86(SwsContext *c)
 #define ASSIGN_VSCALEX_FUNC(vscalefn, opt, do_16_case, condition_8bit) \
 switch(c->dstBpc){ \
     case 16:                          do_16_case;                          break; \
-    case 10: if (!isBE(c->dstFormat)) vscalefn = ff_yuv2planeX_10_ ## opt; break; \
+    case 14: if (!isBE(c->dstFormat)) vscalefn = ff_yuv2planeX_14_ ## opt; break; \
+    case 12: if (!isBE(c->dstFormat)) vscalefn = ff_yuv2planeX_12_ ## opt; break; \
+    case 10: if (!isBE(c->dstFormat) && c->dstFormat != AV_PIX_FMT_P010LE) vscalefn = ff_yuv2planeX_10_ ## opt; break; \
     case 9:  if (!isBE(c->dstFormat)) vscalefn = ff_yuv2planeX_9_  ## opt; break; \
     default: if (condition_8bit)    /*vscalefn = ff_yuv2planeX_8_  ## opt;*/ break; \
     }
 #define ASSIGN_VSCALE_FUNC(vscalefn, opt1, opt2, opt2chk) \
     switch(c->dstBpc){ \
     case 16: if (!isBE(c->dstFormat))            vscalefn = ff_yuv2plane1_16_ ## opt1; break; \
-    case 10: if (!isBE(c->dstFormat) && opt2chk) vscalefn = ff_yuv2plane1_10_ ## opt2; break; \
+    case 14: if (!isBE(c->dstFormat) && opt2chk) vscalefn = ff_yuv2plane1_14_ ## opt2; break; \
+    case 12: if (!isBE(c->dstFormat) && opt2chk) vscalefn = ff_yuv2plane1_12_ ## opt2; break; \
+    case 10: if (!isBE(c->dstFormat) && c->dstFormat != AV_PIX_FMT_P010LE && opt2chk) vscalefn = ff_yuv2plane1_10_ ## opt2; break; \
     case 9:  if (!isBE(c->dstFormat) && opt2chk) vscalefn = ff_yuv2plane1_9_  ## opt2;  break; \
     case 8:                                      vscalefn = ff_yuv2plane1_8_  ## opt1;  break; \
     default: av_assert0(c->dstBpc>8); \
     }
+#define ASSIGN_HIGHBD_INPUT_FUNCS(opt) \
+    switch (c->srcFormat) { \
+    case AV_PIX_FMT_YUVA420P9BE: \
+    case AV_PIX_FMT_YUVA422P9BE: \
+    case AV_PIX_FMT_YUVA444P9BE: \
+    case AV_PIX_FMT_YUVA420P10BE: \
+    case AV_PIX_FMT_YUVA422P10BE: \
+    case AV_PIX_FMT_YUVA444P10BE: \
+    case AV_PIX_FMT_YUVA420P16BE: \
+    case AV_PIX_FMT_YUVA422P16BE: \
+    case AV_PIX_FMT_YUVA444P16BE: \
+        c->alpToYV12 = ff_bswap16ToY_ ## opt; \
+    case AV_PIX_FMT_YUV420P9BE: \
+    case AV_PIX_FMT_YUV422P9BE: \
+    case AV_PIX_FMT_YUV444P9BE: \
+    case AV_PIX_FMT_YUV420P10BE: \
+    case AV_PIX_FMT_YUV422P10BE: \
+    case AV_PIX_FMT_YUV444P10BE: \
+    case AV_PIX_FMT_YUV420P12BE: \
+    case AV_PIX_FMT_YUV422P12BE: \
+    case AV_PIX_FMT_YUV444P12BE: \
+    case AV_PIX_FMT_YUV420P14BE: \
+    case AV_PIX_FMT_YUV422P14BE: \
+    case AV_PIX_FMT_YUV444P14BE: \
+    case AV_PIX_FMT_YUV420P16BE: \
+    case AV_PIX_FMT_YUV422P16BE: \
+    case AV_PIX_FMT_YUV444P16BE: \
+        c->chrToYV12 = ff_bswap16ToUV_ ## opt; \
+    case AV_PIX_FMT_GRAY16BE: \
+        c->lumToYV12 = ff_bswap16ToY_ ## opt; \
+        break; \
+    case AV_PIX_FMT_P010LE: \
+        c->lumToYV12 = ff_p010LEToY_ ## opt; \
+        c->chrToYV12 = ff_p010LEToUV_ ## opt; \
+        break; \
+    case AV_PIX_FMT_P010BE: \
+        c->lumToYV12 = ff_p010BEToY_ ## opt; \
+        c->chrToYV12 = ff_p010BEToUV_ ## opt; \
+        break; \
+    default: \
+        break; \
+    }
 #define case_rgb(x, X, opt) \
         case AV_PIX_FMT_ ## X: \
             c->lumToYV12 = ff_ ## x ## ToY_ ## opt; \
@@ -500,6 +587,7 @@ switch(c->dstBpc){ \
         ASSIGN_VSCALEX_FUNC(c->yuv2planeX, sse2, ,
                             HAVE_ALIGNED_STACK || ARCH_X86_64);
         ASSIGN_VSCALE_FUNC(c->yuv2plane1, sse2, sse2, 1);
+        ASSIGN_HIGHBD_INPUT_FUNCS(sse2);
 
         switch (c->srcFormat) {
         case AV_PIX_FMT_YA8:
@@ -580,4 +668,34 @@ switch(c->dstBpc){ \
             break;
         }
     }
+
+    if (EXTERNAL_AVX2(cpu_flags)) {
+        /* only the 4 and 8 tap filters of 9-16 bit sources, the other
+         * cases keep the SSE versions */
+        if (c->srcBpc > 8) {
+            if (c->hLumFilterSize == 4)
+                ASSIGN_SCALE_FUNC_HIGHBD(c->hyScale, 4, avx2, avx2);
+            else if (c->hLumFilterSize == 8)
+                ASSIGN_SCALE_FUNC_HIGHBD(c->hyScale, 8, avx2, avx2);
+            if (c->hChrFilterSize == 4)
+                ASSIGN_SCALE_FUNC_HIGHBD(c->hcScale, 4, avx2, avx2);
+            else if (c->hChrFilterSize == 8)
+                ASSIGN_SCALE_FUNC_HIGHBD(c->hcScale, 8, avx2, avx2);
+        }
+        ASSIGN_VSCALEX_FUNC(c->yuv2planeX, avx2,
+                            if (!isBE(c->dstFormat)) c->yuv2planeX = ff_yuv2planeX_16_avx2,
+                            HAVE_ALIGNED_STACK || ARCH_X86_64);
+        if (!isBE(c->dstFormat)) {
+            switch (c->dstBpc) {
+            case 16: c->yuv2plane1 = ff_yuv2plane1_16_avx2; break;
+            case 14: c->yuv2plane1 = ff_yuv2plane1_14_avx2; break;
+            case 12: c->yuv2plane1 = ff_yuv2plane1_12_avx2; break;
+            case 10: if (c->dstFormat != AV_PIX_FMT_P010LE)
+                         c->yuv2plane1 = ff_yuv2plane1_10_avx2;
+                     break;
+            case 9:  c->yuv2plane1 = ff_yuv2plane1_9_avx2;  break;
+            }
+        }
+        ASSIGN_HIGHBD_INPUT_FUNCS(avx2);
+    }
 }
@@ -173,6 +173,189 @@ lavftest(){
     ${base}/lavf-regression.sh $t lavf tests/vsynth1 "$target_exec" "$target_path" "$threads" "$thread_type" "$cpuflags" "$target_samples"
 }
 
+swr_threads(){
+    sample_fmt=$1
+    nb_threads=$2
+    acodec=$3
+    outfile1="${outdir}/${test}.1"
+    outfilen="${outdir}/${test}.${nb_threads}"
+    cleanfiles="$outfile1 $outfilen"
+    for t in 1 $nb_threads; do
+        framecrc -i $(target_path tests/data/asynth-44100-6.wav) \
+            -af aresample=48000:internal_sample_fmt=$sample_fmt:threads=$t:thread_min_samples=1,aformat=$sample_fmt \
+            -acodec $acodec > "${outdir}/${test}.$t" || return
+    done
+    diff $outfile1 $outfilen
+}
+
+mov_lazy_index(){
+    movfile="${outdir}/${test}.mov"
+    cleanfiles=$movfile
+    tmovfile=$(target_path $movfile)
+    ffmpeg -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(target_path tests/data/vsynth1.yuv) \
+        -i $(target_path tests/data/asynth-44100-2.wav) $ENC_OPTS $FLAGS -t 2 \
+        -r 600 -s 32x32 -vcodec mpeg4 -bf 2 -g 100 -acodec mp2 -f mov -y $tmovfile || return
+    framecrc -lazy_index $1 -i $tmovfile -c copy || return
+    run libavformat/seek-test $tmovfile -lazy_index $1
+}
+
+seek_index_read(){
+    logfile="${outdir}/${test}.log"
+    ffmpeg -v verbose -seek_index $2 -i $1 -c copy -f null - 2> $logfile || return
+    grep -o "does not match the input\|[A-Z][a-z]* [0-9]* index entries" $logfile
+    rm -f $logfile
+}
+
+seek_index(){
+    tsfile="${outdir}/${test}.ts"
+    idxfile="${outdir}/${test}.idx"
+    cleanfiles="$tsfile $idxfile"
+    ttsfile=$(target_path $tsfile)
+    tidxfile=$(target_path $idxfile)
+    rm -f $idxfile
+    ffmpeg -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(target_path tests/data/vsynth1.yuv) \
+        $ENC_OPTS $FLAGS -t 2 -s 32x32 -vcodec mpeg2video -g 12 -an -f mpegts -y $ttsfile || return
+    seek_index_read $ttsfile $tidxfile || return
+    seek_index_read $ttsfile $tidxfile || return
+    run libavformat/seek-test $ttsfile -seek_index $tidxfile || return
+    # a different modification time or size invalidates the index
+    touch -t 200001010000 $tsfile
+    seek_index_read $ttsfile $tidxfile || return
+    dd if=/dev/zero bs=188 count=1 2> /dev/null >> $tsfile
+    seek_index_read $ttsfile $tidxfile || return
+    seek_index_read $ttsfile $tidxfile
+}
+
+mov_reserve_moov_enc(){
+    ffmpeg -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(target_path tests/data/vsynth1.yuv) \
+        -i $(target_path tests/data/asynth-44100-2.wav) $ENC_OPTS $FLAGS -t 2 \
+        -s 32x32 -vcodec mpeg4 -acodec mp2 "$@" 2> $logfile || return
+    grep -o "does not fit\|Starting second pass" $logfile
+    return 0
+}
+
+mov_first_packet_data(){
+    pos=$(run ffprobe -v 0 -show_entries packet=pos -of compact=p=0:nk=1 $(target_path $1) | sort -n | head -n 1)
+    tail -c +$((pos + 1)) $1 > $2
+}
+
+mov_reserve_moov(){
+    faststart="${outdir}/${test}-faststart.mov"
+    reserve="${outdir}/${test}-reserve.mov"
+    small="${outdir}/${test}-small.mov"
+    logfile="${outdir}/${test}.log"
+    cleanfiles="$faststart $reserve $small $faststart.data $reserve.data $logfile"
+    echo faststart
+    mov_reserve_moov_enc -movflags +faststart -f mov -y $(target_path $faststart) || return
+    echo reserve_moov
+    mov_reserve_moov_enc -movflags +reserve_moov -f mov -y $(target_path $reserve) || return
+    echo reserve_moov moov_size=64
+    mov_reserve_moov_enc -movflags +reserve_moov -moov_size 64 -f mov -y $(target_path $small) || return
+    # the space reserved for the moov is followed by the same data
+    mov_first_packet_data $faststart $faststart.data || return
+    mov_first_packet_data $reserve $reserve.data || return
+    cmp $faststart.data $reserve.data || return
+    # a moov overflowing the reserved space is moved exactly like faststart
+    cmp $faststart $small || return
+    framecrc -i $(target_path $reserve) -c copy
+}
+
+tee_queue_enc(){
+    ffmpeg -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(target_path $raw_src) \
+        -c:v mpeg4 -g 1000 -qscale 5 -flags +bitexact -map 0 -f tee "$@"
+}
+
+tee_queue_crc(){
+    ffmpeg -i $(target_path $1) -c copy -flags +bitexact -f framecrc - > $2
+}
+
+# Write through a slave that stalls until the overflow policy has triggered
+# and check that it received a prefix of what the other slave received.
+tee_queue_overflow(){
+    policy=$1
+    full="${outdir}/${test}-${policy}-full.nut"
+    stalled="${outdir}/${test}-${policy}.nut"
+    fifo="${outdir}/${test}-${policy}.fifo"
+    logfile="${outdir}/${test}-${policy}.log"
+    cleanfiles="$cleanfiles $full $stalled $fifo $logfile $full.crc $stalled.crc"
+    rm -f $fifo $logfile
+    mkfifo $fifo || return
+    { until grep -q "queue full" $logfile 2>/dev/null; do sleep 1; done; cat; } \
+        < $fifo > $stalled &
+    tee_queue_enc "[f=nut]$(target_path $full)|[f=nut:queue_size=1:overflow=$policy]$(target_path $fifo)" \
+        2> $logfile || return
+    wait
+    cmp $sync $full || return
+    tee_queue_crc $full $full.crc || return
+    tee_queue_crc $stalled $stalled.crc || return
+    lines=$(wc -l < $stalled.crc)
+    test $lines -lt $(wc -l < $full.crc) || return
+    head -n $lines $full.crc | cmp - $stalled.crc
+}
+
+tee_queue(){
+    raw_src=$1
+    sync="${outdir}/${test}-sync.nut"
+    queued="${outdir}/${test}-queued.nut"
+    cleanfiles="$sync $queued"
+    tee_queue_enc "[f=nut]$(target_path $sync)|[f=nut:queue_size=4]$(target_path $queued)" || return
+    # a queued slave writes exactly what a synchronous one does
+    cmp $sync $queued || return
+    tee_queue_overflow drop || return
+    tee_queue_overflow disconnect || return
+    framecrc -i $(target_path $queued) -c copy
+}
+
+segment_finalize_enc(){
+    dir=$1
+    shift
+    rm -rf $dir
+    mkdir -p $dir || return
+    ffmpeg -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(target_path $raw_src) \
+        -c:v mpeg4 -g 10 -qscale 5 -flags +bitexact -fflags +bitexact "$@"
+}
+
+# Segment the same input with and without background finalization, the
+# segments and the list must be identical.
+segment_finalize(){
+    raw_src=$1
+    muxer=$2
+    async_opts=$3
+    plain="${outdir}/${test}-plain"
+    async="${outdir}/${test}-async"
+    case $muxer in
+    segment)
+        list=list.m3u8
+        opts="-f segment -segment_format nut -segment_time 0.4 -segment_list"
+        set -- $list seg%d.nut ;;
+    hls)
+        list=out.m3u8
+        opts="-f hls -hls_time 0.4 -hls_list_size 0"
+        set -- $list ;;
+    esac
+    segment_finalize_enc $plain $opts $(target_path $plain)/$1 ${2:+$(target_path $plain)/$2} || return
+    segment_finalize_enc $async $opts $(target_path $async)/$1 ${2:+$(target_path $async)/$2} \
+        $async_opts || return
+    test "$(ls $plain)" = "$(ls $async)" || return
+    for f in $(ls $plain); do
+        cmp $plain/$f $async/$f || return
+    done
+    cat $plain/$list
+    for f in $(ls $plain); do
+        test $f = $list || echo $f $(do_md5sum $plain/$f | cut -d' ' -f1)
+    done
+    rm -rf $plain $async
+}
+
+hls_prefetch(){
+    raw_src=$1
+    dir="${outdir}/${test}-segments"
+    segment_finalize_enc $dir -f hls -hls_time 0.4 -hls_list_size 0 \
+        $(target_path $dir)/out.m3u8 || return
+    run libavformat/hls-test $(target_path $dir) || return
+    rm -rf $dir
+}
+
 video_filter(){
     filters=$1
     shift
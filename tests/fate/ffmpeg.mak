@@ -46,3 +46,17 @@ fate-unknown_layout-ac3: $(AREF)
 fate-unknown_layout-ac3: CMD = md5 \
   -guess_layout_max 0 -f s16le -ac 1 -ar 44100 -i $(TARGET_PATH)/$(AREF) \
   -f ac3 -flags +bitexact -c ac3_fixed
+
+ifdef HAVE_THREADS
+FATE_FFMPEG-$(call ALLYES, RAWVIDEO_DEMUXER MPEG4_ENCODER TEE_MUXER NUT_MUXER NUT_DEMUXER FRAMECRC_MUXER) += fate-tee-queue
+endif
+fate-tee-queue: tests/data/vsynth1.yuv
+fate-tee-queue: CMD = tee_queue tests/data/vsynth1.yuv
+
+FATE_FFMPEG-$(call ALLYES, RAWVIDEO_DEMUXER MPEG4_ENCODER SEGMENT_MUXER NUT_MUXER) += fate-segment-async-finalize
+fate-segment-async-finalize: tests/data/vsynth1.yuv
+fate-segment-async-finalize: CMD = segment_finalize tests/data/vsynth1.yuv segment "-segment_async_finalize 1 -segment_fsync 1"
+
+FATE_FFMPEG-$(call ALLYES, RAWVIDEO_DEMUXER MPEG4_ENCODER HLS_MUXER MPEGTS_MUXER) += fate-hls-async-finalize
+fate-hls-async-finalize: tests/data/vsynth1.yuv
+fate-hls-async-finalize: CMD = segment_finalize tests/data/vsynth1.yuv hls "-hls_flags +async_finalize+fsync"
@@ -196,6 +196,12 @@ fate-filter-scale200: CMD = video_filter "scale=w=200:h=200"
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale500
 fate-filter-scale500: CMD = video_filter "scale=w=500:h=500"
 
+FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER SCALE_FILTER) += fate-filter-scale-nv12
+fate-filter-scale-nv12: CMD = video_filter "format=nv12,format=yuv420p,format=nv21,format=yuv420p"
+
+FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER SCALE_FILTER) += fate-filter-scale-p010
+fate-filter-scale-p010: CMD = video_filter "format=yuv420p10,format=p010,format=yuv420p10"
+
 FATE_FILTER_VSYNTH-$(CONFIG_VFLIP_FILTER) += fate-filter-vflip
 fate-filter-vflip: CMD = video_filter "vflip"
 
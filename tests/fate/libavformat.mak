@@ -1,3 +1,17 @@
+FATE_LIBAVFORMAT-$(call ALLYES, ASYNC_PROTOCOL) += fate-async
+fate-async: libavformat/async-test$(EXESUF)
+fate-async: CMD = run libavformat/async-test
+
+FATE_LIBAVFORMAT-$(call ALLYES, HLS_DEMUXER HLS_MUXER MPEGTS_DEMUXER RAWVIDEO_DEMUXER MPEG4_ENCODER) += fate-hls-prefetch
+fate-hls-prefetch: libavformat/hls-test$(EXESUF) ffmpeg$(EXESUF) tests/data/vsynth1.yuv
+fate-hls-prefetch: CMD = hls_prefetch tests/data/vsynth1.yuv
+
+ifdef HAVE_PTHREADS
+FATE_LIBAVFORMAT-$(CONFIG_HTTP_PROTOCOL) += fate-http
+endif
+fate-http: libavformat/http-test$(EXESUF)
+fate-http: CMD = run libavformat/http-test
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/noproxy-test$(EXESUF)
 fate-noproxy: CMD = run libavformat/noproxy-test
@@ -48,6 +48,11 @@ fate-des: libavutil/des-test$(EXESUF)
 fate-des: CMD = run libavutil/des-test
 fate-des: REF = /dev/null
 
+FATE_LIBAVUTIL += fate-dict
+fate-dict: libavutil/dict-test$(EXESUF)
+fate-dict: CMD = run libavutil/dict-test
+fate-dict: REF = /dev/null
+
 FATE_LIBAVUTIL += fate-eval
 fate-eval: libavutil/eval-test$(EXESUF)
 fate-eval: CMD = run libavutil/eval-test
@@ -78,6 +83,10 @@ FATE_LIBAVUTIL += fate-parseutils
 fate-parseutils: libavutil/parseutils-test$(EXESUF)
 fate-parseutils: CMD = run libavutil/parseutils-test
 
+FATE_LIBAVUTIL += fate-perf
+fate-perf: libavutil/perf-test$(EXESUF)
+fate-perf: CMD = run libavutil/perf-test
+
 FATE_LIBAVUTIL-$(CONFIG_PIXELUTILS) += fate-pixelutils
 fate-pixelutils: libavutil/pixelutils-test$(EXESUF)
 fate-pixelutils: CMD = run libavutil/pixelutils-test
@@ -393,6 +393,23 @@ $(call CROSS_TEST,$(SAMPLERATES_NN),ARESAMPLE_ASYNC,s16p,s16le,s16)
 $(call CROSS_TEST,$(SAMPLERATES_NN),ARESAMPLE_ASYNC,fltp,f32le,s16)
 
 
+# The output must not depend on the number of threads the channels are
+# resampled with: the tests print the differences between the output with 1
+# and with 4 threads.
+define ARESAMPLE_THREADS
+FATE_SWR_THREADS-$(call FILTERDEMDECENCMUX, ARESAMPLE, WAV, PCM_S16LE, $(3), FRAMECRC) += fate-swr-threads-$(1)
+fate-swr-threads-$(1): tests/data/asynth-44100-6.wav
+fate-swr-threads-$(1): CMD = swr_threads $(1) 4 $(2)
+fate-swr-threads-$(1): REF = /dev/null
+endef
+
+$(eval $(call ARESAMPLE_THREADS,s16p,pcm_s16le,PCM_S16LE))
+$(eval $(call ARESAMPLE_THREADS,fltp,pcm_f32le,PCM_F32LE))
+$(eval $(call ARESAMPLE_THREADS,dblp,pcm_f64le,PCM_F64LE))
+
+fate-swr-threads: $(FATE_SWR_THREADS-yes)
+FATE_SWR += $(FATE_SWR_THREADS-yes)
+
 FATE_SWR_RESAMPLE-$(call FILTERDEMDECENCMUX, ARESAMPLE, WAV, PCM_S16LE, PCM_S16LE, WAV) += $(FATE_SWR_RESAMPLE)
 fate-swr-resample: $(FATE_SWR_RESAMPLE-yes)
 FATE_SWR += $(FATE_SWR_RESAMPLE-yes)
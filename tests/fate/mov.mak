@@ -0,0 +1,23 @@
+# The index computed on demand with lazy_index must give the same packets and
+# seek results as the full index, so the tests share their references. The
+# generated file has more than one block of sample table entries per track.
+FATE_MOV_LAZY_INDEX = fate-mov-lazy-index-0 fate-mov-lazy-index-1
+FATE_MOV-$(call ALLYES, RAWVIDEO_DEMUXER WAV_DEMUXER SCALE_FILTER MPEG4_ENCODER MP2_ENCODER MOV_MUXER MOV_DEMUXER) += $(FATE_MOV_LAZY_INDEX)
+$(FATE_MOV_LAZY_INDEX): tests/data/vsynth1.yuv tests/data/asynth-44100-2.wav libavformat/seek-test$(EXESUF)
+$(FATE_MOV_LAZY_INDEX): CMD = mov_lazy_index $(@:fate-mov-lazy-index-%=%)
+$(FATE_MOV_LAZY_INDEX): REF = $(SRC_PATH)/tests/ref/fate/mov-lazy-index
+
+FATE_MOV-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-seek-lavf-mov-lazy-index
+fate-seek-lavf-mov-lazy-index: fate-lavf-mov libavformat/seek-test$(EXESUF)
+fate-seek-lavf-mov-lazy-index: CMD = run libavformat/seek-test$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mov -lazy_index 1
+fate-seek-lavf-mov-lazy-index: REF = $(SRC_PATH)/tests/ref/seek/lavf-mov
+
+# reserve_moov must be followed by the same data as faststart when the
+# estimate fits, and give the same file as faststart when the reserved space
+# is too small and the data is moved.
+FATE_MOV-$(call ALLYES, FFPROBE RAWVIDEO_DEMUXER WAV_DEMUXER SCALE_FILTER MPEG4_ENCODER MP2_ENCODER MOV_MUXER MOV_DEMUXER FRAMECRC_MUXER) += fate-mov-reserve-moov
+fate-mov-reserve-moov: tests/data/vsynth1.yuv tests/data/asynth-44100-2.wav ffprobe$(EXESUF)
+fate-mov-reserve-moov: CMD = mov_reserve_moov
+
+FATE_AVCONV += $(FATE_MOV-yes)
+fate-mov: $(FATE_MOV-yes)
@@ -242,6 +242,24 @@ $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/seek-test$(EXESUF) $(TA
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): fate-seek-%: fate-%
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
-FATE_AVCONV += $(FATE_SEEK)
+# the seek_index sidecar file must be written, loaded, and ignored once the
+# input changed
+FATE_SEEK_INDEX-$(call ENCDEC, MPEG2VIDEO, MPEGTS) += fate-seek-index-mpegts
+fate-seek-index-mpegts: tests/data/vsynth1.yuv libavformat/seek-test$(EXESUF)
+fate-seek-index-mpegts: CMD = seek_index
+
+# the same seeks with the input memory mapped, mpegts reads its packets
+# straight from the mapping
+FATE_SEEK_MMAP-$(call ENCDEC2, MPEG4,      MP2,       AVI)         += avi
+FATE_SEEK_MMAP-$(call ENCDEC2, MPEG2VIDEO, MP2,       MPEGTS)      += ts
+FATE_SEEK_MMAP = $(FATE_SEEK_MMAP-yes:%=fate-seek-mmap-lavf-%)
+
+$(FATE_SEEK_MMAP): fate-seek-mmap-lavf-%: fate-seek-lavf-%
+$(FATE_SEEK_MMAP): CMD = run libavformat/seek-test$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC) -mmap 1
+$(FATE_SEEK_MMAP): REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-mmap-%=%)
+fate-seek-mmap-lavf-avi: SRC = lavf/lavf.avi
+fate-seek-mmap-lavf-ts:  SRC = lavf/lavf.ts
+
+FATE_AVCONV += $(FATE_SEEK) $(FATE_SEEK_INDEX-yes) $(FATE_SEEK_MMAP)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK)
+fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_INDEX-yes) $(FATE_SEEK_MMAP)
@@ -31,6 +31,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/crc.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/time.h"
 #include "libavutil/timer.h"
 
 #ifndef AV_READ_TIME
@@ -75,6 +76,7 @@ struct hash_impl {
 #include "libavutil/sha512.h"
 #include "libavutil/ripemd.h"
 #include "libavutil/aes.h"
+#include "libavutil/adler32.h"
 
 #define IMPL_USE_lavu IMPL_USE
 
@@ -111,6 +113,47 @@ static void run_lavu_aes128(uint8_t *output,
     av_aes_crypt(aes, output, input, size >> 4, NULL, 0);
 }
 
+static void run_lavu_aes256(uint8_t *output,
+                            const uint8_t *input, unsigned size)
+{
+    static struct AVAES *aes;
+    if (!aes && !(aes = av_aes_alloc()))
+        fatal_error("out of memory");
+    av_aes_init(aes, hardcoded_key, 256, 0);
+    av_aes_crypt(aes, output, input, size >> 4, NULL, 0);
+}
+
+static void run_lavu_aes128cbcdec(uint8_t *output,
+                                  const uint8_t *input, unsigned size)
+{
+    static struct AVAES *aes;
+    uint8_t iv[16] = { 0 };
+    if (!aes && !(aes = av_aes_alloc()))
+        fatal_error("out of memory");
+    av_aes_init(aes, hardcoded_key, 128, 1);
+    av_aes_crypt(aes, output, input, size >> 4, iv, 1);
+}
+
+static void run_lavu_crc32(uint8_t *output,
+                           const uint8_t *input, unsigned size)
+{
+    const AVCRC *crc = av_crc_get_table(AV_CRC_32_IEEE);
+    AV_WB32(output, av_crc(crc, UINT32_MAX, input, size));
+}
+
+static void run_lavu_crc32le(uint8_t *output,
+                             const uint8_t *input, unsigned size)
+{
+    const AVCRC *crc = av_crc_get_table(AV_CRC_32_IEEE_LE);
+    AV_WB32(output, av_crc(crc, UINT32_MAX, input, size));
+}
+
+static void run_lavu_adler32(uint8_t *output,
+                             const uint8_t *input, unsigned size)
+{
+    AV_WB32(output, av_adler32_update(1, input, size));
+}
+
 /***************************************************************************
  * crypto: OpenSSL's libcrypto
  ***************************************************************************/
@@ -147,6 +190,28 @@ static void run_crypto_aes128(uint8_t *output,
         AES_encrypt(input + i, output + i, &aes);
 }
 
+static void run_crypto_aes256(uint8_t *output,
+                              const uint8_t *input, unsigned size)
+{
+    AES_KEY aes;
+    unsigned i;
+
+    AES_set_encrypt_key(hardcoded_key, 256, &aes);
+    size -= 15;
+    for (i = 0; i < size; i += 16)
+        AES_encrypt(input + i, output + i, &aes);
+}
+
+static void run_crypto_aes128cbcdec(uint8_t *output,
+                                    const uint8_t *input, unsigned size)
+{
+    AES_KEY aes;
+    uint8_t iv[16] = { 0 };
+
+    AES_set_decrypt_key(hardcoded_key, 128, &aes);
+    AES_cbc_encrypt(input, output, size & ~15, &aes, iv, AES_DECRYPT);
+}
+
 #define IMPL_USE_crypto(...) IMPL_USE(__VA_ARGS__)
 #else
 #define IMPL_USE_crypto(...) /* ignore */
@@ -242,6 +307,7 @@ static void run_implementation(const uint8_t *input, uint8_t *output,
                                struct hash_impl *impl, unsigned size)
 {
     uint64_t t0, t1;
+    int64_t wtime = 0, w0;
     unsigned nruns = specified_runs ? specified_runs : (1 << 30) / size;
     unsigned outlen = 0, outcrc = 0;
     unsigned i, j, val;
@@ -262,9 +328,11 @@ static void run_implementation(const uint8_t *input, uint8_t *output,
         impl->run(output, input, size);
     for (i = 0; i < nruns; i++) {
         memset(output, 0, size); /* avoid leftovers from previous runs */
+        w0 = av_gettime_relative();
         t0 = AV_READ_TIME();
         impl->run(output, input, size);
         t1 = AV_READ_TIME();
+        wtime += av_gettime_relative() - w0;
         if (outlen ? memcmp(output, outref, outlen) :
                      crc32(output, size) != outcrc) {
             fprintf(stderr, "Expected: ");
@@ -284,8 +352,9 @@ static void run_implementation(const uint8_t *input, uint8_t *output,
     ttime  /= nruns;
     ttime2 /= nruns;
     stime = sqrt(ttime2 - ttime * ttime);
-    printf("%-10s %-12s size: %7d  runs: %6d  time: %8.3f +- %.3f\n",
-           impl->lib, impl->name, size, nruns, ttime, stime);
+    printf("%-10s %-15s size: %7d  runs: %6d  time: %8.3f +- %.3f  %8.1f MB/s\n",
+           impl->lib, impl->name, size, nruns, ttime, stime,
+           wtime ? (double)size * nruns / wtime : 0);
     fflush(stdout);
 }
 
@@ -306,6 +375,13 @@ struct hash_impl implementations[] = {
                                       "7c25b9e118c200a189fcd5a01ef106a4e200061f3e97dbf50ba065745fd46bef")
     IMPL_ALL("RIPEMD-160", ripemd160, "62a5321e4fc8784903bb43ab7752c75f8b25af00")
     IMPL_ALL("AES-128",    aes128,    "crc:ff6bc888")
+    IMPL(lavu,   "AES-256",         aes256,        "crc:792e4e8a")
+    IMPL(crypto, "AES-256",         aes256,        "crc:792e4e8a")
+    IMPL(lavu,   "AES-128-CBC-dec", aes128cbcdec,  "crc:ae4a81eb")
+    IMPL(crypto, "AES-128-CBC-dec", aes128cbcdec,  "crc:ae4a81eb")
+    IMPL(lavu,   "CRC-32",          crc32,         "e5041047")
+    IMPL(lavu,   "CRC-32-LE",       crc32le,       "edaab359")
+    IMPL(lavu,   "Adler-32",        adler32,       "02be3d2d")
 };
 
 int main(int argc, char **argv)
@@ -0,0 +1,98 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Benchmark of segment uploads over HTTP.
+ *
+ * Segments of a number of renditions are uploaded the way a live packager
+ * pushes them to an origin server: one segment of every rendition in turn,
+ * each through its own avio_open2() of the segment URL. The URL template
+ * gets the rendition and the segment number, and protocol options such as
+ * method=PUT:connection_pool=1 are passed to every open.
+ *
+ * make tools/http_upload_bench
+ * tools/http_upload_bench http://localhost:8080/r%d/s%d.ts 24 10 188000 method=PUT:connection_pool=1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+int main(int argc, char **argv)
+{
+    AVDictionary *opts = NULL;
+    uint8_t *data = NULL;
+    int nb_renditions, nb_segments, size, i, j, ret = 0;
+    int64_t t;
+
+    if (argc < 5) {
+        fprintf(stderr, "usage: %s url_template nb_renditions nb_segments "
+                "segment_size [options]\n"
+                "options are protocol options as key=value:key=value\n",
+                argv[0]);
+        return 1;
+    }
+    nb_renditions = atoi(argv[2]);
+    nb_segments   = atoi(argv[3]);
+    size          = atoi(argv[4]);
+
+    av_register_all();
+    avformat_network_init();
+    if (argc > 5 && (ret = av_dict_parse_string(&opts, argv[5], "=", ":", 0)) < 0)
+        goto end;
+    if (!(data = av_mallocz(size))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    t = av_gettime_relative();
+    for (j = 0; j < nb_segments; j++) {
+        for (i = 0; i < nb_renditions; i++) {
+            AVDictionary *o = NULL;
+            AVIOContext *pb;
+            char url[1024];
+
+            snprintf(url, sizeof(url), argv[1], i, j);
+            av_dict_copy(&o, opts, 0);
+            ret = avio_open2(&pb, url, AVIO_FLAG_WRITE, NULL, &o);
+            av_dict_free(&o);
+            if (ret < 0)
+                goto end;
+            avio_write(pb, data, size);
+            if ((ret = avio_closep(&pb)) < 0)
+                goto end;
+        }
+    }
+    t = av_gettime_relative() - t;
+
+    fprintf(stderr, "%d segments: %.3f s, %.1f ms/segment\n",
+            nb_renditions * nb_segments, t / 1000000.0,
+            t / 1000.0 / FFMAX(nb_renditions * nb_segments, 1));
+
+end:
+    av_free(data);
+    av_dict_free(&opts);
+    avformat_network_deinit();
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Load test of a live HTTP streaming server such as ffserver.
+ *
+ * Opens a number of client connections to a stream, reads from all of them
+ * for the given duration and reports the data rate received per viewer.
+ * When the process id of the server is given, the CPU time it used during
+ * the measurement is read from /proc and reported per viewer.
+ *
+ * make tools/http_viewer_bench
+ * tools/http_viewer_bench http://localhost:8090/test.ts 2000 10 $(pidof ffserver)
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+typedef struct Viewer {
+    int got_reply;
+    int64_t bytes;
+} Viewer;
+
+/* user and system CPU time used by a process, in seconds */
+static double process_cpu_time(int pid)
+{
+    char path[64], line[1024], *p;
+    unsigned long utime, stime;
+    FILE *f;
+    int ret;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if (!(f = fopen(path, "r")))
+        return -1;
+    p = fgets(line, sizeof(line), f);
+    fclose(f);
+    /* the fields after the command name, which may contain spaces */
+    if (!p || !(p = strrchr(line, ')')))
+        return -1;
+    ret = sscanf(p + 1, "%*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %lu %lu",
+                 &utime, &stime);
+    if (ret != 2)
+        return -1;
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static double own_cpu_time(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0 +
+           ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
+}
+
+static int open_viewer(const struct addrinfo *ai, const char *request)
+{
+    int fd = socket(ai->ai_family, SOCK_STREAM, 0);
+
+    if (fd < 0)
+        return -1;
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) < 0 ||
+        send(fd, request, strlen(request), 0) != strlen(request)) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/* read what is available on the connections which have data */
+static void read_viewers(struct pollfd *fds, Viewer *viewers, int nb_viewers,
+                         uint8_t *buf, int buf_size, int timeout)
+{
+    int i, len;
+
+    if (poll(fds, nb_viewers, timeout) <= 0)
+        return;
+    for (i = 0; i < nb_viewers; i++) {
+        if (fds[i].fd < 0 || !fds[i].revents)
+            continue;
+        len = recv(fds[i].fd, buf, buf_size, 0);
+        if (len < 0 && (errno == EAGAIN || errno == EINTR))
+            continue;
+        if (len > 0 && !viewers[i].got_reply) {
+            /* only keep the viewers whose request was accepted */
+            if (len < 12 || memcmp(buf, "HTTP/1.", 7) || memcmp(buf + 9, "200", 3))
+                len = 0;
+            viewers[i].got_reply = 1;
+        }
+        if (len <= 0) {
+            close(fds[i].fd);
+            fds[i].fd = -1;
+            continue;
+        }
+        viewers[i].bytes += len;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char host[256], path[1024], port_str[16], request[1400];
+    struct addrinfo hints = { 0 }, *ai = NULL;
+    struct pollfd *fds = NULL;
+    Viewer *viewers = NULL;
+    struct rlimit rl;
+    uint8_t *buf = NULL;
+    int64_t start, bytes = 0;
+    double duration, server_cpu = -1, own_cpu;
+    int nb_viewers, pid = 0, port, streaming = 0, closed = 0, i, ret = 1;
+
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s url nb_viewers duration [server_pid]\n"
+                "Reads a HTTP stream with nb_viewers connections for duration "
+                "seconds, and reports the CPU used by the server per viewer.\n",
+                argv[0]);
+        return 1;
+    }
+    nb_viewers = atoi(argv[2]);
+    duration   = atof(argv[3]);
+    if (argc > 4)
+        pid = atoi(argv[4]);
+
+    av_url_split(NULL, 0, NULL, 0, host, sizeof(host), &port,
+                 path, sizeof(path), argv[1]);
+    if (port < 0)
+        port = 80;
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    snprintf(request, sizeof(request),
+             "GET %s HTTP/1.0\r\nHost: %s\r\nUser-Agent: http_viewer_bench\r\n\r\n",
+             path[0] ? path : "/", host);
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port_str, &hints, &ai)) {
+        fprintf(stderr, "Could not resolve '%s'\n", host);
+        goto end;
+    }
+
+    /* each viewer needs a file descriptor */
+    if (!getrlimit(RLIMIT_NOFILE, &rl) && rl.rlim_cur < nb_viewers + 16) {
+        rl.rlim_cur = FFMIN(nb_viewers + 16, rl.rlim_max);
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    fds     = av_mallocz_array(nb_viewers, sizeof(*fds));
+    viewers = av_mallocz_array(nb_viewers, sizeof(*viewers));
+    buf     = av_malloc(65536);
+    if (!fds || !viewers || !buf)
+        goto end;
+
+    /* connect the viewers, reading from those already connected so that
+       the server does not drop them */
+    for (i = 0; i < nb_viewers; i++) {
+        fds[i].fd     = open_viewer(ai, request);
+        fds[i].events = POLLIN;
+        if (fds[i].fd < 0) {
+            fprintf(stderr, "Could not open connection %d: %s\n", i, strerror(errno));
+            nb_viewers = i;
+            break;
+        }
+        if (i % 100 == 99)
+            read_viewers(fds, viewers, i + 1, buf, 65536, 0);
+    }
+
+    /* let the viewers receive the start of the stream */
+    start = av_gettime_relative();
+    while (av_gettime_relative() - start < 2000000)
+        read_viewers(fds, viewers, nb_viewers, buf, 65536, 100);
+    for (i = 0; i < nb_viewers; i++)
+        viewers[i].bytes = 0;
+
+    if (pid)
+        server_cpu = process_cpu_time(pid);
+    own_cpu = own_cpu_time();
+    start   = av_gettime_relative();
+    while (av_gettime_relative() - start < duration * 1000000)
+        read_viewers(fds, viewers, nb_viewers, buf, 65536, 100);
+    duration = (av_gettime_relative() - start) / 1000000.0;
+    own_cpu  = own_cpu_time() - own_cpu;
+    if (pid && server_cpu >= 0)
+        server_cpu = process_cpu_time(pid) - server_cpu;
+
+    for (i = 0; i < nb_viewers; i++) {
+        if (fds[i].fd < 0) {
+            closed++;
+        } else if (viewers[i].bytes) {
+            streaming++;
+            bytes += viewers[i].bytes;
+        }
+    }
+
+    printf("%d of %d viewers streaming, %d closed, %.1f kbit/s per viewer, %.1f Mbit/s total\n",
+           streaming, nb_viewers, closed,
+           streaming ? bytes * 8 / duration / 1000 / streaming : 0,
+           bytes * 8 / duration / 1000000);
+    if (server_cpu >= 0)
+        printf("server: %.1f%% CPU, %.1f us CPU per viewer per second\n",
+               server_cpu * 100 / duration,
+               streaming ? server_cpu * 1000000 / duration / streaming : 0);
+    printf("client: %.1f%% CPU\n", own_cpu * 100 / duration);
+    ret = 0;
+
+end:
+    for (i = 0; fds && i < nb_viewers; i++)
+        if (fds[i].fd >= 0)
+            close(fds[i].fd);
+    if (ai)
+        freeaddrinfo(ai);
+    av_free(fds);
+    av_free(viewers);
+    av_free(buf);
+    return ret;
+}
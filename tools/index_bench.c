@@ -0,0 +1,100 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Benchmark of the stream index.
+ *
+ * Entries are added to the index of a number of streams with
+ * av_add_index_entry() the way a demuxer does while reading: every stream in
+ * turn, with increasing timestamps. Lookups at random timestamps are then
+ * done with av_index_search_timestamp(), at most NB_LOOKUPS per stream.
+ *
+ * make tools/index_bench
+ * tools/index_bench 2 10000000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+#define NB_LOOKUPS 1000000
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *s;
+    AVLFG lfg;
+    int64_t t, found = 0;
+    int nb_streams, nb_entries, nb_lookups, i, j, ret = 0;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s nb_streams nb_entries\n"
+                "adds nb_entries index entries to each stream, then looks up "
+                "timestamps in them\n", argv[0]);
+        return 1;
+    }
+    nb_streams = atoi(argv[1]);
+    nb_entries = atoi(argv[2]);
+    nb_lookups = FFMIN(nb_entries, NB_LOOKUPS);
+
+    av_register_all();
+    if (!(s = avformat_alloc_context()))
+        return 1;
+    for (i = 0; i < nb_streams; i++) {
+        if (!avformat_new_stream(s, NULL)) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+
+    t = av_gettime_relative();
+    for (j = 0; j < nb_entries; j++) {
+        for (i = 0; i < nb_streams; i++) {
+            ret = av_add_index_entry(s->streams[i], (int64_t)j * 1000 + i,
+                                     (int64_t)j * 40, 1000, 0, AVINDEX_KEYFRAME);
+            if (ret < 0)
+                goto end;
+        }
+    }
+    t = av_gettime_relative() - t;
+    fprintf(stderr, "add:    %.3f s, %.1f ns/entry\n", t / 1000000.0,
+            t * 1000.0 / FFMAX((int64_t)nb_streams * nb_entries, 1));
+
+    av_lfg_init(&lfg, 0);
+    t = av_gettime_relative();
+    for (j = 0; j < nb_lookups; j++) {
+        for (i = 0; i < nb_streams; i++) {
+            int64_t ts = av_lfg_get(&lfg) % ((int64_t)nb_entries * 40);
+            found += av_index_search_timestamp(s->streams[i], ts, AVSEEK_FLAG_BACKWARD) >= 0;
+        }
+    }
+    t = av_gettime_relative() - t;
+    fprintf(stderr, "search: %.3f s, %.1f ns/lookup, %"PRId64" found\n", t / 1000000.0,
+            t * 1000.0 / FFMAX((int64_t)nb_streams * nb_lookups, 1), found);
+    ret = 0;
+
+end:
+    avformat_free_context(s);
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
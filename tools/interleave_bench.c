@@ -0,0 +1,140 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Benchmark of the muxer packet interleaving with many streams.
+ *
+ * One video, a number of audio and a number of subtitle streams are muxed
+ * with av_interleaved_write_frame(). Packets are fed the way a demuxer with
+ * a coarse interleaving returns them: every stream in turn for half a
+ * second. With the framecrc muxer the output shows the interleaving order.
+ *
+ * make tools/interleave_bench
+ * tools/interleave_bench 16 16 600 null
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+#define TIME_BASE   90000
+#define BURST       (TIME_BASE / 2)
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *s = NULL;
+    AVDictionary *opts = NULL;
+    int64_t *next_dts, burst, nb_packets = 0, t;
+    int nb_audio, nb_subtitles, nb_streams, i, ret;
+    double duration;
+
+    if (argc < 5) {
+        fprintf(stderr, "usage: %s nb_audio nb_subtitles duration format "
+                "[options [output]]\n"
+                "options are muxer options as key=value:key=value\n",
+                argv[0]);
+        return 1;
+    }
+    nb_audio     = atoi(argv[1]);
+    nb_subtitles = atoi(argv[2]);
+    duration     = atof(argv[3]);
+    nb_streams   = 1 + nb_audio + nb_subtitles;
+
+    av_register_all();
+    if ((ret = avformat_alloc_output_context2(&s, NULL, argv[4], NULL)) < 0)
+        goto end;
+    for (i = 0; i < nb_streams; i++) {
+        AVStream *st = avformat_new_stream(s, NULL);
+        if (!st) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        st->time_base = (AVRational){ 1, TIME_BASE };
+        if (!i) {
+            st->codec->codec_type = AVMEDIA_TYPE_VIDEO;
+            st->codec->codec_id   = AV_CODEC_ID_MPEG2VIDEO;
+            st->codec->width      = 16;
+            st->codec->height     = 16;
+        } else if (i <= nb_audio) {
+            st->codec->codec_type  = AVMEDIA_TYPE_AUDIO;
+            st->codec->codec_id    = AV_CODEC_ID_MP2;
+            st->codec->sample_rate = 48000;
+            st->codec->channels    = 2;
+        } else {
+            st->codec->codec_type = AVMEDIA_TYPE_SUBTITLE;
+            st->codec->codec_id   = AV_CODEC_ID_SUBRIP;
+        }
+    }
+    if (argc > 5 && (ret = av_dict_parse_string(&opts, argv[5], "=", ":", 0)) < 0)
+        goto end;
+    if ((ret = avio_open(&s->pb, argc > 6 ? argv[6] : "/dev/null", AVIO_FLAG_WRITE)) < 0)
+        goto end;
+    if ((ret = avformat_write_header(s, &opts)) < 0)
+        goto end;
+
+    if (!(next_dts = av_mallocz_array(nb_streams, sizeof(*next_dts)))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = nb_audio + 1; i < nb_streams; i++)
+        next_dts[i] = (i - nb_audio) * TIME_BASE / 10;
+
+    t = av_gettime_relative();
+    for (burst = 0; burst * BURST < duration * TIME_BASE; burst++) {
+        for (i = 0; i < nb_streams; i++) {
+            /* 25 fps video, 24 ms audio frames, a subtitle every 5 s */
+            int duration = !i ? 3600 : i <= nb_audio ? 2160 : 450000;
+
+            while (next_dts[i] < (burst + 1) * BURST) {
+                uint8_t data[4] = { 0 };
+                AVPacket pkt;
+
+                av_init_packet(&pkt);
+                pkt.data         = data;
+                pkt.size         = sizeof(data);
+                pkt.stream_index = i;
+                pkt.pts          = pkt.dts = next_dts[i];
+                pkt.duration     = duration;
+                pkt.flags        = AV_PKT_FLAG_KEY;
+                next_dts[i]     += duration;
+                if ((ret = av_interleaved_write_frame(s, &pkt)) < 0)
+                    goto end;
+                nb_packets++;
+            }
+        }
+    }
+    ret = av_write_trailer(s);
+    t   = av_gettime_relative() - t;
+
+    fprintf(stderr, "%d streams, %"PRId64" packets: %.3f s, %"PRId64" ns/packet\n",
+            nb_streams, nb_packets, t / 1000000.0, t * 1000 / FFMAX(nb_packets, 1));
+    av_free(next_dts);
+
+end:
+    av_dict_free(&opts);
+    if (s)
+        avio_close(s->pb);
+    avformat_free_context(s);
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}